@@ -78,18 +78,62 @@ extern "C"
 #define easyrdma_AddressFamily_AF_INET6   0x06 // Enumerate only IPv6 interfaces
 
 // Properties
-#define easyrdma_Property_QueuedBuffers   0x100     // uint64_t
-#define easyrdma_Property_Connected       0x101     // uint8_t/bool
-#define easyrdma_Property_UserBuffers     0x102     // uint64_t
-#define easyrdma_Property_UseRxPolling    0x103     // uint8_t/bool
+#define easyrdma_Property_QueuedBuffers                    0x100     // uint64_t
+#define easyrdma_Property_Connected                        0x101     // uint8_t/bool
+#define easyrdma_Property_UserBuffers                      0x102     // uint64_t
+#define easyrdma_Property_UseRxPolling                     0x103     // uint8_t/bool
+#define easyrdma_Property_SendSignalInterval               0x104     // uint64_t
+#define easyrdma_Property_InlineThreshold                  0x105     // uint64_t
+#define easyrdma_Property_UseRingBuffer                    0x106     // uint8_t/bool
+#define easyrdma_Property_UsePullMode                      0x107     // uint8_t/bool
+#define easyrdma_Property_SharedReceiveBufferSize          0x108     // uint64_t
+#define easyrdma_Property_SharedReceiveBufferCount         0x109     // uint64_t
+#define easyrdma_Property_SpinWaitBudget                   0x10A     // uint64_t (microseconds)
+#define easyrdma_Property_CompletionFd                     0x10B     // int32_t (Linux only)
+#define easyrdma_Property_ThreadPolicies                   0x10C     // easyrdma_ThreadPolicy[easyrdma_NumThreadRoles]
+#define easyrdma_Property_AllowConcurrentWaits             0x10D     // uint8_t/bool
+#define easyrdma_Property_UseHugePages                     0x10E     // uint8_t/bool
+#define easyrdma_Property_UseOnDemandPaging                0x10F     // uint8_t/bool (for ConfigureExternalBuffer)
+#define easyrdma_Property_OnDemandPagingCaps               0x110     // uint32_t (easyrdma_OnDemandPagingCaps_*, read-only)
+#define easyrdma_Property_BufferPool                       0x111     // easyrdma_BufferPool (write-only, for ConfigureBuffers)
+#define easyrdma_Property_CreditBufferPool                 0x112     // easyrdma_BufferPool (write-only, set before connecting)
+#define easyrdma_Property_SharedReceiveShortages           0x113     // uint64_t (read-only, listener)
+
+// Process-wide properties (pass easyrdma_InvalidSession as the session)
+#define easyrdma_Property_CompletionEngineThreads          0x300     // uint64_t
+#define easyrdma_Property_CallbackExecutorThreads          0x301     // uint64_t
+#define easyrdma_Property_CallbackExecutorAffinity         0x302     // uint64_t (CPU bit mask, 0 for any)
+#define easyrdma_Property_DefaultThreadPolicies            0x303     // easyrdma_ThreadPolicy[easyrdma_NumThreadRoles] (for sessions created afterwards)
 
 // Internal-use-only properties (for testing -- do not use)
 #define easyrdma_Property_NumOpenedSessions                0x200     // uint64_t
 #define easyrdma_Property_NumPendingDestructionSessions    0x201     // uint64_t
 #define easyrdma_Property_ConnectionData                   0x202     // binary blob
+#define easyrdma_Property_NumMemoryRegistrations           0x203     // uint64_t
 
 // Flags
 #define easyrdma_CloseFlags_DeferWhileUserBuffersOutstanding   0x01
+#define easyrdma_RegisterFlags_RemoteRead                      0x01 // Also allow pull-mode receivers to read the memory
+#define easyrdma_RegisterFlags_OnDemand                        0x02 // Don't pin the memory up front. The device faults pages in as it uses them.
+
+// On-demand paging capabilities of a session's device
+#define easyrdma_OnDemandPagingCaps_Supported                  0x01 // Sends and receives
+#define easyrdma_OnDemandPagingCaps_PullMode                   0x02 // Reads, as used by pull mode
+#define easyrdma_OnDemandPagingCaps_Implicit                   0x04 // Registering the whole address space at once
+#define easyrdma_BufferPoolFlags_HugePages                     0x01
+
+// Kinds of internal threads a session runs, used to index easyrdma_Property_ThreadPolicies
+#define easyrdma_ThreadRole_Connection          0x00 // Watches for disconnection
+#define easyrdma_ThreadRole_SendCompletion      0x01 // Reaps send completions
+#define easyrdma_ThreadRole_ReceiveCompletion   0x02 // Reaps receive completions and pulls data in pull mode
+#define easyrdma_ThreadRole_Ack                 0x03 // Handles credits from the remote side
+#define easyrdma_NumThreadRoles                 4
+
+// Scheduling policy for an internal thread
+#define easyrdma_SchedPolicy_Default      0x00 // Leave it as the library chooses
+#define easyrdma_SchedPolicy_Other        0x01 // SCHED_OTHER (Linux only)
+#define easyrdma_SchedPolicy_Fifo         0x02 // SCHED_FIFO (Linux only)
+#define easyrdma_SchedPolicy_RoundRobin   0x03 // SCHED_RR (Linux only)
 
 // Structures
 struct easyrdma_AddressString
@@ -114,11 +158,19 @@ struct easyrdma_InternalBufferRegion
                 void* internalReference1; // Used internally by the API
                 void* internalReference2; // Used internally by the API
             } Internal;
+            uint64_t sequenceNumber; // Order in which received regions completed, counting from 0. 0 for send regions.
         };
         char padding[64]; // Ensure struct is large enough for future additions
     };
 };
 
+struct easyrdma_ThreadPolicy
+{
+    uint64_t cpuMask; // Bit n allows CPU n. 0 leaves the affinity alone.
+    int32_t schedPolicy; // One of easyrdma_SchedPolicy_*
+    int32_t schedPriority; // Only used with SCHED_FIFO and SCHED_RR
+};
+
 struct easyrdma_ErrorInfo
 {
     int errorCode;
@@ -138,6 +190,7 @@ struct easyrdma_BufferCompletionCallbackData
 };
 
 typedef struct easyrdma_Session_struct* easyrdma_Session;
+typedef struct easyrdma_BufferPool_struct* easyrdma_BufferPool;
 #define easyrdma_InvalidSession nullptr
 
 int32_t _RDMA_FUNC easyrdma_Enumerate(easyrdma_AddressString addresses[], size_t* numAddresses, int32_t filterAddressFamily = easyrdma_AddressFamily_AF_UNSPEC);
@@ -153,14 +206,30 @@ int32_t _RDMA_FUNC easyrdma_ConfigureBuffers(easyrdma_Session session, size_t ma
 int32_t _RDMA_FUNC easyrdma_ConfigureExternalBuffer(easyrdma_Session session, void* externalBuffer, size_t bufferSize, size_t maxConcurrentTransactions);
 int32_t _RDMA_FUNC easyrdma_AcquireSendRegion(easyrdma_Session session, int32_t timeoutMs, easyrdma_InternalBufferRegion* bufferRegion);
 int32_t _RDMA_FUNC easyrdma_AcquireReceivedRegion(easyrdma_Session session, int32_t timeoutMs, easyrdma_InternalBufferRegion* bufferRegion);
+int32_t _RDMA_FUNC easyrdma_AcquireReceivedRegions(easyrdma_Session session, int32_t timeoutMs, easyrdma_InternalBufferRegion bufferRegions[], size_t minRegions, size_t maxRegions, size_t* numRegions);
 int32_t _RDMA_FUNC easyrdma_QueueBufferRegion(easyrdma_Session session, easyrdma_InternalBufferRegion* bufferRegion, easyrdma_BufferCompletionCallbackData* callback);
+int32_t _RDMA_FUNC easyrdma_QueueBufferRegions(easyrdma_Session session, easyrdma_InternalBufferRegion bufferRegions[], size_t numRegions, easyrdma_BufferCompletionCallbackData callbacks[]);
 int32_t _RDMA_FUNC easyrdma_QueueExternalBufferRegion(easyrdma_Session session, void* pointerWithinBuffer, size_t size, easyrdma_BufferCompletionCallbackData* callbackData, int32_t timeoutMs);
 int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegion(easyrdma_Session session, easyrdma_InternalBufferRegion* bufferRegion);
+int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegions(easyrdma_Session session, easyrdma_InternalBufferRegion bufferRegions[], size_t numRegions);
 int32_t _RDMA_FUNC easyrdma_GetProperty(easyrdma_Session session, uint32_t propertyId, void* value, size_t* valueSize);
 int32_t _RDMA_FUNC easyrdma_SetProperty(easyrdma_Session session, uint32_t propertyId, const void* value, size_t valueSize);
 int32_t _RDMA_FUNC easyrdma_GetLastErrorString(char* buffer, size_t bufferSize);
 int32_t _RDMA_FUNC easyrdma_ReleaseUserBufferRegionToIdle(easyrdma_Session session, easyrdma_InternalBufferRegion* bufferRegion);
 int32_t _RDMA_FUNC easyrdma_GetLastError(easyrdma_ErrorInfo* status);
+// Keeps memory registered on the device behind localAddress, so that sessions on that device configured with an
+// external buffer within it don't each have to register it again. Linux only.
+// With easyrdma_RegisterFlags_OnDemand, a null buffer and a size of SIZE_MAX register the whole address space, if the
+// device supports implicit on-demand paging. Unregister it by passing a null buffer.
+int32_t _RDMA_FUNC easyrdma_RegisterMemory(const char* localAddress, void* buffer, size_t bufferSize, uint32_t flags = 0);
+// Sessions still using the memory keep it registered until they are closed
+int32_t _RDMA_FUNC easyrdma_UnregisterMemory(void* buffer);
+// Allocates and registers numBuffers buffers of bufferSize bytes up front, on the device behind localAddress. Sessions
+// given the pool through easyrdma_Property_BufferPool or easyrdma_Property_CreditBufferPool take their buffers from it,
+// and fail with easyrdma_Error_OutOfMemory if not enough are free. Linux only.
+int32_t _RDMA_FUNC easyrdma_CreateBufferPool(const char* localAddress, size_t bufferSize, size_t numBuffers, uint32_t flags, easyrdma_BufferPool* pool);
+// Sessions already using the pool keep its memory until they are closed
+int32_t _RDMA_FUNC easyrdma_DestroyBufferPool(easyrdma_BufferPool pool);
 
 // Internal-use-only functions (for testing -- do not use)
 void _RDMA_FUNC easyrdma_testsetLastOsError(int osErrorCode);
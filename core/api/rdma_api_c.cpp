@@ -7,6 +7,12 @@
 #include "RdmaSession.h"
 #include "RdmaConnector.h"
 #include "RdmaListener.h"
+#include "CompletionEngine.h"
+#include "CallbackExecutor.h"
+#include "RdmaRegistrationCache.h"
+#include "RdmaBufferPool.h"
+#include "ThreadUtility.h"
+#include "tSmallArray.h"
 #include "api/rdma_api_common.h"
 #include "easyrdma.h"
 
@@ -40,6 +46,14 @@ static void UpdateLastError(const RdmaError& status)
     PopulateLastRdmaError(status);
 }
 
+// Constructed on first use, which is after the registration cache, so pools still around at exit are destroyed
+// while the cache they unregister from still exists
+static tHandleTable<RdmaBufferPool>& GetBufferPoolTable()
+{
+    static tHandleTable<RdmaBufferPool> bufferPoolTable;
+    return bufferPoolTable;
+}
+
 int32_t _RDMA_FUNC easyrdma_Enumerate(easyrdma_AddressString addresses[], size_t* numAddresses, int32_t filterAddressFamily)
 {
     RdmaError status;
@@ -223,12 +237,18 @@ int32_t _RDMA_FUNC easyrdma_AcquireSendRegion(easyrdma_Session session, int32_t
             RDMA_THROW(easyrdma_Error_InvalidArgument);
         }
         auto sessionRef = sessionManager.GetSession(session);
-        RdmaBufferRegion* internalRegion = sessionRef->AcquireSendRegion(timeoutMs);
+        // Running out of time comes back in status rather than as an exception. See RdmaSession.
+        RdmaBufferRegion* internalRegion = sessionRef->AcquireSendRegion(timeoutMs, status);
+        if (!internalRegion) {
+            UpdateLastError(status);
+            return status.GetCode();
+        }
         bufferRegion->buffer = internalRegion->GetPointer();
         bufferRegion->bufferSize = internalRegion->GetSize();
         bufferRegion->usedSize = internalRegion->GetSize();
         bufferRegion->Internal.internalReference1 = reinterpret_cast<void*>(session);
         bufferRegion->Internal.internalReference2 = internalRegion;
+        bufferRegion->sequenceNumber = 0;
     }
     API_CATCH_EXCEPTION(status);
     UpdateLastError(status);
@@ -244,12 +264,43 @@ int32_t _RDMA_FUNC easyrdma_AcquireReceivedRegion(easyrdma_Session session, int3
             RDMA_THROW(easyrdma_Error_InvalidArgument);
         }
         auto sessionRef = sessionManager.GetSession(session);
-        RdmaBufferRegion* internalRegion = sessionRef->AcquireReceivedRegion(timeoutMs);
+        RdmaBufferRegion* internalRegion = sessionRef->AcquireReceivedRegion(timeoutMs, status);
+        if (!internalRegion) {
+            UpdateLastError(status);
+            return status.GetCode();
+        }
         bufferRegion->buffer = internalRegion->GetPointer();
         bufferRegion->bufferSize = internalRegion->GetSize();
         bufferRegion->usedSize = internalRegion->GetUsed();
         bufferRegion->Internal.internalReference1 = reinterpret_cast<void*>(session);
         bufferRegion->Internal.internalReference2 = internalRegion;
+        bufferRegion->sequenceNumber = internalRegion->GetSequenceNumber();
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
+int32_t _RDMA_FUNC easyrdma_AcquireReceivedRegions(easyrdma_Session session, int32_t timeoutMs, easyrdma_InternalBufferRegion bufferRegions[], size_t minRegions, size_t maxRegions, size_t* numRegions)
+{
+    RdmaError status;
+    try {
+        if (!bufferRegions || !numRegions || !minRegions || minRegions > maxRegions) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        *numRegions = 0;
+        auto sessionRef = sessionManager.GetSession(session);
+        tSmallArray<RdmaBufferRegion*, kRegionsOnStack> internalRegions(maxRegions);
+        size_t numAcquired = sessionRef->AcquireReceivedRegions(internalRegions.data(), minRegions, maxRegions, timeoutMs, status);
+        for (size_t i = 0; i < numAcquired; ++i) {
+            bufferRegions[i].buffer = internalRegions[i]->GetPointer();
+            bufferRegions[i].bufferSize = internalRegions[i]->GetSize();
+            bufferRegions[i].usedSize = internalRegions[i]->GetUsed();
+            bufferRegions[i].Internal.internalReference1 = reinterpret_cast<void*>(session);
+            bufferRegions[i].Internal.internalReference2 = internalRegions[i];
+            bufferRegions[i].sequenceNumber = internalRegions[i]->GetSequenceNumber();
+        }
+        *numRegions = numAcquired;
     }
     API_CATCH_EXCEPTION(status);
     UpdateLastError(status);
@@ -263,7 +314,8 @@ int32_t _RDMA_FUNC easyrdma_QueueBufferRegion(easyrdma_Session session, easyrdma
         if (!bufferRegion || !bufferRegion->Internal.internalReference1 || !bufferRegion->Internal.internalReference2) {
             RDMA_THROW(easyrdma_Error_InvalidArgument);
         }
-        auto sessionRef = sessionManager.GetSession(session);
+        // Queueing is safe alongside any other call on the session, so it only needs to keep the session alive
+        auto sessionRef = sessionManager.GetSession(session, kAccess_KeepAlive);
         BufferCompletionCallbackData callbackData = {};
         if (callback && callback->callbackFunction) {
             callbackData.callbackFunction = callback->callbackFunction;
@@ -279,6 +331,47 @@ int32_t _RDMA_FUNC easyrdma_QueueBufferRegion(easyrdma_Session session, easyrdma
     return status.GetCode();
 }
 
+int32_t _RDMA_FUNC easyrdma_QueueBufferRegions(easyrdma_Session session, easyrdma_InternalBufferRegion bufferRegions[], size_t numRegions, easyrdma_BufferCompletionCallbackData callbacks[])
+{
+    RdmaError status;
+    try {
+        if (!bufferRegions) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        for (size_t i = 0; i < numRegions; ++i) {
+            if (!bufferRegions[i].Internal.internalReference1 || !bufferRegions[i].Internal.internalReference2) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            if (reinterpret_cast<easyrdma_Session>(bufferRegions[i].Internal.internalReference1) != session) {
+                // Session ids should match, since the whole batch goes to this session's queue
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            if (bufferRegions[i].usedSize > reinterpret_cast<RdmaBufferRegion*>(bufferRegions[i].Internal.internalReference2)->GetSize()) {
+                RDMA_THROW(easyrdma_Error_InvalidSize);
+            }
+        }
+        auto sessionRef = sessionManager.GetSession(session, kAccess_KeepAlive);
+        tSmallArray<RdmaBufferRegion*, kRegionsOnStack> rdmaBufferRegions(numRegions);
+        tSmallArray<BufferCompletionCallbackData, kRegionsOnStack> callbackData(callbacks ? numRegions : 0);
+        for (size_t i = 0; i < numRegions; ++i) {
+            if (callbacks && callbacks[i].callbackFunction) {
+                callbackData[i].callbackFunction = callbacks[i].callbackFunction;
+                callbackData[i].context1 = callbacks[i].context1;
+                callbackData[i].context2 = callbacks[i].context2;
+            }
+            rdmaBufferRegions[i] = reinterpret_cast<RdmaBufferRegion*>(bufferRegions[i].Internal.internalReference2);
+        }
+        // Only touched once the whole batch has checked out, so a rejected batch leaves every buffer as it was
+        for (size_t i = 0; i < numRegions; ++i) {
+            rdmaBufferRegions[i]->SetUsed(bufferRegions[i].usedSize);
+        }
+        sessionRef->QueueBufferRegions(rdmaBufferRegions.data(), numRegions, callbacks ? callbackData.data() : nullptr);
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
 int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegion(easyrdma_Session session, easyrdma_InternalBufferRegion* bufferRegion)
 {
     RdmaError status;
@@ -290,7 +383,7 @@ int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegion(easyrdma_Session session
             // Session ids should match
             RDMA_THROW(easyrdma_Error_InvalidArgument);
         }
-        auto sessionRef = sessionManager.GetSession(session);
+        auto sessionRef = sessionManager.GetSession(session, kAccess_KeepAlive);
         try {
             reinterpret_cast<RdmaBufferRegion*>(bufferRegion->Internal.internalReference2)->Requeue();
         } catch (const RdmaException& e) {
@@ -309,6 +402,43 @@ int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegion(easyrdma_Session session
     return status.GetCode();
 }
 
+int32_t _RDMA_FUNC easyrdma_ReleaseReceivedBufferRegions(easyrdma_Session session, easyrdma_InternalBufferRegion bufferRegions[], size_t numRegions)
+{
+    RdmaError status;
+    try {
+        if (!bufferRegions) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        tSmallArray<RdmaBufferRegion*, kRegionsOnStack> internalRegions(numRegions);
+        for (size_t i = 0; i < numRegions; ++i) {
+            if (!bufferRegions[i].Internal.internalReference1 || !bufferRegions[i].Internal.internalReference2) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            if (reinterpret_cast<easyrdma_Session>(bufferRegions[i].Internal.internalReference1) != session) {
+                // Session ids should match
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            internalRegions[i] = reinterpret_cast<RdmaBufferRegion*>(bufferRegions[i].Internal.internalReference2);
+        }
+        auto sessionRef = sessionManager.GetSession(session, kAccess_KeepAlive);
+        try {
+            sessionRef->ReleaseReceivedRegions(internalRegions.data(), numRegions);
+        } catch (const RdmaException& e) {
+            // Same as releasing them one at a time: once disconnected the buffers just go back to idle
+            if (e.rdmaError.GetCode() == easyrdma_Error_Disconnected) {
+                for (auto region : internalRegions) {
+                    region->Release();
+                }
+            } else {
+                throw;
+            }
+        }
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
 int32_t _RDMA_FUNC easyrdma_ReleaseUserBufferRegionToIdle(easyrdma_Session session, easyrdma_InternalBufferRegion* bufferRegion)
 {
     RdmaError status;
@@ -345,7 +475,71 @@ int32_t _RDMA_FUNC easyrdma_QueueExternalBufferRegion(easyrdma_Session session,
             callbackData.context1 = callback->context1;
             callbackData.context2 = callback->context2;
         }
-        sessionRef->QueueExternalBufferRegion(pointerWithinBuffer, size, callbackData, timeoutMs);
+        sessionRef->QueueExternalBufferRegion(pointerWithinBuffer, size, callbackData, timeoutMs, status);
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
+int32_t _RDMA_FUNC easyrdma_RegisterMemory(const char* localAddress, void* buffer, size_t bufferSize, uint32_t flags)
+{
+    RdmaError status;
+    try {
+        // The buffer and size are checked further by the cache, which knows about implicit on-demand registrations
+        if (!localAddress || (flags & ~(easyrdma_RegisterFlags_RemoteRead | easyrdma_RegisterFlags_OnDemand))) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        GlobalInitializeIfNeeded();
+        MemoryAccess access = (flags & easyrdma_RegisterFlags_RemoteRead) ? MemoryAccess::RemoteRead : MemoryAccess::Local;
+        bool onDemand = (flags & easyrdma_RegisterFlags_OnDemand) != 0;
+        GetRegistrationCache().Register(RdmaAddress(localAddress, 0), buffer, bufferSize, access, onDemand);
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
+int32_t _RDMA_FUNC easyrdma_UnregisterMemory(void* buffer)
+{
+    RdmaError status;
+    try {
+        // A null buffer is how an implicit on-demand registration is unregistered
+        GetRegistrationCache().Unregister(buffer);
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
+int32_t _RDMA_FUNC easyrdma_CreateBufferPool(const char* localAddress, size_t bufferSize, size_t numBuffers, uint32_t flags, easyrdma_BufferPool* pool)
+{
+    RdmaError status;
+    try {
+        if (!localAddress || !pool || (flags & ~easyrdma_BufferPoolFlags_HugePages)) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        GlobalInitializeIfNeeded();
+        bool useHugePages = (flags & easyrdma_BufferPoolFlags_HugePages) != 0;
+        auto bufferPool = std::make_shared<RdmaBufferPool>(RdmaAddress(localAddress, 0), bufferSize, numBuffers, useHugePages);
+        auto handle = GetBufferPoolTable().Insert(bufferPool);
+        if (!handle) {
+            RDMA_THROW(easyrdma_Error_OutOfMemory);
+        }
+        *pool = reinterpret_cast<easyrdma_BufferPool>(handle);
+    }
+    API_CATCH_EXCEPTION(status);
+    UpdateLastError(status);
+    return status.GetCode();
+}
+
+int32_t _RDMA_FUNC easyrdma_DestroyBufferPool(easyrdma_BufferPool pool)
+{
+    RdmaError status;
+    try {
+        if (!GetBufferPoolTable().Erase(reinterpret_cast<tHandleTable<RdmaBufferPool>::Handle>(pool))) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
     }
     API_CATCH_EXCEPTION(status);
     UpdateLastError(status);
@@ -402,6 +596,21 @@ int32_t _RDMA_FUNC easyrdma_GetProperty(easyrdma_Session session, uint32_t prope
             case easyrdma_Property_NumPendingDestructionSessions:
                 output = PropertyData(sessionManager.GetDeferredCloseSessions());
                 break;
+            case easyrdma_Property_NumMemoryRegistrations:
+                output = PropertyData(static_cast<uint64_t>(GetRegistrationCache().GetRegistrationCount()));
+                break;
+            case easyrdma_Property_CompletionEngineThreads:
+                output = PropertyData(static_cast<uint64_t>(GetCompletionEngine().GetThreadCount()));
+                break;
+            case easyrdma_Property_CallbackExecutorThreads:
+                output = PropertyData(static_cast<uint64_t>(GetCallbackExecutor().GetThreadCount()));
+                break;
+            case easyrdma_Property_CallbackExecutorAffinity:
+                output = PropertyData(GetCallbackExecutor().GetAffinity());
+                break;
+            case easyrdma_Property_DefaultThreadPolicies:
+                output = PropertyData(GetDefaultThreadPolicies());
+                break;
             default: {
                 auto sessionRef = sessionManager.GetSession(session);
                 output = sessionRef->GetProperty(propertyId);
@@ -419,7 +628,52 @@ int32_t _RDMA_FUNC easyrdma_SetProperty(easyrdma_Session session, uint32_t prope
 {
     RdmaError status;
     try {
-        sessionManager.GetSession(session)->SetProperty(propertyId, value, valueSize);
+        switch (propertyId) {
+            case easyrdma_Property_CompletionEngineThreads:
+                if (!value || valueSize != sizeof(uint64_t)) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                GetCompletionEngine().SetThreadCount(static_cast<size_t>(*static_cast<const uint64_t*>(value)));
+                break;
+            case easyrdma_Property_CallbackExecutorThreads:
+                if (!value || valueSize != sizeof(uint64_t)) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                GetCallbackExecutor().SetThreadCount(static_cast<size_t>(*static_cast<const uint64_t*>(value)));
+                break;
+            case easyrdma_Property_CallbackExecutorAffinity:
+                if (!value || valueSize != sizeof(uint64_t)) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                GetCallbackExecutor().SetAffinity(*static_cast<const uint64_t*>(value));
+                break;
+            case easyrdma_Property_DefaultThreadPolicies: {
+                if (!value || valueSize != sizeof(tThreadPolicies)) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                tThreadPolicies policies;
+                memcpy(&policies, value, sizeof(policies));
+                SetDefaultThreadPolicies(policies);
+                break;
+            }
+            case easyrdma_Property_BufferPool:
+            case easyrdma_Property_CreditBufferPool: {
+                if (!value || valueSize != sizeof(easyrdma_BufferPool)) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                // A null handle stops the session from using a pool
+                std::shared_ptr<RdmaBufferPool> pool;
+                auto handle = reinterpret_cast<tHandleTable<RdmaBufferPool>::Handle>(*static_cast<const easyrdma_BufferPool*>(value));
+                if (handle && !(pool = GetBufferPoolTable().Lookup(handle))) {
+                    RDMA_THROW(easyrdma_Error_InvalidArgument);
+                }
+                sessionManager.GetSession(session)->SetBufferPool(propertyId, pool);
+                break;
+            }
+            default:
+                sessionManager.GetSession(session)->SetProperty(propertyId, value, valueSize);
+                break;
+        }
     }
     API_CATCH_EXCEPTION(status);
     UpdateLastError(status);
@@ -5,6 +5,7 @@
 #include "RdmaError.h"
 #include "RdmaSession.h"
 #include "api/tAccessManagedRef.h"
+#include "common/tHandleTable.h"
 #include <map>
 #include <mutex>
 #include "easyrdma.h"
@@ -25,22 +26,35 @@ class SessionManager
 public:
     easyrdma_Session RegisterSession(RdmaSessionRef& session)
     {
-        std::unique_lock<std::mutex> guard(mapLock);
-        easyrdma_Session sessionHandle = reinterpret_cast<easyrdma_Session>(nextSession++);
-        sessionMap[sessionHandle] = session.GetResource();
-        return sessionHandle;
+        auto sessionHandle = sessionTable.Insert(session.GetResource());
+        if (!sessionHandle) {
+            RDMA_THROW(easyrdma_Error_OutOfMemory);
+        }
+        return reinterpret_cast<easyrdma_Session>(sessionHandle);
     }
     RdmaSessionRef GetSession(easyrdma_Session session, tAccessType access = kAccess_Exclusive, tCheckDeferredCloseTable checkDeferredCloseTable = tCheckDeferredCloseTable::No)
     {
-        std::unique_lock<std::mutex> guard(mapLock);
-        auto it = sessionMap.find(session);
-        if (it != sessionMap.end()) {
-            return RdmaSessionRef(it->second, access);
+        auto sessionHandle = reinterpret_cast<tHandleTable<RdmaSession>::Handle>(session);
+        auto found = sessionTable.Lookup(sessionHandle);
+        if (found) {
+            RdmaSessionRef sessionRef(found, access);
+            // Getting access can block, and the session may have been destroyed in the meantime. Keep-alive
+            // references are refused outright once destruction has gotten far enough.
+            if (sessionRef && sessionTable.IsCurrent(sessionHandle)) {
+                return sessionRef;
+            }
         }
         if (checkDeferredCloseTable == tCheckDeferredCloseTable::Yes) {
-            auto deferedIt = deferredCloseSessionMap.find(session);
-            if (deferedIt != deferredCloseSessionMap.end()) {
-                return RdmaSessionRef(deferedIt->second, access, true);
+            std::shared_ptr<RdmaSession> deferred;
+            {
+                std::unique_lock<std::mutex> guard(mapLock);
+                auto deferedIt = deferredCloseSessionMap.find(session);
+                if (deferedIt != deferredCloseSessionMap.end()) {
+                    deferred = deferedIt->second;
+                }
+            }
+            if (deferred) {
+                return RdmaSessionRef(deferred, access, true);
             }
         }
         RDMA_THROW(easyrdma_Error_InvalidSession);
@@ -50,20 +64,23 @@ public:
         RdmaSessionRef erasedSession;
         bool deferredDestruction = false;
         {
+            // Lookups don't take this lock, but it keeps a session from disappearing from both tables at once
+            // while it moves to the deferred close table
             std::unique_lock<std::mutex> guard(mapLock);
-            auto it = sessionMap.find(session);
-            if (it != sessionMap.end()) {
-                erasedSession = RdmaSessionRef(it->second, kAccess_Exclusive);
-                sessionMap.erase(it);
+            auto sessionHandle = reinterpret_cast<tHandleTable<RdmaSession>::Handle>(session);
+            auto found = sessionTable.Lookup(sessionHandle);
+            if (found) {
+                erasedSession = RdmaSessionRef(found, kAccess_Exclusive);
+            }
+            if (!found || !sessionTable.Erase(sessionHandle)) {
+                RDMA_THROW(easyrdma_Error_InvalidSession);
+            }
 
-                if (flags & easyrdma_CloseFlags_DeferWhileUserBuffersOutstanding) {
-                    if (!erasedSession->CheckDeferredDestructionConditionsMet()) {
-                        deferredCloseSessionMap[session] = erasedSession.GetResource();
-                        deferredDestruction = true;
-                    }
+            if (flags & easyrdma_CloseFlags_DeferWhileUserBuffersOutstanding) {
+                if (!erasedSession->CheckDeferredDestructionConditionsMet()) {
+                    deferredCloseSessionMap[session] = erasedSession.GetResource();
+                    deferredDestruction = true;
                 }
-            } else {
-                RDMA_THROW(easyrdma_Error_InvalidSession);
             }
         }
 
@@ -79,16 +96,18 @@ public:
     {
         assert(sessionRef.IsDestructionPending());
         if (sessionRef->CheckDeferredDestructionConditionsMet()) {
-            assert(deferredCloseSessionMap.find(sessionHandle) != deferredCloseSessionMap.end());
-            deferredCloseSessionMap.erase(sessionHandle);
+            {
+                std::unique_lock<std::mutex> guard(mapLock);
+                assert(deferredCloseSessionMap.find(sessionHandle) != deferredCloseSessionMap.end());
+                deferredCloseSessionMap.erase(sessionHandle);
+            }
             sessionRef.ReleaseAndWaitForAllReferencesGone();
         }
     }
 
     uint64_t GetOpenedSessions() const
     {
-        std::unique_lock<std::mutex> guard(mapLock);
-        return sessionMap.size();
+        return sessionTable.size();
     }
 
     uint64_t GetDeferredCloseSessions() const
@@ -98,10 +117,10 @@ public:
     }
 
 private:
+    // Serializes destruction and guards the deferred close table. Data-path lookups only go through sessionTable.
     mutable std::mutex mapLock;
-    std::map<easyrdma_Session, std::shared_ptr<RdmaSession>> sessionMap;
+    tHandleTable<RdmaSession> sessionTable;
     std::map<easyrdma_Session, std::shared_ptr<RdmaSession>> deferredCloseSessionMap;
-    uintptr_t nextSession = 1;
 };
 
 extern SessionManager sessionManager;
@@ -13,6 +13,8 @@ enum tAccessType
 {
     kAccess_Shared      = 0,
     kAccess_Exclusive   = 1,
+    // Only keeps the resource from being torn down; see tAccessManager::TryAcquireKeepAlive
+    kAccess_KeepAlive   = 2,
 };
 
 //============================================================================
@@ -26,24 +28,31 @@ public:
     //  Constructors
     //--------------------------------------------------------------------
     tAccessManagedRef() :
-        _resource(NULL), _exclusive(false), _destructionPending(false)
+        _resource(NULL), _access(kAccess_Shared), _destructionPending(false)
     {
     }
+    // A keep-alive reference can be refused, in which case the ref is left empty
     tAccessManagedRef(std::shared_ptr<T> resource, tAccessType access = kAccess_Exclusive, bool destructionPending = false) :
         _resource(resource),
-        _exclusive(access == kAccess_Exclusive),
+        _access(access),
         _destructionPending(destructionPending)
     {
-        if (_resource)
-            static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Acquire(_exclusive);
+        if (_resource) {
+            if (_access == kAccess_KeepAlive) {
+                if (!GetAccessManager().TryAcquireKeepAlive())
+                    _resource.reset();
+            } else {
+                GetAccessManager().Acquire(_access == kAccess_Exclusive);
+            }
+        }
     }
     tAccessManagedRef(const tAccessManagedRef& other) :
         _resource(other._resource),
-        _exclusive(other._exclusive),
+        _access(other._access),
         _destructionPending(other._destructionPending)
     {
         if (_resource)
-            static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Acquire(_exclusive);
+            AddReference();
     }
     //--------------------------------------------------------------------
     //  Destructor
@@ -51,7 +60,7 @@ public:
     ~tAccessManagedRef()
     {
         if (_resource)
-            static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Release();
+            RemoveReference();
     }
     //--------------------------------------------------------------------
     //  Operators
@@ -61,12 +70,12 @@ public:
         if (&other == this)
             return *this;
         if (_resource)
-            static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Release();
+            RemoveReference();
         _resource = other._resource;
-        _exclusive = other._exclusive;
+        _access = other._access;
         _destructionPending = other._destructionPending;
         if (_resource)
-            static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Acquire(_exclusive);
+            AddReference();
         return *this;
     }
     operator bool() const
@@ -84,8 +93,9 @@ public:
     void ReleaseAndWaitForAllReferencesGone()
     {
         assert(_resource);
-        static_cast<iAccessManaged*>(_resource.get())->GetAccessManager().Release();
-        _resource.get()->GetAccessManager().WaitForAllReferencesToBeReleased();
+        RemoveReference();
+        GetAccessManager().CloseKeepAlives();
+        GetAccessManager().WaitForAllReferencesToBeReleased();
         _resource.reset();
     }
     bool IsDestructionPending()
@@ -102,10 +112,32 @@ public:
     }
 
 private:
+    //--------------------------------------------------------------------
+    //  Helpers
+    //--------------------------------------------------------------------
+    tAccessManager& GetAccessManager()
+    {
+        return static_cast<iAccessManaged*>(_resource.get())->GetAccessManager();
+    }
+    // Adds another reference of our type. We already hold one, so a keep-alive can't be refused.
+    void AddReference()
+    {
+        if (_access == kAccess_KeepAlive)
+            GetAccessManager().AcquireKeepAlive();
+        else
+            GetAccessManager().Acquire(_access == kAccess_Exclusive);
+    }
+    void RemoveReference()
+    {
+        if (_access == kAccess_KeepAlive)
+            GetAccessManager().ReleaseKeepAlive();
+        else
+            GetAccessManager().Release();
+    }
     //--------------------------------------------------------------------
     //  Members
     //--------------------------------------------------------------------
     std::shared_ptr<T> _resource;
-    bool _exclusive;
+    tAccessType _access;
     bool _destructionPending;
 };
@@ -51,6 +51,10 @@ public:
     void IncRef();
     void DecRef();
     void WaitForAllReferencesToBeReleased();
+    bool TryAcquireKeepAlive();
+    void AcquireKeepAlive();
+    void ReleaseKeepAlive();
+    void CloseKeepAlives();
     bool HasExclusiveAccess();
     bool HasSharedAccess();
     void AcquireAll(const tAccessStack& accessStack);
@@ -64,6 +68,7 @@ public:
     uint32_t DebugGetActiveCount() const;
     uint32_t DebugGetActiveSharedCount() const;
     uint32_t DebugGetActiveExclusiveCount() const;
+    uint32_t DebugGetKeepAliveCount() const;
     void WaitForAllReferencesToBeReleasedWithTimeout(int32_t timeout);
 
 private:
@@ -216,6 +221,13 @@ private:
     tRequestList emptyRequests;
     tEvent allRefsReleased;
     //--------------------------------------------------------------------
+    //  Keep-alive references bypass everything above. The top bit is set
+    //  once no more may be taken; the rest is the number outstanding.
+    //--------------------------------------------------------------------
+    static const uint32_t kKeepAlivesClosed = 0x80000000;
+    std::atomic<uint32_t> keepAliveState;
+    tEvent keepAlivesReleased;
+    //--------------------------------------------------------------------
     //  Private Functions
     //--------------------------------------------------------------------
     void GetSharedAccess();
@@ -244,7 +256,9 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 inline tAccessManager::tAccessManager() :
     refcount(0),
-    allRefsReleased(false, true)
+    allRefsReleased(false, true),
+    keepAliveState(0),
+    keepAlivesReleased(false, false)
 {
     //------------------------------------------------------------------------
     //  Make enough requests to satisfy our maximum number of concurrent threads
@@ -659,6 +673,80 @@ inline void tAccessManager::DecRef()
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tAccessManager::TryAcquireKeepAlive
+//
+//  Description:
+//      Adds a keep-alive reference, which only guarantees the entity isn't
+//      torn down until it is released. It grants neither shared nor exclusive
+//      access and costs a single atomic op, so it suits short calls that are
+//      safe to run alongside anything else on the entity. Every successful
+//      call must be followed by a ReleaseKeepAlive.
+//
+//  Return Value:
+//      False if CloseKeepAlives has been called, in which case no reference
+//      was added.
+//
+//////////////////////////////////////////////////////////////////////////////
+inline bool tAccessManager::TryAcquireKeepAlive()
+{
+    if (keepAliveState.fetch_add(1, std::memory_order_acquire) & kKeepAlivesClosed) {
+        ReleaseKeepAlive();
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tAccessManager::AcquireKeepAlive
+//
+//  Description:
+//      Adds another keep-alive reference on behalf of a caller that already
+//      holds one. Unlike TryAcquireKeepAlive, this succeeds even once closed.
+//
+//////////////////////////////////////////////////////////////////////////////
+inline void tAccessManager::AcquireKeepAlive()
+{
+    assert(keepAliveState & ~kKeepAlivesClosed);
+    keepAliveState.fetch_add(1, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tAccessManager::ReleaseKeepAlive
+//
+//  Description:
+//      Releases a keep-alive reference.
+//
+//////////////////////////////////////////////////////////////////////////////
+inline void tAccessManager::ReleaseKeepAlive()
+{
+    if (keepAliveState.fetch_sub(1, std::memory_order_release) == (kKeepAlivesClosed | 1)) {
+        keepAlivesReleased.release();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tAccessManager::CloseKeepAlives
+//
+//  Description:
+//      Stops any further keep-alive references from being taken and waits for
+//      the outstanding ones to be released.
+//
+//////////////////////////////////////////////////////////////////////////////
+inline void tAccessManager::CloseKeepAlives()
+{
+    uint32_t state = keepAliveState.fetch_or(kKeepAlivesClosed, std::memory_order_acq_rel);
+    if ((state & ~kKeepAlivesClosed) == 0) {
+        // Nobody is left to signal it
+        keepAlivesReleased.release();
+    }
+    keepAlivesReleased.acquireWithTimeout(-1);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  tAccessManager::DebugAssertActive
@@ -1013,6 +1101,7 @@ inline void tAccessManager::DestroyRequest(tRequest* request)
 //
 //  tAccessManager:DebugGetRefCount/DebugGetActiveCount
 //              DebugGetActiveSharedCount/DebugGetActiveExclusiveCount
+//              DebugGetKeepAliveCount
 //
 //  Description:
 //      Returns counters for testing
@@ -1023,6 +1112,10 @@ inline uint32_t tAccessManager::DebugGetRefCount() const
     std::lock_guard<std::recursive_mutex> lock(criticalSection);
     return refcount;
 }
+inline uint32_t tAccessManager::DebugGetKeepAliveCount() const
+{
+    return keepAliveState & ~kKeepAlivesClosed;
+}
 inline uint32_t tAccessManager::DebugGetActiveCount() const
 {
     std::lock_guard<std::recursive_mutex> lock(criticalSection);
@@ -0,0 +1,132 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#include "CallbackExecutor.h"
+#include "ThreadUtility.h"
+#include <algorithm>
+
+struct CallbackExecutor::Worker
+{
+    std::mutex lock;
+    std::condition_variable taskAvailable;
+    std::deque<Task> tasks;
+    uint64_t affinityGeneration = 0;
+};
+
+static thread_local CallbackExecutor::Worker* currentWorker = nullptr;
+
+CallbackExecutor& GetCallbackExecutor()
+{
+    // Never destroyed, since detached workers may still be waiting on it while the process exits
+    static CallbackExecutor* callbackExecutor = new CallbackExecutor();
+    return *callbackExecutor;
+}
+
+void CallbackExecutor::SetThreadCount(size_t count)
+{
+    std::lock_guard<std::mutex> guard(executorLock);
+    threadCount = count;
+}
+
+size_t CallbackExecutor::GetThreadCount()
+{
+    std::lock_guard<std::mutex> guard(executorLock);
+    return threadCount;
+}
+
+void CallbackExecutor::SetAffinity(uint64_t _cpuMask)
+{
+    ValidateAffinity(_cpuMask);
+    std::lock_guard<std::mutex> guard(executorLock);
+    cpuMask = _cpuMask;
+    ++affinityGeneration;
+    // Each worker applies it to itself the next time it wakes, so wake them all
+    for (auto& worker : workers) {
+        std::lock_guard<std::mutex> workerGuard(worker->lock);
+        worker->taskAvailable.notify_all();
+    }
+}
+
+uint64_t CallbackExecutor::GetAffinity()
+{
+    std::lock_guard<std::mutex> guard(executorLock);
+    return cpuMask;
+}
+
+CallbackExecutor::Worker* CallbackExecutor::AssignWorker(bool required)
+{
+    std::lock_guard<std::mutex> guard(executorLock);
+    if (!threadCount && !required) {
+        return nullptr;
+    }
+    size_t index = nextWorker++ % std::max<size_t>(threadCount, 1);
+    while (workers.size() <= index) {
+        // Like the completion engine's, workers live for the rest of the process
+        std::unique_ptr<Worker> worker(new Worker());
+        auto thread = CreatePriorityThread(boost::bind(&CallbackExecutor::WorkerThread, this, worker.get()), kThreadPriority::Normal, "CallbackWorker");
+        thread.detach();
+        workers.push_back(std::move(worker));
+    }
+    return workers[index].get();
+}
+
+void CallbackExecutor::Submit(Worker* worker, Task task)
+{
+    std::lock_guard<std::mutex> guard(worker->lock);
+    worker->tasks.push_back(std::move(task));
+    worker->taskAvailable.notify_one();
+}
+
+void CallbackExecutor::Flush(Worker* worker)
+{
+    if (currentWorker == worker) {
+        return;
+    }
+    std::mutex flushLock;
+    std::condition_variable flushed;
+    bool done = false;
+    Submit(worker, [&]() {
+        std::lock_guard<std::mutex> guard(flushLock);
+        done = true;
+        flushed.notify_all();
+    });
+    std::unique_lock<std::mutex> guard(flushLock);
+    flushed.wait(guard, [&]() { return done; });
+}
+
+void CallbackExecutor::WorkerThread(Worker* worker)
+{
+    currentWorker = worker;
+    while (true) {
+        uint64_t generation;
+        uint64_t mask;
+        {
+            std::lock_guard<std::mutex> guard(executorLock);
+            generation = affinityGeneration.load();
+            mask = cpuMask;
+        }
+        if (generation != worker->affinityGeneration) {
+            worker->affinityGeneration = generation;
+            try {
+                SetAffinityForCurrentThread(mask);
+            } catch (std::exception&) {
+                // The mask was checked when it was set, so this only fails if CPUs went away since. Keep the old one.
+            }
+        }
+
+        Task task;
+        {
+            std::unique_lock<std::mutex> guard(worker->lock);
+            worker->taskAvailable.wait(guard, [&]() {
+                return !worker->tasks.empty() || worker->affinityGeneration != affinityGeneration.load();
+            });
+            // Anything submitted after an affinity change has to run with the new affinity
+            if (worker->affinityGeneration != affinityGeneration.load()) {
+                continue;
+            }
+            task = std::move(worker->tasks.front());
+            worker->tasks.pop_front();
+        }
+        task();
+    }
+}
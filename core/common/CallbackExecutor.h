@@ -0,0 +1,51 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+// Runs completion callbacks on a small pool of threads of its own, so a slow callback doesn't hold up the threads
+// reaping completions. Everything submitted to one worker runs in the order it was submitted, so each buffer queue
+// sticks to the worker it was given to keep its callbacks in order.
+class CallbackExecutor
+{
+public:
+    typedef std::function<void()> Task;
+    struct Worker;
+
+    // Zero runs callbacks inline on the thread that reaped the completion. Only affects buffer queues created
+    // afterwards, so existing ones keep the worker they were given.
+    void SetThreadCount(size_t count);
+    size_t GetThreadCount();
+    // Bit n lets the workers run on CPU n. Zero lets them run anywhere. Applies to existing workers too.
+    void SetAffinity(uint64_t cpuMask);
+    uint64_t GetAffinity();
+
+    // Returns the worker for a new buffer queue, or nullptr if callbacks should run inline. With required set, a worker
+    // is returned even with no threads configured, for queues whose completions are reaped on shared threads.
+    Worker* AssignWorker(bool required = false);
+    void Submit(Worker* worker, Task task);
+    // Returns once everything submitted to the worker so far has run. Returns right away when called from the
+    // worker itself, since it can't wait on its own queue.
+    void Flush(Worker* worker);
+
+private:
+    void WorkerThread(Worker* worker);
+
+    std::mutex executorLock;
+    std::vector<std::unique_ptr<Worker>> workers;
+    size_t threadCount = 0;
+    size_t nextWorker = 0;
+    uint64_t cpuMask = 0;
+    // Bumped with each affinity change so each worker knows to apply it to itself
+    std::atomic<uint64_t> affinityGeneration{0};
+};
+
+CallbackExecutor& GetCallbackExecutor();
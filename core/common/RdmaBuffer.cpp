@@ -34,25 +34,50 @@ BufferCompletionCallbackData RdmaBuffer::GetAndClearClearCallbackData()
     return copy;
 }
 
-RdmaBufferInternal::RdmaBufferInternal(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, size_t size, size_t index) :
-    RdmaBuffer(_connection, _bufferQueue, index), allocatedBuffer(nullptr)
+RdmaBufferSlab::RdmaBufferSlab(RdmaConnectedSessionBase& connection, size_t size, bool _useHugePages) :
+    allocatedSize(size), useHugePages(_useHugePages)
 {
-    bufferMaxSize = size;
-    bufferSize = size;
+    if (useHugePages) {
+        memory = AllocateHugePageMemory(allocatedSize, connection.GetNumaNode());
+    } else {
+        // Make sure buffers are cache-aligned for best performance
+        memory = AllocateAlignedMemory(allocatedSize, 64);
+    }
+    try {
+        memoryRegion = connection.CreateMemoryRegion(memory, allocatedSize, MemoryAccess::Local);
+    } catch (std::exception&) {
+        FreeMemory();
+        throw;
+    }
+}
+
+RdmaBufferSlab::~RdmaBufferSlab()
+{
+    memoryRegion.reset();
+    FreeMemory();
+}
 
-    // Make sure buffer is cache-aligned for best performance
-    buffer = allocatedBuffer = AllocateAlignedMemory(size, 64);
+void RdmaBufferSlab::FreeMemory()
+{
+    if (useHugePages) {
+        FreeHugePageMemory(memory, allocatedSize);
+    } else {
+        FreeAlignedMemory(memory);
+    }
+    memory = nullptr;
+}
 
-    memoryRegion = connection.CreateMemoryRegion(buffer, bufferSize);
+RdmaBufferInternal::RdmaBufferInternal(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, void* memory, RdmaMemoryRegion* _memoryRegion, size_t size, size_t index) :
+    RdmaBuffer(_connection, _bufferQueue, index), memoryRegion(_memoryRegion)
+{
+    bufferMaxSize = size;
+    bufferSize = size;
+    buffer = memory;
 }
 
 RdmaBufferInternal::~RdmaBufferInternal()
 {
-    memoryRegion.reset();
     buffer = nullptr;
-    if (allocatedBuffer) {
-        FreeAlignedMemory(allocatedBuffer);
-    }
 }
 
 void RdmaBufferInternal::SetBytesToSubmit(size_t size)
@@ -78,8 +103,40 @@ void RdmaBuffer::SetUsed(size_t size)
 
 void RdmaBuffer::HandleCompletion(RdmaError& completionStatus, size_t bytesTransferred)
 {
-    usedBytes = bytesTransferred;
-    bufferQueue.HandleCompletion(*this, completionStatus, false);
+    RdmaBufferCompletion completion;
+    completion.buffer = this;
+    completion.status = completionStatus;
+    completion.bytesTransferred = bytesTransferred;
+    bufferQueue.HandleCompletions(&completion, 1);
+}
+
+RdmaBufferSlot::RdmaBufferSlot(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, RdmaMemoryRegion* _memoryRegion, size_t index) :
+    RdmaBuffer(_connection, _bufferQueue, index), memoryRegion(_memoryRegion)
+{
+}
+
+RdmaBufferSlot::~RdmaBufferSlot()
+{
+}
+
+void RdmaBufferSlot::SetLandedSpan(void* pointer, size_t size)
+{
+    buffer = pointer;
+    bufferSize = size;
+    usedBytes = size;
+    hasSpan = true;
+}
+
+bool RdmaBufferSlot::TakeLandedSpan()
+{
+    if (!hasSpan) {
+        return false;
+    }
+    hasSpan = false;
+    buffer = nullptr;
+    bufferSize = 0;
+    usedBytes = 0;
+    return true;
 }
 
 RdmaBufferExternal::RdmaBufferExternal(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, RdmaMemoryRegion* _memoryRegion, size_t index) :
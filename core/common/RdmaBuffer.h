@@ -6,7 +6,7 @@
 #include <functional>
 #include "RdmaSession.h"
 #include "RdmaMemoryRegion.h"
-#include <boost/intrusive/list.hpp>
+#include <atomic>
 
 class RdmaConnectedSessionBase;
 class RdmaBufferQueue;
@@ -31,6 +31,10 @@ public:
     {
         return usedBytes;
     }
+    uint64_t GetSequenceNumber() const override
+    {
+        return sequenceNumber;
+    }
     void Requeue() override;
     void Release() override;
 
@@ -49,11 +53,43 @@ public:
     void SetCompletionCallback(const BufferCompletionCallbackData& _completionCallbackData);
     virtual void HandleCompletion(RdmaError& completionStatus, size_t bytesTransferred);
     BufferCompletionCallbackData GetAndClearClearCallbackData();
+    RdmaBufferQueue& GetBufferQueue() const
+    {
+        return bufferQueue;
+    }
+    // Unlike SetUsed, this is called from completion context and does not validate against the buffer size
+    void SetCompletedBytes(size_t bytesTransferred)
+    {
+        usedBytes = bytesTransferred;
+    }
+    // Whether the work request posted for this buffer asks for a completion
+    void SetSignaled(bool _signaled)
+    {
+        signaled = _signaled;
+    }
+    bool IsSignaled() const
+    {
+        return signaled;
+    }
+    // Where in the remote ring this buffer lands, when the remote side receives into a ring
+    void SetRemoteOffset(uint64_t offset)
+    {
+        remoteOffset = offset;
+    }
+    uint64_t GetRemoteOffset() const
+    {
+        return remoteOffset;
+    }
+    // Set by the queue, with its lock held, as the buffer completes
+    void SetSequenceNumber(uint64_t _sequenceNumber)
+    {
+        sequenceNumber = _sequenceNumber;
+    }
 
     virtual RdmaMemoryRegion* GetMemoryRegion() = 0;
 
-    // Used to store the buffer into an intrusive list of user-owned buffers
-    boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>> userBufferListNode;
+    // Set while the user owns the buffer. Changes hands without the queue lock when a buffer is acquired.
+    std::atomic<bool> heldByUser{false};
 
 protected:
     size_t bufferIndex = 0;
@@ -62,26 +98,88 @@ protected:
     RdmaConnectedSessionBase& connection;
     RdmaBufferQueue& bufferQueue;
     size_t usedBytes = 0;
+    bool signaled = true;
+    uint64_t remoteOffset = 0;
+    uint64_t sequenceNumber = 0;
     BufferCompletionCallbackData completionCallbackData;
 };
 
+// A single work request completion, translated from the OS-specific completion format so that
+// a batch of them can be retired together
+struct RdmaBufferCompletion
+{
+    // Left null by receives from a shared receive queue, which complete the oldest queued slot
+    RdmaBuffer* buffer = nullptr;
+    RdmaError status;
+    size_t bytesTransferred = 0;
+    // Where the data landed, for receives into a ring or a shared receive queue
+    uint64_t landedOffset = 0;
+};
+
+// One allocation, registered as a single memory region, that all of a queue's buffers are carved from. With
+// hugepages it is also placed on the device's NUMA node.
+class RdmaBufferSlab
+{
+public:
+    RdmaBufferSlab(RdmaConnectedSessionBase& connection, size_t size, bool useHugePages);
+    ~RdmaBufferSlab();
+
+    uint8_t* GetBase() const
+    {
+        return static_cast<uint8_t*>(memory);
+    }
+    RdmaMemoryRegion* GetMemoryRegion() const
+    {
+        return memoryRegion.get();
+    }
+
+protected:
+    void FreeMemory();
+
+    void* memory = nullptr;
+    size_t allocatedSize = 0;
+    bool useHugePages;
+    std::unique_ptr<RdmaMemoryRegion> memoryRegion;
+};
+
 class RdmaBufferInternal : public RdmaBuffer
 {
 public:
-    RdmaBufferInternal(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, size_t size, size_t index);
+    // Uses memory owned by the queue, within a slab or a pool that is registered as a whole
+    RdmaBufferInternal(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, void* memory, RdmaMemoryRegion* _memoryRegion, size_t size, size_t index);
     virtual ~RdmaBufferInternal();
     void SetBytesToSubmit(size_t size);
     RdmaMemoryRegion* GetMemoryRegion()
     {
-        return memoryRegion.get();
+        return memoryRegion;
     }
 
 protected:
-    std::unique_ptr<RdmaMemoryRegion> memoryRegion;
-    void* allocatedBuffer;
+    RdmaMemoryRegion* memoryRegion;
     size_t bufferMaxSize = 0;
 };
 
+// A receive slot without memory of its own, used with a ring or a shared receive queue. Once data has
+// landed somewhere in the shared memory, it describes where until it is requeued.
+class RdmaBufferSlot : public RdmaBuffer
+{
+public:
+    RdmaBufferSlot(RdmaConnectedSessionBase& _connection, RdmaBufferQueue& _bufferQueue, RdmaMemoryRegion* _memoryRegion, size_t index);
+    virtual ~RdmaBufferSlot();
+
+    void SetLandedSpan(void* pointer, size_t size);
+    // Returns false if nothing has landed since the slot was last queued
+    bool TakeLandedSpan();
+    RdmaMemoryRegion* GetMemoryRegion()
+    {
+        return memoryRegion;
+    }
+
+protected:
+    RdmaMemoryRegion* memoryRegion;
+    bool hasSpan = false;
+};
+
 class RdmaBufferExternal : public RdmaBuffer
 {
 public:
@@ -0,0 +1,70 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#include "RdmaBufferPool.h"
+#include "RdmaCommon.h"
+#include "RdmaRegistrationCache.h"
+#include <limits>
+
+RdmaBufferPool::RdmaBufferPool(const RdmaAddress& localAddress, size_t _bufferSize, size_t numBuffers, bool _useHugePages) :
+    bufferSize(_bufferSize), useHugePages(_useHugePages)
+{
+    if (!bufferSize || !numBuffers) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    // Every buffer starts on a cache line, as with a queue's own buffers
+    size_t stride = (bufferSize + 63) & ~static_cast<size_t>(63);
+    if (stride < bufferSize || numBuffers > std::numeric_limits<size_t>::max() / stride) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    allocatedSize = stride * numBuffers;
+    if (useHugePages) {
+        memory = AllocateHugePageMemory(allocatedSize, -1);
+    } else {
+        memory = AllocateAlignedMemory(allocatedSize, 64);
+    }
+    try {
+        GetRegistrationCache().Register(localAddress, memory, allocatedSize, MemoryAccess::Local, false);
+    } catch (std::exception&) {
+        FreeMemory();
+        throw;
+    }
+    freeBuffers.reserve(numBuffers);
+    // Handed out from the back, so the first sessions get the start of the pool
+    for (size_t i = numBuffers; i > 0; --i) {
+        freeBuffers.push_back(static_cast<uint8_t*>(memory) + (i - 1) * stride);
+    }
+}
+
+RdmaBufferPool::~RdmaBufferPool()
+{
+    GetRegistrationCache().Unregister(memory);
+    FreeMemory();
+}
+
+void RdmaBufferPool::FreeMemory()
+{
+    if (useHugePages) {
+        FreeHugePageMemory(memory, allocatedSize);
+    } else {
+        FreeAlignedMemory(memory);
+    }
+    memory = nullptr;
+}
+
+std::vector<uint8_t*> RdmaBufferPool::TakeBuffers(size_t numBuffers)
+{
+    std::lock_guard<std::mutex> guard(poolLock);
+    if (numBuffers > freeBuffers.size()) {
+        RDMA_THROW(easyrdma_Error_OutOfMemory);
+    }
+    std::vector<uint8_t*> taken(freeBuffers.end() - numBuffers, freeBuffers.end());
+    freeBuffers.resize(freeBuffers.size() - numBuffers);
+    return taken;
+}
+
+void RdmaBufferPool::ReturnBuffers(const std::vector<uint8_t*>& buffers)
+{
+    std::lock_guard<std::mutex> guard(poolLock);
+    freeBuffers.insert(freeBuffers.end(), buffers.begin(), buffers.end());
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaAddress.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+// Fixed-size buffers allocated and registered once, that the internal buffer queues of any number of sessions draw
+// from instead of each allocating and registering their own. The memory is registered through the registration cache
+// on the device behind the pool's address, so sessions on that device find the registration already there. Sessions
+// hold the pool for as long as they have buffers from it, so destroying it only stops new sessions from using it.
+class RdmaBufferPool
+{
+public:
+    RdmaBufferPool(const RdmaAddress& localAddress, size_t bufferSize, size_t numBuffers, bool useHugePages);
+    ~RdmaBufferPool();
+
+    void* GetBase() const
+    {
+        return memory;
+    }
+    size_t GetSize() const
+    {
+        return allocatedSize;
+    }
+    size_t GetBufferSize() const
+    {
+        return bufferSize;
+    }
+    // Throws OutOfMemory, rather than growing the pool, if fewer than numBuffers are free
+    std::vector<uint8_t*> TakeBuffers(size_t numBuffers);
+    void ReturnBuffers(const std::vector<uint8_t*>& buffers);
+
+protected:
+    void FreeMemory();
+
+    void* memory = nullptr;
+    size_t allocatedSize = 0;
+    size_t bufferSize;
+    bool useHugePages;
+    std::mutex poolLock;
+    std::vector<uint8_t*> freeBuffers;
+};
@@ -5,12 +5,75 @@
 #include "RdmaBuffer.h"
 #include "RdmaConnectedSessionBase.h"
 #include "RdmaBufferQueue.h"
+#include "CompletionNotifier.h"
+#include "ThreadUtility.h"
+#include <algorithm>
 #include <assert.h>
+#include <limits>
+#include <thread>
+
+// Parks on cond until ready() holds or the timeout expires. The waiter count lets producers skip the notify
+// when nobody is parked, which is safe since they update the fifos with the lock held.
+template <typename Predicate>
+static bool WaitUntilReady(std::condition_variable& cond, size_t& waiters, std::unique_lock<std::mutex>& guard, int32_t timeoutMs, Predicate ready)
+{
+    if (ready()) {
+        return true;
+    }
+    // Parking would only cost a pair of futex calls to find out what we already know
+    if (timeoutMs == 0) {
+        return false;
+    }
+    ++waiters;
+    bool result = true;
+    if (timeoutMs == -1) {
+        cond.wait(guard, ready);
+    } else {
+        result = cond.wait_for(guard, std::chrono::milliseconds(timeoutMs), ready);
+    }
+    --waiters;
+    return result;
+}
+
+// Waits without the lock for up to the spin budget, busy-polling for the first half of it and yielding the CPU
+// between checks for the second half. Whatever is spent comes off the caller's timeout.
+template <typename Predicate>
+static bool SpinUntilReady(uint64_t budgetUs, int32_t& timeoutMs, Predicate ready)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration budget = std::chrono::microseconds(budgetUs);
+    if (timeoutMs != -1) {
+        budget = std::min(budget, std::chrono::steady_clock::duration(std::chrono::milliseconds(timeoutMs)));
+    }
+    bool result = false;
+    while (true) {
+        if (ready()) {
+            result = true;
+            break;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= budget) {
+            break;
+        }
+        if (elapsed * 2 < budget) {
+            CpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    if (timeoutMs != -1) {
+        auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        timeoutMs = static_cast<int32_t>(std::max<int64_t>(0, timeoutMs - elapsedMs));
+    }
+    return result;
+}
 
 RdmaBufferQueue::RdmaBufferQueue(RdmaConnectedSessionBase& _connection, Direction _direction, bool _usePolling) :
     connection(_connection), direction(_direction), aborted(false), usePolling(_usePolling)
 {
     putBackToIdleOnCompletion = (direction == Direction::Send);
+    // Completion engine threads are shared with other sessions, so user callbacks never run inline on them
+    callbackWorker = GetCallbackExecutor().AssignWorker(connection.UsesCompletionEngine());
 #ifdef _WIN32
     if (usePolling) {
         RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable on Windows
@@ -24,13 +87,11 @@ RdmaBufferQueue::RdmaBufferQueue(RdmaConnectedSessionBase& _connection, Directio
 RdmaBufferQueue::~RdmaBufferQueue()
 {
     Abort(easyrdma_Error_OperationCancelled);
+    // The caller is free to destroy its callback contexts once the session is gone. This is not done on Abort,
+    // since a callback waiting on access to the session being aborted would never finish.
+    FlushCallbacks();
     assert(!buffersQueuedWaitingForCredits.size());
     assert(!queuedBuffers.size());
-    // Release buffers from userBuffers list before destroying
-    // the buffers themselves since the ITL container asserts
-    while (userBuffers.size()) {
-        userBuffers.pop_front();
-    }
     buffers.clear();
 }
 
@@ -38,19 +99,21 @@ void RdmaBufferQueue::Abort(int32_t errorCode)
 {
     // Ensure callbacks are called outside of our mutex, so that the caller can potentially
     // call back into our API from within the callback without deadlocking
-    std::vector<BufferCompletionCallbackData> callbacksToFire;
+    std::vector<PendingCallback> callbacksToFire;
     {
         std::lock_guard<std::mutex> guard(queueLock);
         if (aborted) {
             return;
         }
         aborted = true;
-        RDMA_SET_ERROR(queueStatus, errorCode);
+        RdmaError status;
+        RDMA_SET_ERROR(status, errorCode);
+        SetQueueStatus(status);
         while (queuedBuffers.size()) {
             auto& buffer = queuedBuffers.front();
             auto callbackData = buffer->GetAndClearClearCallbackData();
             if (callbackData.IsSet()) {
-                callbacksToFire.push_back(callbackData);
+                callbacksToFire.push_back({callbackData, errorCode, 0});
             }
             queuedBuffers.pop();
             idleBuffers.push(buffer);
@@ -59,200 +122,498 @@ void RdmaBufferQueue::Abort(int32_t errorCode)
             auto& buffer = buffersQueuedWaitingForCredits.front();
             auto callbackData = buffer->GetAndClearClearCallbackData();
             if (callbackData.IsSet()) {
-                callbacksToFire.push_back(callbackData);
+                callbacksToFire.push_back({callbackData, errorCode, 0});
             }
             buffersQueuedWaitingForCredits.pop();
             idleBuffers.push(buffer);
         }
         completedAvailableCond.notify_all();
         idleAvailableCond.notify_all();
+        if (completionNotifier) {
+            completionNotifier->Signal();
+        }
     }
-    for (auto& callback : callbacksToFire) {
-        callback.Call(errorCode, 0);
-    }
+    FireCallbacks(callbacksToFire);
 }
 
 RdmaBuffer* RdmaBufferQueue::WaitForIdleBuffer(int32_t timeoutMs)
 {
+    RdmaError status;
+    RdmaBuffer* buffer = WaitForIdleBuffer(timeoutMs, status);
+    if (!buffer) {
+        throw RdmaException(status);
+    }
+    return buffer;
+}
+
+RdmaBuffer* RdmaBufferQueue::WaitForIdleBuffer(int32_t timeoutMs, RdmaError& status)
+{
+    RdmaBuffer* buffer = nullptr;
+    if (!failed.load(std::memory_order_acquire) && idleBuffers.pop(buffer)) {
+        GiveToUser(buffer);
+        return buffer;
+    }
     std::unique_lock<std::mutex> guard(queueLock);
-    if ((idleBuffers.size() == 0) && !queueStatus.IsError()) {
-        if (timeoutMs == -1) {
-            idleAvailableCond.wait(guard);
+    uint64_t budgetUs = spinBudgetUs.load(std::memory_order_relaxed);
+    if (budgetUs && timeoutMs && !queueStatus.IsError() && !idleBuffers.pop(buffer)) {
+        guard.unlock();
+        SpinUntilReady(budgetUs, timeoutMs, [&]() {
+            return failed.load(std::memory_order_acquire) || idleBuffers.pop(buffer);
+        });
+        guard.lock();
+    }
+    if (!buffer) {
+        WaitUntilReady(idleAvailableCond, idleWaiters, guard, timeoutMs, [&]() {
+            return queueStatus.IsError() || idleBuffers.pop(buffer);
+        });
+    }
+    if (!buffer) {
+        if (queueStatus.IsError()) {
+            status.Assign(queueStatus);
         } else {
-            auto result = idleAvailableCond.wait_for(guard, std::chrono::milliseconds(timeoutMs));
-            if (result == std::cv_status::timeout) {
-                RDMA_THROW(easyrdma_Error_Timeout);
-            }
+            RDMA_SET_ERROR(status, easyrdma_Error_Timeout);
         }
-    }
-    if (queueStatus.IsError()) {
-        throw RdmaException(queueStatus);
         return nullptr;
     }
-    if (!idleBuffers.size()) {
-        RDMA_THROW(easyrdma_Error_Timeout);
-    }
-    RdmaBuffer* buffer = idleBuffers.front();
-    idleBuffers.pop();
-    userBuffers.push_back(*buffer);
+    GiveToUser(buffer);
     return buffer;
 }
 
 RdmaBuffer* RdmaBufferQueue::WaitForCompletedBuffer(int32_t timeoutMs)
 {
-    std::unique_lock<std::mutex> guard(queueLock);
+    RdmaBuffer* buffer = nullptr;
+    WaitForCompletedBuffers(&buffer, 1, 1, timeoutMs);
+    return buffer;
+}
+
+size_t RdmaBufferQueue::WaitForCompletedBuffers(RdmaBuffer** buffersOut, size_t minBuffers, size_t maxBuffers, int32_t timeoutMs)
+{
+    RdmaError status;
+    size_t numTaken = WaitForCompletedBuffers(buffersOut, minBuffers, maxBuffers, timeoutMs, status);
+    if (!numTaken) {
+        throw RdmaException(status);
+    }
+    return numTaken;
+}
+
+size_t RdmaBufferQueue::WaitForCompletedBuffers(RdmaBuffer** buffersOut, size_t minBuffers, size_t maxBuffers, int32_t timeoutMs, RdmaError& status)
+{
     if (putBackToIdleOnCompletion) {
         RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable for this situation
     }
-    if ((completedBuffers.size() == 0) && !queueStatus.IsError()) {
-        if (queuedBuffers.size() == 0 && buffersQueuedWaitingForCredits.size() == 0) {
-            RDMA_THROW(easyrdma_Error_NoBuffersQueued);
+    if (!minBuffers || minBuffers > maxBuffers) {
+        RDMA_THROW(easyrdma_Error_InvalidArgument);
+    }
+    size_t numTaken = 0;
+    auto takeCompleted = [&]() {
+        while (numTaken < maxBuffers && completedBuffers.pop(buffersOut[numTaken])) {
+            GiveToUser(buffersOut[numTaken]);
+            ++numTaken;
+        }
+        return numTaken >= minBuffers;
+    };
+    if (takeCompleted()) {
+        return numTaken;
+    }
+    std::unique_lock<std::mutex> guard(queueLock);
+    // Errors from polling on our behalf are only reported if nothing was taken
+    RdmaError pollStatus;
+    if (!takeCompleted() && !queueStatus.IsError()) {
+        if (!numTaken && queuedBuffers.size() == 0 && buffersQueuedWaitingForCredits.size() == 0) {
+            RDMA_SET_ERROR(status, easyrdma_Error_NoBuffersQueued);
+            return 0;
         }
         if (usePolling) {
-            queueLock.unlock();
-            connection.PollForReceive(timeoutMs);
-            queueLock.lock();
-        } else {
-            if (timeoutMs == -1) {
-                completedAvailableCond.wait(guard);
-            } else {
-                auto result = completedAvailableCond.wait_for(guard, std::chrono::milliseconds(timeoutMs));
-                if (result == std::cv_status::timeout) {
-                    RDMA_THROW(easyrdma_Error_Timeout);
+            auto start = std::chrono::steady_clock::now();
+            auto remainingMs = [&]() {
+                if (timeoutMs == -1) {
+                    return timeoutMs;
+                }
+                auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+                return static_cast<int32_t>(std::max<int64_t>(0, timeoutMs - elapsedMs));
+            };
+            // Only one waiter polls at a time, so that completions are retired in the order they were reaped. Any
+            // others park until it hands them buffers or leaves, in which case one of them takes over.
+            bool timedOut = false;
+            while (!timedOut && !pollStatus.IsError() && !takeCompleted() && !queueStatus.IsError()) {
+                if (pollerActive) {
+                    timedOut = !WaitUntilReady(completedAvailableCond, completedWaiters, guard, remainingMs(), [&]() {
+                        return takeCompleted() || queueStatus.IsError() || !pollerActive;
+                    });
+                    continue;
+                }
+                pollerActive = true;
+                guard.unlock();
+                try {
+                    do {
+                        if (!connection.PollForReceive(remainingMs())) {
+                            timedOut = true;
+                            break;
+                        }
+                    } while (!takeCompleted());
+                } catch (RdmaException& e) {
+                    pollStatus.Assign(e.rdmaError);
+                }
+                guard.lock();
+                pollerActive = false;
+                if (completedWaiters) {
+                    completedAvailableCond.notify_all();
                 }
             }
+        } else {
+            uint64_t budgetUs = spinBudgetUs.load(std::memory_order_relaxed);
+            if (budgetUs && timeoutMs) {
+                guard.unlock();
+                SpinUntilReady(budgetUs, timeoutMs, [&]() {
+                    return takeCompleted() || failed.load(std::memory_order_acquire);
+                });
+                guard.lock();
+            }
+            // Buffers that completed before the queue failed (such as from a disconnection) are still returned
+            WaitUntilReady(completedAvailableCond, completedWaiters, guard, timeoutMs, [&]() {
+                return takeCompleted() || queueStatus.IsError();
+            });
         }
     }
-    // If we have an error in the queue (such as disconnection) but we have a completed
-    // buffer, we can return it without erroring
-    if (queueStatus.IsError() && completedBuffers.size() == 0) {
-        throw RdmaException(queueStatus);
-        return nullptr;
+    // Falling short of the minimum still hands back whatever was taken. It is only an error if nothing was.
+    if (!numTaken) {
+        if (pollStatus.IsError()) {
+            status.Assign(pollStatus);
+        } else if (queueStatus.IsError()) {
+            status.Assign(queueStatus);
+        } else {
+            RDMA_SET_ERROR(status, easyrdma_Error_Timeout);
+        }
     }
-    if (!completedBuffers.size()) {
-        RDMA_THROW(easyrdma_Error_Timeout);
+    return numTaken;
+}
+
+RdmaBuffer* RdmaBufferQueue::TryGetCompletedBuffer()
+{
+    RdmaBuffer* buffer = nullptr;
+    if (!completedBuffers.pop(buffer)) {
+        if (failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> guard(queueLock);
+            throw RdmaException(queueStatus);
+        }
+        return nullptr;
     }
-    RdmaBuffer* buffer = completedBuffers.front();
-    completedBuffers.pop();
-    userBuffers.push_back(*buffer);
+    GiveToUser(buffer);
     return buffer;
 }
 
-void RdmaBufferQueue::HandleCompletion(RdmaBuffer& buffer, RdmaError& completionStatus, bool putBackToIdle)
+void RdmaBufferQueue::GiveToUser(RdmaBuffer* buffer)
+{
+    buffer->heldByUser.store(true, std::memory_order_release);
+    numUserBuffers.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RdmaBufferQueue::SetQueueStatus(const RdmaError& status)
+{
+    // Called with the lock held
+    queueStatus.Assign(status);
+    failed.store(queueStatus.IsError(), std::memory_order_release);
+}
+
+void RdmaBufferQueue::HandleCompletions(RdmaBufferCompletion* completions, size_t numCompletions)
 {
     // Cache and clear completion data before returning it to the accessible queues. Once
     // it has been returned it could get queued again.
     // Ensure callbacks are called outside of our mutex, so that the caller can potentially
-    // call back into our API from within the callback without deadlockin
-    BufferCompletionCallbackData cachedCompletionData;
-    size_t completedBytes = 0;
+    // call back into our API from within the callback without deadlocking
+    std::vector<PendingCallback> callbacksToFire;
 
     {
         std::lock_guard<std::mutex> guard(queueLock);
 
-        if (!aborted) {
-            cachedCompletionData = buffer.GetAndClearClearCallbackData();
-            completedBytes = buffer.GetUsed();
+        if (aborted) {
+            for (size_t i = 0; i < numCompletions; ++i) {
+                DiscardCompletion(completions[i]);
+            }
+        } else {
+            auto retireFront = [&](int32_t status) {
+                RdmaBuffer* buffer = queuedBuffers.front();
+                auto callbackData = buffer->GetAndClearClearCallbackData();
+                if (callbackData.IsSet()) {
+                    callbacksToFire.push_back({callbackData, status, buffer->GetUsed()});
+                }
+                queuedBuffers.pop();
+                if (!putBackToIdleOnCompletion) {
+                    buffer->SetSequenceNumber(nextSequenceNumber++);
+                    completedBuffers.push(buffer);
+                } else {
+                    idleBuffers.push(buffer);
+                }
+            };
+            for (size_t i = 0; i < numCompletions; ++i) {
+                if (!completions[i].buffer) {
+                    // Receives from a shared queue are only known by where they landed. Ours complete in order,
+                    // so each one belongs to the oldest slot still queued.
+                    ASSERT_ALWAYS(queuedBuffers.size());
+                    completions[i].buffer = queuedBuffers.front();
+                }
+                RdmaBuffer& buffer = *completions[i].buffer;
+                buffer.SetCompletedBytes(completions[i].bytesTransferred);
+                PrepareCompletedBuffer(&buffer, completions[i]);
 
-            // Buffers should be completed in-order
-            ASSERT_ALWAYS(&buffer == queuedBuffers.front());
-            queuedBuffers.pop();
+                // Sends posted without a completion request never show up here. Since an RC QP completes
+                // work requests in order, they have all succeeded by the time a later send completes.
+                while (queuedBuffers.size() && queuedBuffers.front() != &buffer && !queuedBuffers.front()->IsSignaled()) {
+                    retireFront(easyrdma_Error_Success);
+                }
+
+                // Buffers should be completed in-order
+                ASSERT_ALWAYS(&buffer == queuedBuffers.front());
+                retireFront(completions[i].status.GetCode());
+                if (completions[i].status.IsError()) {
+                    SetQueueStatus(completions[i].status);
+                }
+            }
+            // Wake waiters once for the whole batch rather than once per buffer, and only if anyone is parked
             if (!putBackToIdleOnCompletion) {
-                completedBuffers.push(&buffer);
-                completedAvailableCond.notify_all();
-            } else {
-                idleBuffers.push(&buffer);
+                if (completedWaiters) {
+                    completedAvailableCond.notify_all();
+                }
+            } else if (idleWaiters) {
                 idleAvailableCond.notify_all();
             }
-
             if (queuedBuffers.empty()) {
                 noneQueuedCond.notify_all();
             }
-            if (completionStatus.IsError()) {
-                queueStatus.Assign(completionStatus);
+            if (completionNotifier && numCompletions) {
+                completionNotifier->Signal();
             }
         }
     }
-    cachedCompletionData.Call(completionStatus.GetCode(), completedBytes);
+    FireCallbacks(callbacksToFire);
+}
+
+void RdmaBufferQueue::FlushCallbacks()
+{
+    if (callbackWorker) {
+        GetCallbackExecutor().Flush(callbackWorker);
+    }
+}
+
+void RdmaBufferQueue::FireCallbacks(std::vector<PendingCallback>& callbacks)
+{
+    if (callbacks.empty()) {
+        return;
+    }
+    if (!callbackWorker) {
+        for (auto& callback : callbacks) {
+            callback.callbackData.Call(callback.status, callback.completedBytes);
+        }
+        return;
+    }
+    // The whole batch goes as one task, which keeps it in order behind anything this queue submitted earlier
+    GetCallbackExecutor().Submit(callbackWorker, [batch = std::move(callbacks)]() mutable {
+        for (auto& callback : batch) {
+            callback.callbackData.Call(callback.status, callback.completedBytes);
+        }
+    });
+}
+
+void RdmaBufferQueue::CompleteOldest(const uint64_t* bytesTransferred, size_t numCompletions)
+{
+    std::vector<RdmaBufferCompletion> completions(numCompletions);
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        if (aborted) {
+            return;
+        }
+        ASSERT_ALWAYS(numCompletions <= queuedBuffers.size());
+        for (size_t i = 0; i < numCompletions; ++i) {
+            completions[i].buffer = queuedBuffers.at(i);
+            completions[i].bytesTransferred = bytesTransferred[i];
+        }
+    }
+    HandleCompletions(completions.data(), completions.size());
+}
+
+void RdmaBufferQueue::SetSignalInterval(size_t interval)
+{
+    std::lock_guard<std::mutex> guard(queueLock);
+    signalInterval = interval;
+}
+
+void RdmaBufferQueue::SetSpinBudget(uint64_t budgetUs)
+{
+    spinBudgetUs.store(budgetUs, std::memory_order_relaxed);
+}
+
+void RdmaBufferQueue::SetCompletionNotifier(CompletionNotifier* notifier)
+{
+    std::lock_guard<std::mutex> guard(queueLock);
+    completionNotifier = notifier;
+    // Anything that completed before the notifier was attached would otherwise go unannounced
+    bool ready = putBackToIdleOnCompletion ? !idleBuffers.empty() : !completedBuffers.empty();
+    if (completionNotifier && (ready || queueStatus.IsError())) {
+        completionNotifier->Signal();
+    }
+}
+
+void RdmaBufferQueue::UpdateSignaling(RdmaBuffer* buffer)
+{
+    // Called with the lock held as a send buffer is moved to the queued list. Every Nth send asks for a
+    // completion, which then retires the unsignaled sends ahead of it. A send that leaves no idle buffers
+    // behind it is always signaled so that a sender waiting for an idle buffer is guaranteed to wake up.
+    if (direction != Direction::Send) {
+        return;
+    }
+    bool signaled = (++sendsSinceSignal >= signalInterval) || idleBuffers.empty();
+    if (signaled) {
+        sendsSinceSignal = 0;
+    }
+    buffer->SetSignaled(signaled);
 }
 
 void RdmaBufferQueue::QueueBuffer(RdmaBuffer* buffer, IgnoreCredits ignoreCredits)
 {
-    bool queueToQp = false;
+    QueueBuffers(&buffer, 1, ignoreCredits);
+}
+
+void RdmaBufferQueue::QueueBuffers(RdmaBuffer** buffersToQueue, size_t numBuffers, IgnoreCredits ignoreCredits, uint64_t* creditsOut)
+{
+    // Buffers that can go to the QP right away always form a prefix of the passed-in array, since once
+    // one buffer has to wait for credits all the ones after it must wait as well to preserve ordering
+    size_t numToQueueToQp = 0;
+    RdmaError queueError;
+    std::lock_guard<std::mutex> postGuard(postLock);
     {
         std::lock_guard<std::mutex> guard(queueLock);
         if (queueStatus.IsError()) {
             throw RdmaException(queueStatus);
         }
-        if (!buffer->userBufferListNode.is_linked()) {
-            RDMA_THROW(easyrdma_Error_InvalidOperation);
+        // Take ownership of every buffer before touching the queues so that an invalid (or duplicated)
+        // buffer in the middle of the batch leaves all of them with the user
+        for (size_t i = 0; i < numBuffers; ++i) {
+            if (!buffersToQueue[i]->heldByUser.exchange(false, std::memory_order_acq_rel)) {
+                for (size_t j = 0; j < i; ++j) {
+                    buffersToQueue[j]->heldByUser.store(true, std::memory_order_release);
+                }
+                RDMA_THROW(easyrdma_Error_InvalidOperation);
+            }
         }
-        if (direction == Direction::Send && ignoreCredits == IgnoreCredits::No) {
-            if (availableCredits.size()) {
-                uint64_t poppedCreditSize = availableCredits.front();
-                try {
-                    if (buffer->GetUsed() > poppedCreditSize) {
-                        RDMA_THROW(easyrdma_Error_SendTooLargeForRecvBuffer);
+        numUserBuffers.fetch_sub(numBuffers, std::memory_order_relaxed);
+        size_t i = 0;
+        try {
+            for (; i < numBuffers; ++i) {
+                RdmaBuffer* buffer = buffersToQueue[i];
+                if (direction == Direction::Send && ignoreCredits == IgnoreCredits::No) {
+                    if (buffersQueuedWaitingForCredits.empty() && TryConsumeCredit(buffer)) {
+                        UpdateSignaling(buffer);
+                        queuedBuffers.push(buffer);
+                        ++numToQueueToQp;
+                    } else {
+                        buffersQueuedWaitingForCredits.push(buffer);
+                    }
+                } else {
+                    if (creditsOut) {
+                        creditsOut[i] = TakeReceiveCredit(buffer);
                     }
-                    queueToQp = true;
+                    UpdateSignaling(buffer);
                     queuedBuffers.push(buffer);
-                    availableCredits.pop();
-                } catch (const RdmaException& e) {
-                    // Store error in global queue status, then re-throw to caller
-                    queueStatus.Assign(e.rdmaError);
-                    throw;
+                    ++numToQueueToQp;
                 }
-            } else {
-                buffersQueuedWaitingForCredits.push(buffer);
             }
-        } else {
-            queueToQp = true;
-            queuedBuffers.push(buffer);
+        } catch (const RdmaException& e) {
+            // Store error in global queue status, then re-throw to caller once anything ahead of the
+            // offending buffer has been handed to the QP. The rest of the batch goes back to the user.
+            SetQueueStatus(e.rdmaError);
+            queueError.Assign(e.rdmaError);
+            for (; i < numBuffers; ++i) {
+                GiveToUser(buffersToQueue[i]);
+            }
         }
-        // Remove from userBuffers only after nothing above threw
-        buffer->userBufferListNode.unlink();
     }
-    if (queueToQp) {
-        connection.QueueToQp(direction, buffer);
+    if (numToQueueToQp) {
+        connection.QueueToQp(direction, buffersToQueue, numToQueueToQp);
+    }
+    if (queueError.IsError()) {
+        throw RdmaException(queueError);
     }
 }
 
-void RdmaBufferQueue::AddCredit(uint64_t bufferSize)
+bool RdmaBufferQueue::TryConsumeCredit(RdmaBuffer* buffer)
 {
-    RdmaBuffer* bufferToQueueToQp = nullptr;
-    try {
-        {
-            std::lock_guard<std::mutex> guard(queueLock);
-            availableCredits.push(bufferSize);
-            if (buffersQueuedWaitingForCredits.size()) {
-                uint64_t poppedCreditSize = availableCredits.front();
-                bufferToQueueToQp = buffersQueuedWaitingForCredits.front();
-                if (bufferToQueueToQp->GetUsed() > poppedCreditSize) {
-                    RDMA_THROW(easyrdma_Error_SendTooLargeForRecvBuffer);
-                }
+    // Called with the lock held. Throws if the buffer can never fit on the other side.
+    if (creditWindow.enabled()) {
+        if (buffer->GetUsed() > creditWindow.ringSize()) {
+            RDMA_THROW(easyrdma_Error_SendTooLargeForRecvBuffer);
+        }
+        uint64_t offset = 0;
+        if (!creditWindow.reserve(buffer->GetUsed(), offset)) {
+            return false;
+        }
+        buffer->SetRemoteOffset(offset);
+        return true;
+    }
+    if (availableCredits.empty()) {
+        return false;
+    }
+    if (buffer->GetUsed() > availableCredits.front()) {
+        RDMA_THROW(easyrdma_Error_SendTooLargeForRecvBuffer);
+    }
+    availableCredits.pop();
+    return true;
+}
+
+void RdmaBufferQueue::EnableCreditWindow(uint64_t ringSize)
+{
+    std::lock_guard<std::mutex> guard(queueLock);
+    assert(direction == Direction::Send && availableCredits.empty());
+    creditWindow.reset(ringSize);
+}
+
+void RdmaBufferQueue::AddCredits(const uint64_t* credits, size_t numCredits)
+{
+    std::vector<RdmaBuffer*> buffersToQueueToQp;
+    RdmaError queueError;
+    std::lock_guard<std::mutex> postGuard(postLock);
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        for (size_t i = 0; i < numCredits; ++i) {
+            if (creditWindow.enabled()) {
+                creditWindow.addCredit(credits[i]);
+            } else {
+                availableCredits.push(credits[i]);
+            }
+        }
+        try {
+            while (buffersQueuedWaitingForCredits.size() && TryConsumeCredit(buffersQueuedWaitingForCredits.front())) {
+                RdmaBuffer* bufferToQueueToQp = buffersQueuedWaitingForCredits.front();
                 buffersQueuedWaitingForCredits.pop();
+                UpdateSignaling(bufferToQueueToQp);
                 queuedBuffers.push(bufferToQueueToQp);
-                availableCredits.pop();
+                buffersToQueueToQp.push_back(bufferToQueueToQp);
             }
+        } catch (const RdmaException& e) {
+            // Store error in global queue status, then re-throw to caller once anything that
+            // was already moved to the queued list has been handed to the QP
+            SetQueueStatus(e.rdmaError);
+            queueError.Assign(e.rdmaError);
         }
-        if (bufferToQueueToQp) {
-            connection.QueueToQp(direction, bufferToQueueToQp);
-        }
-    } catch (const RdmaException& e) {
-        // Store error in global queue status, then re-throw to caller
-        queueStatus.Assign(e.rdmaError);
-        throw;
+    }
+    if (buffersToQueueToQp.size()) {
+        connection.QueueToQp(direction, buffersToQueueToQp.data(), buffersToQueueToQp.size());
+    }
+    if (queueError.IsError()) {
+        throw RdmaException(queueError);
     }
 }
 
 void RdmaBufferQueue::ReleaseBuffer(RdmaBuffer* buffer)
 {
     std::lock_guard<std::mutex> guard(queueLock);
-    if (!buffer->userBufferListNode.is_linked()) {
+    if (!buffer->heldByUser.exchange(false, std::memory_order_acq_rel)) {
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     }
-    buffer->userBufferListNode.unlink();
+    numUserBuffers.fetch_sub(1, std::memory_order_relaxed);
     idleBuffers.push(buffer);
+    if (idleWaiters) {
+        idleAvailableCond.notify_all();
+    }
 }
 
 PropertyData RdmaBufferQueue::GetProperty(uint32_t propertyId)
@@ -264,7 +625,7 @@ PropertyData RdmaBufferQueue::GetProperty(uint32_t propertyId)
             return PropertyData(numQueued);
         }
         case easyrdma_Property_UserBuffers: {
-            uint64_t numUser = userBuffers.size();
+            uint64_t numUser = numUserBuffers.load();
             return PropertyData(numUser);
         }
         default:
@@ -274,8 +635,7 @@ PropertyData RdmaBufferQueue::GetProperty(uint32_t propertyId)
 
 bool RdmaBufferQueue::HasUserBuffersOutstanding()
 {
-    std::lock_guard<std::mutex> guard(queueLock);
-    return !userBuffers.empty();
+    return numUserBuffers.load() != 0;
 }
 
 RdmaError RdmaBufferQueue::GetQueueStatus()
@@ -293,22 +653,64 @@ void RdmaBufferQueue::AllocateBufferQueues(size_t numBuffers)
     buffersQueuedWaitingForCredits.reallocate(numBuffers);
 }
 
-RdmaBufferQueueMultipleBuffer::RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling) :
+RdmaBufferQueueMultipleBuffer::RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling, bool useHugePages) :
     RdmaBufferQueue(_connection, _direction, _usePolling)
 {
     AllocateBufferQueues(numBuffers);
+    // Every buffer in the slab still starts on a cache line
+    size_t stride = std::max<size_t>((bufferSize + 63) & ~static_cast<size_t>(63), 64);
+    if (stride < bufferSize || numBuffers > std::numeric_limits<size_t>::max() / stride) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    // One allocation and one registration for the whole queue, rather than one per buffer
+    slab.reset(new RdmaBufferSlab(_connection, stride * std::max<size_t>(numBuffers, 1), useHugePages));
     size_t index = 0;
     for (auto& buffer : buffers) {
-        buffer.reset(new RdmaBufferInternal(_connection, *this, bufferSize, index++));
+        buffer.reset(new RdmaBufferInternal(_connection, *this, slab->GetBase() + index * stride, slab->GetMemoryRegion(), bufferSize, index));
+        ++index;
         idleBuffers.push(buffer.get());
     }
 }
 
-RdmaBufferQueueSingleBuffer::RdmaBufferQueueSingleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, void* _buffer, size_t _bufferSize, size_t numOverlapped, bool _usePolling) :
+RdmaBufferQueueMultipleBuffer::RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling, const std::shared_ptr<RdmaBufferPool>& _pool) :
+    RdmaBufferQueue(_connection, _direction, _usePolling), pool(_pool)
+{
+    if (bufferSize > pool->GetBufferSize()) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    AllocateBufferQueues(numBuffers);
+    // Found in the registration cache, unless this session is on a different device than the pool was created for
+    poolMemoryRegion = _connection.AcquireExternalMemoryRegion(pool->GetBase(), pool->GetSize(), MemoryAccess::Local, false);
+    poolBuffers = pool->TakeBuffers(numBuffers);
+    try {
+        size_t index = 0;
+        for (auto& buffer : buffers) {
+            buffer.reset(new RdmaBufferInternal(_connection, *this, poolBuffers[index], poolMemoryRegion.get(), bufferSize, index));
+            ++index;
+            idleBuffers.push(buffer.get());
+        }
+    } catch (std::exception&) {
+        pool->ReturnBuffers(poolBuffers);
+        throw;
+    }
+}
+
+RdmaBufferQueueMultipleBuffer::~RdmaBufferQueueMultipleBuffer()
+{
+    Abort(easyrdma_Error_OperationCancelled);
+    buffers.clear();
+    slab.reset();
+    poolMemoryRegion.reset();
+    if (pool) {
+        pool->ReturnBuffers(poolBuffers);
+    }
+}
+
+RdmaBufferQueueSingleBuffer::RdmaBufferQueueSingleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, void* _buffer, size_t _bufferSize, size_t numOverlapped, bool _usePolling, MemoryAccess access, bool onDemand) :
     RdmaBufferQueue(_connection, _direction, _usePolling), buffer(_buffer), bufferSize(_bufferSize), internallyAllocated(false)
 {
     putBackToIdleOnCompletion = true;
-    memoryRegion = _connection.CreateMemoryRegion(_buffer, _bufferSize);
+    memoryRegion = _connection.AcquireExternalMemoryRegion(_buffer, _bufferSize, access, onDemand);
     AllocateBufferQueues(numOverlapped);
     size_t index = 0;
     for (auto& buffer : buffers) {
@@ -323,3 +725,105 @@ RdmaBufferQueueSingleBuffer::~RdmaBufferQueueSingleBuffer()
     buffers.clear();
     memoryRegion.reset();
 }
+
+RdmaBufferQueueRing::RdmaBufferQueueRing(RdmaConnectedSessionBase& _connection, size_t _ringSize, size_t numSlots, bool _usePolling) :
+    RdmaBufferQueue(_connection, Direction::Receive, _usePolling), ringSize(_ringSize)
+{
+    // The sender tells us where each transfer landed with 32 bits of immediate data
+    if (ringSize == 0 || ringSize > std::numeric_limits<uint32_t>::max()) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    ring = AllocateAlignedMemory(ringSize, 64);
+    try {
+        memoryRegion = _connection.CreateMemoryRegion(ring, ringSize, MemoryAccess::RemoteWrite);
+    } catch (std::exception&) {
+        FreeAlignedMemory(ring);
+        throw;
+    }
+    spanTracker.reset(ringSize, numSlots);
+    AllocateBufferQueues(numSlots);
+    size_t index = 0;
+    for (auto& buffer : buffers) {
+        buffer.reset(new RdmaBufferSlot(_connection, *this, memoryRegion.get(), index++));
+        idleBuffers.push(buffer.get());
+    }
+}
+
+RdmaBufferQueueRing::~RdmaBufferQueueRing()
+{
+    Abort(easyrdma_Error_OperationCancelled);
+    buffers.clear();
+    memoryRegion.reset();
+    FreeAlignedMemory(ring);
+}
+
+void RdmaBufferQueueRing::PrepareCompletedBuffer(RdmaBuffer* buffer, const RdmaBufferCompletion& completion)
+{
+    if (completion.status.IsError()) {
+        return;
+    }
+    spanTracker.arrive(buffer->GetIndex(), completion.landedOffset, completion.bytesTransferred);
+    static_cast<RdmaBufferSlot*>(buffer)->SetLandedSpan(static_cast<uint8_t*>(ring) + completion.landedOffset, completion.bytesTransferred);
+}
+
+uint64_t RdmaBufferQueueRing::TakeReceiveCredit(RdmaBuffer* buffer)
+{
+    // The slot itself is always returned. Bytes are only returned once everything ahead of them in the ring
+    // has been released too, so this is often zero.
+    if (!static_cast<RdmaBufferSlot*>(buffer)->TakeLandedSpan()) {
+        return 0;
+    }
+    return spanTracker.release(buffer->GetIndex());
+}
+
+RdmaBufferQueueShared::RdmaBufferQueueShared(RdmaConnectedSessionBase& _connection, const std::shared_ptr<RdmaSharedReceivePool>& _pool, size_t maxTransactionSize, size_t numSlots, bool _usePolling) :
+    RdmaBufferQueue(_connection, Direction::Receive, _usePolling), pool(_pool), creditSize(maxTransactionSize)
+{
+    // Whatever the sender is allowed to send has to fit in any one of the pool's buffers
+    if (maxTransactionSize == 0 || maxTransactionSize > pool->GetBufferSize()) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    AllocateBufferQueues(numSlots);
+    size_t index = 0;
+    for (auto& buffer : buffers) {
+        buffer.reset(new RdmaBufferSlot(_connection, *this, pool->GetMemoryRegion(), index++));
+        idleBuffers.push(buffer.get());
+    }
+}
+
+RdmaBufferQueueShared::~RdmaBufferQueueShared()
+{
+    Abort(easyrdma_Error_OperationCancelled);
+    // Anything still held goes back to the pool for the other sessions
+    for (auto& buffer : buffers) {
+        ReturnToPool(buffer.get());
+    }
+    buffers.clear();
+}
+
+void RdmaBufferQueueShared::PrepareCompletedBuffer(RdmaBuffer* buffer, const RdmaBufferCompletion& completion)
+{
+    // Failed receives still used up a pool buffer, which has to be returned when the slot is requeued
+    size_t bytes = completion.status.IsSuccess() ? completion.bytesTransferred : 0;
+    static_cast<RdmaBufferSlot*>(buffer)->SetLandedSpan(static_cast<uint8_t*>(pool->GetBase()) + completion.landedOffset, bytes);
+}
+
+uint64_t RdmaBufferQueueShared::TakeReceiveCredit(RdmaBuffer* buffer)
+{
+    ReturnToPool(buffer);
+    return creditSize;
+}
+
+void RdmaBufferQueueShared::DiscardCompletion(const RdmaBufferCompletion& completion)
+{
+    uint64_t offset = completion.landedOffset;
+    pool->ReturnBuffers(&offset, 1);
+}
+
+void RdmaBufferQueueShared::ReturnToPool(RdmaBuffer* buffer)
+{
+    uint64_t offset = static_cast<uint8_t*>(buffer->GetBuffer()) - static_cast<uint8_t*>(pool->GetBase());
+    if (static_cast<RdmaBufferSlot*>(buffer)->TakeLandedSpan()) {
+        pool->ReturnBuffers(&offset, 1);
+    }
+}
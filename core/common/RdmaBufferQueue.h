@@ -5,6 +5,11 @@
 #include "RdmaBuffer.h"
 #include "RdmaMemoryRegion.h"
 #include "tCircularFifo.h"
+#include "tLockFreeFifo.h"
+#include "tRingCreditWindow.h"
+#include "RdmaSharedReceivePool.h"
+#include "RdmaBufferPool.h"
+#include "CallbackExecutor.h"
 #include <vector>
 #include <queue>
 #include <thread>
@@ -12,9 +17,9 @@
 #include <condition_variable>
 #include <set>
 #include <atomic>
-#include <boost/intrusive/list.hpp>
 
 class RdmaConnectedSessionBase;
+class CompletionNotifier;
 
 class RdmaBufferQueue
 {
@@ -23,7 +28,9 @@ public:
     virtual ~RdmaBufferQueue();
 
     void Abort(int32_t errorCode);
-    void HandleCompletion(RdmaBuffer& buffer, RdmaError& completionStatus, bool putBackToIdle);
+    void HandleCompletions(RdmaBufferCompletion* completions, size_t numCompletions);
+    // Completes the oldest queued buffers successfully, for transfers whose completion is reported by the remote side
+    void CompleteOldest(const uint64_t* bytesTransferred, size_t numCompletions);
 
     enum class IgnoreCredits : uint32_t
     {
@@ -31,11 +38,31 @@ public:
         No,
     };
     void QueueBuffer(RdmaBuffer* buffer, IgnoreCredits ignoreCredits);
+    // For receives, creditsOut (if given) is filled with the credit to return to the sender for each buffer queued
+    void QueueBuffers(RdmaBuffer** buffersToQueue, size_t numBuffers, IgnoreCredits ignoreCredits, uint64_t* creditsOut = nullptr);
     void ReleaseBuffer(RdmaBuffer* buffer);
-    void AddCredit(uint64_t bufferSize);
+    void AddCredits(const uint64_t* credits, size_t numCredits);
+    void SetSignalInterval(size_t interval);
+    // How long a waiter spins before parking, in microseconds. Zero parks right away.
+    void SetSpinBudget(uint64_t budgetUs);
+    // Signalled after each batch of completions and when the queue fails. Must outlive the queue.
+    void SetCompletionNotifier(CompletionNotifier* notifier);
+    // Switches flow control from one credit per remote buffer to a byte window over a remote ring.
+    // Credits are then counts of bytes rather than buffer sizes.
+    void EnableCreditWindow(uint64_t ringSize);
 
     RdmaBuffer* WaitForCompletedBuffer(int32_t timeoutMs);
+    // Waits until at least minBuffers have completed, then takes every completed buffer up to maxBuffers. If the
+    // timeout expires or the queue fails first, the ones already taken are returned. Returns the number taken.
+    size_t WaitForCompletedBuffers(RdmaBuffer** buffersOut, size_t minBuffers, size_t maxBuffers, int32_t timeoutMs);
+    // Returns nullptr instead of waiting if nothing has completed
+    RdmaBuffer* TryGetCompletedBuffer();
     RdmaBuffer* WaitForIdleBuffer(int32_t timeoutMs);
+    // Same as above, except that running out of time, having nothing queued or the queue having failed is reported
+    // through status rather than thrown, so that callers polling with a short timeout don't pay for an exception.
+    // Returns nullptr or 0 in that case. Misuse still throws.
+    size_t WaitForCompletedBuffers(RdmaBuffer** buffersOut, size_t minBuffers, size_t maxBuffers, int32_t timeoutMs, RdmaError& status);
+    RdmaBuffer* WaitForIdleBuffer(int32_t timeoutMs, RdmaError& status);
     size_t size() const
     {
         return buffers.size();
@@ -50,47 +77,146 @@ public:
     RdmaError GetQueueStatus();
 
 protected:
+    struct PendingCallback
+    {
+        BufferCompletionCallbackData callbackData;
+        int32_t status;
+        size_t completedBytes;
+    };
+
     void AllocateBufferQueues(size_t numBuffers);
+    // Called without the lock
+    void FireCallbacks(std::vector<PendingCallback>& callbacks);
+    // Returns once every callback handed to the callback executor so far has run
+    void FlushCallbacks();
+    void UpdateSignaling(RdmaBuffer* buffer);
+    bool TryConsumeCredit(RdmaBuffer* buffer);
+    void SetQueueStatus(const RdmaError& status);
+    void GiveToUser(RdmaBuffer* buffer);
+    // Called with the lock held for each buffer as it completes, and as a receive buffer is queued again
+    virtual void PrepareCompletedBuffer(RdmaBuffer* buffer, const RdmaBufferCompletion& completion){};
+    virtual uint64_t TakeReceiveCredit(RdmaBuffer* buffer)
+    {
+        return buffer->GetBufferLen();
+    };
+    // Called with the lock held for completions that arrive after the queue was aborted
+    virtual void DiscardCompletion(const RdmaBufferCompletion& completion){};
 
     RdmaConnectedSessionBase& connection;
     Direction direction;
     std::vector<std::unique_ptr<RdmaBuffer>> buffers;
-    tCircularFifo<RdmaBuffer*> idleBuffers;
+    // Idle and completed buffers are handed to the user without the queue lock. Everything that pushes to them
+    // holds the lock, so there is only ever one producer at a time.
+    tLockFreeFifo<RdmaBuffer*> idleBuffers;
     tCircularFifo<RdmaBuffer*> queuedBuffers;
-    tCircularFifo<RdmaBuffer*> completedBuffers;
+    tLockFreeFifo<RdmaBuffer*> completedBuffers;
     tCircularFifo<RdmaBuffer*> buffersQueuedWaitingForCredits;
-    boost::intrusive::list<RdmaBuffer,
-        boost::intrusive::member_hook<RdmaBuffer, boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>, &RdmaBuffer::userBufferListNode>,
-        boost::intrusive::constant_time_size<false> >
-        userBuffers;
+    std::atomic<size_t> numUserBuffers{0};
     std::mutex queueLock;
+    // Held from moving buffers to the queued list until they are posted, so that the QP gets them in the same order
+    // even when several threads queue at once. Taken ahead of queueLock.
+    std::mutex postLock;
     RdmaError queueStatus;
+    // Mirrors queueStatus.IsError() for the lock-free paths
+    std::atomic<bool> failed{false};
     std::condition_variable completedAvailableCond;
     std::condition_variable idleAvailableCond;
+    // Number of threads parked on each condition, so producers only notify when someone is actually waiting
+    size_t completedWaiters = 0;
+    size_t idleWaiters = 0;
+    // Set while a waiter is polling the completion queue on behalf of everyone waiting
+    bool pollerActive = false;
+    // Handed to each buffer as it moves to completedBuffers
+    uint64_t nextSequenceNumber = 0;
+    std::atomic<uint64_t> spinBudgetUs{0};
+    CompletionNotifier* completionNotifier = nullptr;
+    // Where callbacks run when the callback executor is enabled or the session uses the completion engine, or nullptr
+    // to run them inline
+    CallbackExecutor::Worker* callbackWorker = nullptr;
     std::condition_variable noneQueuedCond;
     bool putBackToIdleOnCompletion;
     std::queue<uint64_t> availableCredits;
+    tRingCreditWindow creditWindow;
     bool aborted;
     bool usePolling;
+    size_t signalInterval = 1;
+    size_t sendsSinceSignal = 0;
 };
 
 class RdmaBufferQueueMultipleBuffer : public RdmaBufferQueue
 {
 public:
-    RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling);
+    RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling, bool useHugePages = false);
+    // Draws the buffers from a pool rather than allocating them
+    RdmaBufferQueueMultipleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, size_t numBuffers, size_t bufferSize, bool _usePolling, const std::shared_ptr<RdmaBufferPool>& _pool);
+    virtual ~RdmaBufferQueueMultipleBuffer();
 
 protected:
+    // Backs every buffer in the queue, unless they come from a pool
+    std::unique_ptr<RdmaBufferSlab> slab;
+    std::shared_ptr<RdmaBufferPool> pool;
+    std::vector<uint8_t*> poolBuffers;
+    std::shared_ptr<RdmaMemoryRegion> poolMemoryRegion;
 };
 
 class RdmaBufferQueueSingleBuffer : public RdmaBufferQueue
 {
 public:
-    RdmaBufferQueueSingleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, void* _buffer, size_t _bufferSize, size_t numOverlapped, bool _usePolling);
+    RdmaBufferQueueSingleBuffer(RdmaConnectedSessionBase& _connection, Direction _direction, void* _buffer, size_t _bufferSize, size_t numOverlapped, bool _usePolling, MemoryAccess access, bool onDemand);
     virtual ~RdmaBufferQueueSingleBuffer();
 
 protected:
     bool internallyAllocated;
     void* buffer = nullptr;
     size_t bufferSize = 0;
+    std::shared_ptr<RdmaMemoryRegion> memoryRegion;
+};
+
+// Receives into one ring that the sender writes into directly, placing each transfer right after the
+// previous one. Each buffer is a slot that takes on the span of one transfer when it lands.
+class RdmaBufferQueueRing : public RdmaBufferQueue
+{
+public:
+    RdmaBufferQueueRing(RdmaConnectedSessionBase& _connection, size_t _ringSize, size_t numSlots, bool _usePolling);
+    virtual ~RdmaBufferQueueRing();
+
+    void* GetRing() const
+    {
+        return ring;
+    }
+    size_t GetRingSize() const
+    {
+        return ringSize;
+    }
+    RdmaMemoryRegion* GetRingMemoryRegion() const
+    {
+        return memoryRegion.get();
+    }
+
+protected:
+    void PrepareCompletedBuffer(RdmaBuffer* buffer, const RdmaBufferCompletion& completion) override;
+    uint64_t TakeReceiveCredit(RdmaBuffer* buffer) override;
+
+    void* ring = nullptr;
+    size_t ringSize = 0;
     std::unique_ptr<RdmaMemoryRegion> memoryRegion;
+    tRingSpanTracker spanTracker;
+};
+
+// Receive slots of a session whose data lands in a pool shared with other sessions. Each slot stands for
+// one transfer the sender may have outstanding, and holds on to the pool buffer it landed in until requeued.
+class RdmaBufferQueueShared : public RdmaBufferQueue
+{
+public:
+    RdmaBufferQueueShared(RdmaConnectedSessionBase& _connection, const std::shared_ptr<RdmaSharedReceivePool>& _pool, size_t maxTransactionSize, size_t numSlots, bool _usePolling);
+    virtual ~RdmaBufferQueueShared();
+
+protected:
+    void PrepareCompletedBuffer(RdmaBuffer* buffer, const RdmaBufferCompletion& completion) override;
+    uint64_t TakeReceiveCredit(RdmaBuffer* buffer) override;
+    void DiscardCompletion(const RdmaBufferCompletion& completion) override;
+    void ReturnToPool(RdmaBuffer* buffer);
+
+    std::shared_ptr<RdmaSharedReceivePool> pool;
+    size_t creditSize;
 };
@@ -4,35 +4,40 @@
 #include "RdmaConnectedSessionBase.h"
 #include "RdmaConnectionData.h"
 #include "RdmaBufferQueue.h"
+#include "CompletionNotifier.h"
 #include <assert.h>
 #include <algorithm>
 #include "api/tAccessSuspender.h"
 
 #include "common/ThreadUtility.h"
+#include "common/tSmallArray.h"
 
 static const size_t kMaxCreditsPerBuffer = 100;
+static const size_t kNumCreditBuffers = 100;
 
 using namespace EasyRDMA;
 
+// Constructed with exclusive access to the session, which it gives up for the duration of the wait. The count is
+// dropped after access is given up, so it has to be atomic once waits can overlap.
 class BufferWaitAccessSuspender : public tAccessSuspender
 {
 public:
-    BufferWaitAccessSuspender(iAccessManaged* ref, bool& _inProgressFlag) :
-        tAccessSuspender(ref, false), inProgressFlag(_inProgressFlag)
+    BufferWaitAccessSuspender(iAccessManaged* ref, std::atomic<size_t>& _waitsInProgress, bool allowConcurrent) :
+        tAccessSuspender(ref, false), waitsInProgress(_waitsInProgress)
     {
-        if (inProgressFlag) {
+        if (!allowConcurrent && waitsInProgress.load()) {
             RDMA_THROW(easyrdma_Error_BufferWaitInProgress);
         }
-        inProgressFlag = true;
+        ++waitsInProgress;
         Suspend();
     }
     ~BufferWaitAccessSuspender()
     {
-        inProgressFlag = false;
+        --waitsInProgress;
     }
 
 protected:
-    bool& inProgressFlag;
+    std::atomic<size_t>& waitsInProgress;
 };
 
 RdmaConnectedSessionBase::RdmaConnectedSessionBase() :
@@ -40,14 +45,16 @@ RdmaConnectedSessionBase::RdmaConnectedSessionBase() :
     autoQueueRx(false),
     bufferOwnership(BufferOwnership::Unknown),
     bufferType(BufferType::Unknown),
-    connectionData()
+    connectionData(),
+    threadPolicies(GetDefaultThreadPolicies())
 {
 }
 
-RdmaConnectedSessionBase::RdmaConnectedSessionBase(const std::vector<uint8_t>& _connectionData) :
+RdmaConnectedSessionBase::RdmaConnectedSessionBase(const std::vector<uint8_t>& _connectionData, uint64_t _inlineThreshold) :
     RdmaConnectedSessionBase()
 {
     connectionData = _connectionData;
+    inlineThreshold = _inlineThreshold;
 }
 
 RdmaConnectedSessionBase::~RdmaConnectedSessionBase()
@@ -78,21 +85,49 @@ void RdmaConnectedSessionBase::PreConnect(Direction _direction)
         connectionData = CreateDefaultConnectionData(direction);
     }
     SetupQueuePair();
-    creditBuffers.reset(new RdmaBufferQueueMultipleBuffer(*this, direction == Direction::Receive ? Direction::Send : Direction::Receive, 100, kMaxCreditsPerBuffer * sizeof(uint64_t), false));
     if (direction == Direction::Send) {
+        // Receives for credits must be posted before the connection is established since the other side can send
+        // credits as soon as it is. The protocol version isn't known yet on the connect side, but either version's
+        // credit messages can land in these.
+        creditBuffers.reset(CreateCreditBuffers(Direction::Receive));
         for (size_t i = 0; i < creditBuffers->size(); ++i) {
             RdmaBuffer* buffer = creditBuffers->WaitForIdleBuffer(0);
             creditBuffers->QueueBuffer(buffer, RdmaBufferQueue::IgnoreCredits::Yes);
         }
-        ackHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSessionBase::AckHandlerThread, this), kThreadPriority::Normal, "AckHandler");
     }
 }
 
 void RdmaConnectedSessionBase::PostConnect()
 {
+    // With immediate credits the platform layer consumes credits straight off the completion queue, so the credit
+    // message stream (and the thread decoding it) is only needed for the original protocol
+    if (!UsesImmediateCredits()) {
+        if (direction == Direction::Send) {
+            // The completion engine applies credit messages as they complete instead; see ProcessCreditMessages()
+            if (!useCompletionEngine) {
+                StartThread(ackHandler, easyrdma_ThreadRole_Ack, boost::bind(&RdmaConnectedSessionBase::AckHandlerThread, this), kThreadPriority::Normal, "AckHandler");
+            }
+        } else {
+            creditBuffers.reset(CreateCreditBuffers(Direction::Send));
+        }
+    }
     connected = true;
 }
 
+RdmaBufferQueue* RdmaConnectedSessionBase::CreateCreditBuffers(Direction creditDirection)
+{
+    const size_t creditBufferSize = kMaxCreditsPerBuffer * sizeof(uint64_t);
+    if (creditBufferPool) {
+        return new RdmaBufferQueueMultipleBuffer(*this, creditDirection, kNumCreditBuffers, creditBufferSize, false, creditBufferPool);
+    }
+    return new RdmaBufferQueueMultipleBuffer(*this, creditDirection, kNumCreditBuffers, creditBufferSize, false);
+}
+
+bool RdmaConnectedSessionBase::UsesImmediateCredits() const
+{
+    return protocolVersion >= kImmediateCreditsProtocolVersion;
+}
+
 void RdmaConnectedSessionBase::HandleDisconnect()
 {
     connected = false;
@@ -103,9 +138,12 @@ void RdmaConnectedSessionBase::HandleDisconnect()
     if (creditBuffers) {
         creditBuffers->Abort(easyrdma_Error_Disconnected);
     }
+    if (completionNotifier) {
+        completionNotifier->Signal();
+    }
 }
 
-void RdmaConnectedSessionBase::AddCredit(uint64_t bufferSize)
+void RdmaConnectedSessionBase::AddCredits(const uint64_t* bufferSizes, size_t numCredits)
 {
     // We need to hold this lock since this gets called asynchronously
     // from Configure (and might come before that happens).
@@ -113,9 +151,11 @@ void RdmaConnectedSessionBase::AddCredit(uint64_t bufferSize)
     // and pass them to the transferBuffers queue once configure happens
     std::unique_lock<std::mutex> guard(configureLock);
     if (transferBuffers) {
-        transferBuffers->AddCredit(bufferSize);
+        transferBuffers->AddCredits(bufferSizes, numCredits);
     } else {
-        preConfigureCredits.push(bufferSize);
+        for (size_t i = 0; i < numCredits; ++i) {
+            preConfigureCredits.push(bufferSizes[i]);
+        }
     }
 }
 
@@ -123,20 +163,53 @@ void RdmaConnectedSessionBase::AckHandlerThread()
 {
     try {
         while (!_closing) {
-            RdmaBuffer* creditBuffer = creditBuffers->WaitForCompletedBuffer(-1);
-            size_t size = creditBuffer->GetUsed();
-            size_t numCredits = size / sizeof(boost::endian::big_uint64_buf_t);
-            for (size_t i = 0; i < numCredits; ++i) {
-                uint64_t bufferSizeQueued = reinterpret_cast<boost::endian::big_uint64_buf_t*>(creditBuffer->GetBuffer())[i].value();
-                AddCredit(bufferSizeQueued);
-            }
-            creditBuffers->QueueBuffer(creditBuffer, RdmaBufferQueue::IgnoreCredits::Yes);
+            HandleCreditMessage(creditBuffers->WaitForCompletedBuffer(-1));
         }
     } catch (std::exception&) {
         // No-op, silently exit thread.
     }
 }
 
+void RdmaConnectedSessionBase::ProcessCreditMessages()
+{
+    RdmaBuffer* creditBuffer;
+    while ((creditBuffer = creditBuffers->TryGetCompletedBuffer()) != nullptr) {
+        HandleCreditMessage(creditBuffer);
+    }
+}
+
+void RdmaConnectedSessionBase::HandleCreditMessage(RdmaBuffer* creditBuffer)
+{
+    uint64_t bufferSizesQueued[kMaxCreditsPerBuffer];
+    size_t size = creditBuffer->GetUsed();
+    size_t numCredits = std::min(size / sizeof(boost::endian::big_uint64_buf_t), kMaxCreditsPerBuffer);
+    for (size_t i = 0; i < numCredits; ++i) {
+        bufferSizesQueued[i] = reinterpret_cast<boost::endian::big_uint64_buf_t*>(creditBuffer->GetBuffer())[i].value();
+    }
+    AddCredits(bufferSizesQueued, numCredits);
+    creditBuffers->QueueBuffer(creditBuffer, RdmaBufferQueue::IgnoreCredits::Yes);
+}
+
+void RdmaConnectedSessionBase::DispatchCompletions(RdmaBufferCompletion* completions, size_t numCompletions)
+{
+    // A completion queue can carry completions for more than one buffer queue (e.g. transfer and credit
+    // buffers sharing a CQ), so hand each run of completions belonging to the same queue over as one batch
+    size_t runStart = 0;
+    while (runStart < numCompletions) {
+        // Receives from a shared receive queue don't name a buffer, but can only be for our transfer buffers
+        auto queueOf = [this](const RdmaBufferCompletion& completion) -> RdmaBufferQueue& {
+            return completion.buffer ? completion.buffer->GetBufferQueue() : *transferBuffers;
+        };
+        RdmaBufferQueue& bufferQueue = queueOf(completions[runStart]);
+        size_t runEnd = runStart + 1;
+        while (runEnd < numCompletions && &queueOf(completions[runEnd]) == &bufferQueue) {
+            ++runEnd;
+        }
+        bufferQueue.HandleCompletions(completions + runStart, runEnd - runStart);
+        runStart = runEnd;
+    }
+}
+
 bool RdmaConnectedSessionBase::IsConnected() const
 {
     return connected;
@@ -144,10 +217,15 @@ bool RdmaConnectedSessionBase::IsConnected() const
 
 void RdmaConnectedSessionBase::ProcessPreConfigureCredits()
 {
+    std::vector<uint64_t> credits;
+    credits.reserve(preConfigureCredits.size());
     while (preConfigureCredits.size()) {
-        transferBuffers->AddCredit(preConfigureCredits.front());
+        credits.push_back(preConfigureCredits.front());
         preConfigureCredits.pop();
     }
+    if (credits.size()) {
+        transferBuffers->AddCredits(credits.data(), credits.size());
+    }
 }
 
 void RdmaConnectedSessionBase::ConfigureExternalBuffer(void* externalBuffer, size_t bufferSize, size_t maxConcurrentTransactions)
@@ -157,12 +235,24 @@ void RdmaConnectedSessionBase::ConfigureExternalBuffer(void* externalBuffer, siz
         if (transferBuffers) {
             RDMA_THROW(easyrdma_Error_AlreadyConfigured);
         }
-        if (usePolling) {
+        if (usePolling || useRingBuffer || sharedReceivePool) {
             RDMA_THROW(easyrdma_Error_OperationNotSupported);
         }
         bufferOwnership = BufferOwnership::External;
         bufferType = BufferType::Single;
-        transferBuffers.reset(new RdmaBufferQueueSingleBuffer(*this, direction, externalBuffer, bufferSize, maxConcurrentTransactions, usePolling));
+        // When pulling, the receiver reads straight out of the sender's buffer
+        MemoryAccess access = (usePullMode && direction == Direction::Send) ? MemoryAccess::RemoteRead : MemoryAccess::Local;
+        if (useOnDemandPaging) {
+            uint32_t required = easyrdma_OnDemandPagingCaps_Supported | (usePullMode ? easyrdma_OnDemandPagingCaps_PullMode : 0);
+            if ((GetOnDemandPagingCaps() & required) != required) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+        }
+        transferBuffers.reset(new RdmaBufferQueueSingleBuffer(*this, direction, externalBuffer, bufferSize, maxConcurrentTransactions, usePolling, access, useOnDemandPaging));
+        transferBuffers->SetSignalInterval(sendSignalInterval);
+        transferBuffers->SetSpinBudget(spinWaitBudgetUs);
+        transferBuffers->SetCompletionNotifier(completionNotifier.get());
+        ApplyRemoteRing();
         ProcessPreConfigureCredits();
     }
     PostConfigure();
@@ -178,10 +268,40 @@ void RdmaConnectedSessionBase::ConfigureBuffers(size_t maxTransactionSize, size_
         if (!connected) {
             RDMA_THROW(easyrdma_Error_NotConnected);
         }
+        if (usePullMode) {
+            // Only regions of an external buffer can be published to be pulled, and every receive buffer has to
+            // be able to hold the descriptor that says where to pull from
+            if (direction == Direction::Send) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+            if (maxTransactionSize < sizeof(easyrdma_PullDescriptor)) {
+                RDMA_THROW(easyrdma_Error_InvalidSize);
+            }
+        }
         bufferOwnership = BufferOwnership::Internal;
         bufferType = BufferType::Multiple;
         autoQueueRx = true;
-        transferBuffers.reset(new RdmaBufferQueueMultipleBuffer(*this, direction, maxConcurrentTransactions, maxTransactionSize, usePolling));
+        // A ring is one contiguous allocation of its own, and can't be made out of a pool's separate buffers
+        if (bufferPool && useRingBuffer) {
+            RDMA_THROW(easyrdma_Error_OperationNotSupported);
+        }
+        if (sharedReceivePool) {
+            // Data lands in the listener's pool, and the slots only limit how much the sender can have outstanding
+            if (useRingBuffer || usePullMode || bufferPool) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+            transferBuffers.reset(new RdmaBufferQueueShared(*this, sharedReceivePool, maxTransactionSize, maxConcurrentTransactions, usePolling));
+        } else if (useRingBuffer) {
+            transferBuffers.reset(new RdmaBufferQueueRing(*this, maxTransactionSize * maxConcurrentTransactions, maxConcurrentTransactions, usePolling));
+        } else if (bufferPool) {
+            transferBuffers.reset(new RdmaBufferQueueMultipleBuffer(*this, direction, maxConcurrentTransactions, maxTransactionSize, usePolling, bufferPool));
+        } else {
+            transferBuffers.reset(new RdmaBufferQueueMultipleBuffer(*this, direction, maxConcurrentTransactions, maxTransactionSize, usePolling, useHugePages));
+        }
+        transferBuffers->SetSignalInterval(sendSignalInterval);
+        transferBuffers->SetSpinBudget(spinWaitBudgetUs);
+        transferBuffers->SetCompletionNotifier(completionNotifier.get());
+        ApplyRemoteRing();
         ProcessPreConfigureCredits();
     }
     PostConfigure();
@@ -190,50 +310,109 @@ void RdmaConnectedSessionBase::ConfigureBuffers(size_t maxTransactionSize, size_
 void RdmaConnectedSessionBase::PostConfigure()
 {
     if (direction == Direction::Receive && autoQueueRx) {
-        std::vector<uint64_t> bufferLengths(transferBuffers->size());
-        for (size_t i = 0; i < transferBuffers->size(); ++i) {
-            RdmaBuffer* buffer = transferBuffers->WaitForIdleBuffer(0);
-            bufferLengths[i] = buffer->GetBufferLen();
-            QueueRecvBuffer(buffer, false /* sendCreditUpdate */);
+        if (useRingBuffer) {
+            // The sender needs to know where to write before the first credits reach it
+            auto ringQueue = static_cast<RdmaBufferQueueRing*>(transferBuffers.get());
+            QueueRingAnnouncement(ringQueue->GetRingMemoryRegion(), ringQueue->GetRing(), ringQueue->GetRingSize());
         }
-        size_t creditsLeft = transferBuffers->size();
-        uint64_t* bufferLengthsPtr = bufferLengths.data();
-        while (creditsLeft) {
-            size_t creditsToSend = std::min(creditsLeft, kMaxCreditsPerBuffer);
-            SendCreditUpdate(bufferLengthsPtr, creditsToSend);
-            creditsLeft -= creditsToSend;
-            bufferLengthsPtr += creditsToSend;
+        std::vector<RdmaBuffer*> buffers(transferBuffers->size());
+        for (size_t i = 0; i < transferBuffers->size(); ++i) {
+            buffers[i] = transferBuffers->WaitForIdleBuffer(0);
         }
+        QueueRecvBuffers(buffers.data(), buffers.size(), true /* sendCreditUpdate */);
     }
 }
 
 void RdmaConnectedSessionBase::QueueBuffer(RdmaBuffer* buffer)
+{
+    if (!connected) {
+        RDMA_THROW(easyrdma_Error_Disconnected);
+    }
+    QueueBuffers(&buffer, 1);
+}
+
+void RdmaConnectedSessionBase::QueueBuffers(RdmaBuffer** buffers, size_t numBuffers)
 {
     if (!connected) {
         RDMA_THROW(easyrdma_Error_Disconnected);
     }
     if (direction == Direction::Receive) {
-        QueueRecvBuffer(buffer, true /* sendCreditUpdate */);
+        QueueRecvBuffers(buffers, numBuffers, true /* sendCreditUpdate */);
     } else {
-        QueueSendBuffer(buffer);
+        QueueSendBuffers(buffers, numBuffers);
     }
 }
 
-void RdmaConnectedSessionBase::QueueRecvBuffer(RdmaBuffer* buffer, bool sendCreditUpdate)
+void RdmaConnectedSessionBase::QueueRecvBuffers(RdmaBuffer** buffers, size_t numBuffers, bool sendCreditUpdate)
 {
     assert(direction == Direction::Receive);
 
-    transferBuffers->QueueBuffer(buffer, RdmaBufferQueue::IgnoreCredits::No);
+    // Callers can queue from several threads at once. Credits have to reach the sender in the order the
+    // buffers were queued.
+    std::unique_lock<std::mutex> guard(creditUpdateLock);
+
+    // The queue works out what each buffer is worth to the sender as it takes it, since for a ring that
+    // depends on what else has been released
+    uint64_t credits[kMaxCreditsPerBuffer];
+    std::vector<uint64_t> largeBatchCredits;
+    uint64_t* creditsOut = credits;
+    if (numBuffers > kMaxCreditsPerBuffer) {
+        largeBatchCredits.resize(numBuffers);
+        creditsOut = largeBatchCredits.data();
+    }
+    transferBuffers->QueueBuffers(buffers, numBuffers, RdmaBufferQueue::IgnoreCredits::No, creditsOut);
 
     if (sendCreditUpdate) {
-        uint64_t bufferLen = buffer->GetBufferLen();
-        SendCreditUpdate(&bufferLen, 1 /* numBuffers */);
+        size_t creditsLeft = numBuffers;
+        while (creditsLeft) {
+            size_t creditsToSend = std::min(creditsLeft, kMaxCreditsPerBuffer);
+            SendCreditUpdate(creditsOut, creditsToSend);
+            creditsLeft -= creditsToSend;
+            creditsOut += creditsToSend;
+        }
     }
 }
 
-void RdmaConnectedSessionBase::SendCreditUpdate(uint64_t* bufferLengths, size_t numBuffers)
+void RdmaConnectedSessionBase::AbortTransfers(int32_t errorCode)
+{
+    std::unique_lock<std::mutex> guard(configureLock);
+    if (transferBuffers) {
+        transferBuffers->Abort(errorCode);
+    }
+}
+
+void RdmaConnectedSessionBase::CompletePulledTransfers(const uint64_t* bytesTransferred, size_t numCompletions)
+{
+    // Only reported for transfers we queued, so we must be configured
+    std::unique_lock<std::mutex> guard(configureLock);
+    transferBuffers->CompleteOldest(bytesTransferred, numCompletions);
+}
+
+void RdmaConnectedSessionBase::EnableRemoteRing(uint64_t ringSize)
+{
+    // Arrives ahead of any credits for the ring, possibly before we are configured
+    std::unique_lock<std::mutex> guard(configureLock);
+    remoteRingSize = ringSize;
+    if (transferBuffers) {
+        transferBuffers->EnableCreditWindow(remoteRingSize);
+    }
+}
+
+void RdmaConnectedSessionBase::ApplyRemoteRing()
+{
+    // Called with the configure lock held, ahead of any credits that were stored before configuring
+    if (remoteRingSize) {
+        transferBuffers->EnableCreditWindow(remoteRingSize);
+    }
+}
+
+void RdmaConnectedSessionBase::SendCreditUpdate(const uint64_t* bufferLengths, size_t numBuffers)
 {
     assert(numBuffers <= kMaxCreditsPerBuffer);
+    if (UsesImmediateCredits()) {
+        QueueImmediateCredits(bufferLengths, numBuffers);
+        return;
+    }
     RdmaBuffer* creditBuffer = creditBuffers->WaitForIdleBuffer(-1);
     creditBuffer->SetUsed(numBuffers * sizeof(boost::endian::big_uint64_buf_t));
     boost::endian::big_uint64_buf_t* dest = reinterpret_cast<boost::endian::big_uint64_buf_t*>(creditBuffer->GetBuffer());
@@ -243,13 +422,13 @@ void RdmaConnectedSessionBase::SendCreditUpdate(uint64_t* bufferLengths, size_t
     creditBuffers->QueueBuffer(creditBuffer, RdmaBufferQueue::IgnoreCredits::Yes);
 }
 
-void RdmaConnectedSessionBase::QueueSendBuffer(RdmaBuffer* buffer)
+void RdmaConnectedSessionBase::QueueSendBuffers(RdmaBuffer** buffers, size_t numBuffers)
 {
     assert(direction == Direction::Send);
-    transferBuffers->QueueBuffer(buffer, RdmaBufferQueue::IgnoreCredits::No);
+    transferBuffers->QueueBuffers(buffers, numBuffers, RdmaBufferQueue::IgnoreCredits::No);
 }
 
-RdmaBufferRegion* RdmaConnectedSessionBase::AcquireSendRegion(int32_t timeoutMs)
+RdmaBufferRegion* RdmaConnectedSessionBase::AcquireSendRegion(int32_t timeoutMs, RdmaError& status)
 {
     if (direction == Direction::Receive && autoQueueRx) {
         RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable
@@ -258,9 +437,8 @@ RdmaBufferRegion* RdmaConnectedSessionBase::AcquireSendRegion(int32_t timeoutMs)
         RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable
     }
 
-    BufferWaitAccessSuspender accessSuspender(this, bufferWaitInProgress);
-    RdmaBuffer* buffer = transferBuffers->WaitForIdleBuffer(timeoutMs);
-    return buffer;
+    BufferWaitAccessSuspender accessSuspender(this, bufferWaitsInProgress, allowConcurrentWaits.load());
+    return transferBuffers->WaitForIdleBuffer(timeoutMs, status);
 }
 
 void RdmaConnectedSessionBase::QueueBufferRegion(RdmaBufferRegion* region, const BufferCompletionCallbackData& callbackData)
@@ -273,17 +451,68 @@ void RdmaConnectedSessionBase::QueueBufferRegion(RdmaBufferRegion* region, const
     buffer->Requeue();
 }
 
-RdmaBufferRegion* RdmaConnectedSessionBase::AcquireReceivedRegion(int32_t timeoutMs)
+void RdmaConnectedSessionBase::QueueBufferRegions(RdmaBufferRegion** regions, size_t numRegions, const BufferCompletionCallbackData* callbackData)
+{
+    if (bufferOwnership == BufferOwnership::External) {
+        RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable
+    }
+    if (!transferBuffers) {
+        RDMA_THROW(easyrdma_Error_SessionNotConfigured);
+    }
+    tSmallArray<RdmaBuffer*, kRegionsOnStack> buffers(numRegions);
+    for (size_t i = 0; i < numRegions; ++i) {
+        buffers[i] = static_cast<RdmaBuffer*>(regions[i]);
+        if (callbackData) {
+            buffers[i]->SetCompletionCallback(callbackData[i]);
+        }
+    }
+    QueueBuffers(buffers.data(), buffers.size());
+}
+
+RdmaBufferRegion* RdmaConnectedSessionBase::AcquireReceivedRegion(int32_t timeoutMs, RdmaError& status)
 {
-    BufferWaitAccessSuspender accessSuspender(this, bufferWaitInProgress);
-    RdmaBuffer* buffer = transferBuffers->WaitForCompletedBuffer(timeoutMs);
+    BufferWaitAccessSuspender accessSuspender(this, bufferWaitsInProgress, allowConcurrentWaits.load());
+    RdmaBuffer* buffer = nullptr;
+    transferBuffers->WaitForCompletedBuffers(&buffer, 1, 1, timeoutMs, status);
     return buffer;
 }
 
-void RdmaConnectedSessionBase::QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs)
+size_t RdmaConnectedSessionBase::AcquireReceivedRegions(RdmaBufferRegion** regions, size_t minRegions, size_t maxRegions, int32_t timeoutMs, RdmaError& status)
+{
+    if (!transferBuffers) {
+        RDMA_THROW(easyrdma_Error_SessionNotConfigured);
+    }
+    BufferWaitAccessSuspender accessSuspender(this, bufferWaitsInProgress, allowConcurrentWaits.load());
+    tSmallArray<RdmaBuffer*, kRegionsOnStack> buffers(maxRegions);
+    size_t numAcquired = transferBuffers->WaitForCompletedBuffers(buffers.data(), minRegions, maxRegions, timeoutMs, status);
+    for (size_t i = 0; i < numAcquired; ++i) {
+        regions[i] = buffers[i];
+    }
+    return numAcquired;
+}
+
+void RdmaConnectedSessionBase::ReleaseReceivedRegions(RdmaBufferRegion** regions, size_t numRegions)
 {
-    BufferWaitAccessSuspender accessSuspender(this, bufferWaitInProgress);
-    RdmaBuffer* buffer = transferBuffers->WaitForIdleBuffer(timeoutMs);
+    if (direction != Direction::Receive) {
+        RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable
+    }
+    if (!transferBuffers) {
+        RDMA_THROW(easyrdma_Error_SessionNotConfigured);
+    }
+    tSmallArray<RdmaBuffer*, kRegionsOnStack> buffers(numRegions);
+    for (size_t i = 0; i < numRegions; ++i) {
+        buffers[i] = static_cast<RdmaBuffer*>(regions[i]);
+    }
+    QueueBuffers(buffers.data(), buffers.size());
+}
+
+bool RdmaConnectedSessionBase::QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs, RdmaError& status)
+{
+    BufferWaitAccessSuspender accessSuspender(this, bufferWaitsInProgress, allowConcurrentWaits.load());
+    RdmaBuffer* buffer = transferBuffers->WaitForIdleBuffer(timeoutMs, status);
+    if (!buffer) {
+        return false;
+    }
     if (bufferType != BufferType::Single || bufferOwnership != BufferOwnership::External) {
         RDMA_THROW(easyrdma_Error_InvalidOperation); // not applicable
     }
@@ -291,6 +520,7 @@ void RdmaConnectedSessionBase::QueueExternalBufferRegion(void* pointerWithinBuff
     externalBuffer->SetBufferRegion(pointerWithinBuffer, size);
     externalBuffer->SetCompletionCallback(callbackData);
     externalBuffer->Requeue();
+    return true;
 }
 
 PropertyData RdmaConnectedSessionBase::GetProperty(uint32_t propertyId)
@@ -308,6 +538,42 @@ PropertyData RdmaConnectedSessionBase::GetProperty(uint32_t propertyId)
             return PropertyData(connected);
         case easyrdma_Property_UseRxPolling:
             return PropertyData(usePolling);
+        case easyrdma_Property_SendSignalInterval:
+            return PropertyData(sendSignalInterval);
+        case easyrdma_Property_InlineThreshold:
+            return PropertyData(connected ? effectiveInlineThreshold : inlineThreshold);
+        case easyrdma_Property_UseRingBuffer:
+            return PropertyData(useRingBuffer);
+        case easyrdma_Property_UsePullMode:
+            return PropertyData(usePullMode);
+        case easyrdma_Property_SpinWaitBudget:
+            return PropertyData(spinWaitBudgetUs);
+        case easyrdma_Property_AllowConcurrentWaits:
+            return PropertyData(allowConcurrentWaits.load());
+        case easyrdma_Property_UseHugePages:
+            return PropertyData(useHugePages);
+        case easyrdma_Property_UseOnDemandPaging:
+            return PropertyData(useOnDemandPaging);
+        case easyrdma_Property_OnDemandPagingCaps:
+            return PropertyData(GetOnDemandPagingCaps());
+        case easyrdma_Property_BufferPool:
+        case easyrdma_Property_CreditBufferPool:
+            RDMA_THROW(easyrdma_Error_WriteOnlyProperty);
+        case easyrdma_Property_ThreadPolicies: {
+            std::lock_guard<std::mutex> guard(threadPolicyLock);
+            return PropertyData(threadPolicies);
+        }
+        case easyrdma_Property_CompletionFd: {
+            // Created on first use so sessions that never ask don't hold an extra fd
+            std::unique_lock<std::mutex> guard(configureLock);
+            if (!completionNotifier) {
+                completionNotifier.reset(new CompletionNotifier());
+                if (transferBuffers) {
+                    transferBuffers->SetCompletionNotifier(completionNotifier.get());
+                }
+            }
+            return PropertyData(completionNotifier->GetFd());
+        }
         default:
             RDMA_THROW(easyrdma_Error_InvalidProperty);
     };
@@ -340,11 +606,162 @@ void RdmaConnectedSessionBase::SetProperty(uint32_t propertyId, const void* valu
             usePolling = _usePolling;
             break;
         }
+        case easyrdma_Property_SendSignalInterval: {
+            if (valueSize != sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            uint64_t interval = *reinterpret_cast<const uint64_t*>(value);
+            if (interval == 0) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Only meaningful for the send side, and only before buffers are configured
+            if (transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            if (direction != Direction::Send) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+            sendSignalInterval = interval;
+            break;
+        }
+        case easyrdma_Property_InlineThreshold:
+            if (valueSize != sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Inline capacity is reserved when the QP is created
+            if (direction != Direction::Unknown) {
+                RDMA_THROW(easyrdma_Error_AlreadyConnected);
+            }
+            inlineThreshold = *reinterpret_cast<const uint64_t*>(value);
+            break;
+        case easyrdma_Property_UseRingBuffer: {
+            if (valueSize != sizeof(bool)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            bool _useRingBuffer = *reinterpret_cast<const bool*>(value);
+            // Selects how ConfigureBuffers lays out the receive side, so it must be connected and not yet configured
+            if (!connected || transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            // The sender places data with RDMA writes that carry immediate data, which needs protocol version 2
+            if (_useRingBuffer && (direction != Direction::Receive || !UsesImmediateCredits() || usePullMode)) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+            useRingBuffer = _useRingBuffer;
+            break;
+        }
+        case easyrdma_Property_UsePullMode: {
+            if (valueSize != sizeof(bool)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            bool _usePullMode = *reinterpret_cast<const bool*>(value);
+            // Must be set on both sides, after connecting and before configuring
+            if (!connected || transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            // The receiver is told what to read with immediate data, which needs protocol version 2, and the QP has
+            // to have been allowed reads when connecting
+            if (_usePullMode && (!UsesImmediateCredits() || useRingBuffer || !GetReadDepth())) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+            usePullMode = _usePullMode;
+            break;
+        }
+        case easyrdma_Property_SpinWaitBudget:
+            if (valueSize != sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Can be changed at any time, and takes effect with the next wait
+            spinWaitBudgetUs = *reinterpret_cast<const uint64_t*>(value);
+            if (transferBuffers) {
+                transferBuffers->SetSpinBudget(spinWaitBudgetUs);
+            }
+            break;
+        case easyrdma_Property_AllowConcurrentWaits:
+            if (valueSize != sizeof(bool)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Takes effect with the next wait. Waits already in progress are left alone.
+            allowConcurrentWaits.store(*reinterpret_cast<const bool*>(value));
+            break;
+        case easyrdma_Property_UseHugePages:
+            if (valueSize != sizeof(bool)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Only affects how ConfigureBuffers allocates
+            if (transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            useHugePages = *reinterpret_cast<const bool*>(value);
+            break;
+        case easyrdma_Property_UseOnDemandPaging:
+            if (valueSize != sizeof(bool)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            // Only affects how ConfigureExternalBuffer registers, and is checked against the device's capabilities there
+            if (transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            useOnDemandPaging = *reinterpret_cast<const bool*>(value);
+            break;
+        case easyrdma_Property_ThreadPolicies: {
+            if (valueSize != sizeof(tThreadPolicies)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            tThreadPolicies policies;
+            memcpy(&policies, value, sizeof(policies));
+            for (auto& policy : policies) {
+                ValidateThreadPolicy(policy);
+            }
+            // Threads already running are moved over right away. Ones started later pick it up as they start.
+            // If any thread can't be moved, the ones that were are put back, so the policies still describe them all.
+            std::lock_guard<std::mutex> guard(threadPolicyLock);
+            std::vector<tThreadSchedState> savedStates;
+            savedStates.reserve(roleThreads.size());
+            try {
+                for (auto& roleThread : roleThreads) {
+                    savedStates.push_back(SaveThreadSchedState(*roleThread.second));
+                    ApplyThreadPolicy(*roleThread.second, policies[roleThread.first]);
+                }
+            } catch (std::exception&) {
+                for (size_t i = 0; i < savedStates.size(); ++i) {
+                    RestoreThreadSchedState(*roleThreads[i].second, savedStates[i]);
+                }
+                throw;
+            }
+            threadPolicies = policies;
+            break;
+        }
         default:
             RDMA_THROW(easyrdma_Error_ReadOnlyProperty);
     }
 }
 
+void RdmaConnectedSessionBase::SetBufferPool(uint32_t propertyId, const std::shared_ptr<RdmaBufferPool>& pool)
+{
+    std::unique_lock<std::mutex> guard(configureLock);
+    switch (propertyId) {
+        case easyrdma_Property_BufferPool:
+            if (transferBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+            bufferPool = pool;
+            break;
+        case easyrdma_Property_CreditBufferPool:
+            // The credit buffers are created while connecting
+            if (connected || creditBuffers) {
+                RDMA_THROW(easyrdma_Error_AlreadyConnected);
+            }
+            if (pool && pool->GetBufferSize() < kMaxCreditsPerBuffer * sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidSize);
+            }
+            creditBufferPool = pool;
+            break;
+        default:
+            RDMA_THROW(easyrdma_Error_InvalidProperty);
+    }
+}
+
 bool RdmaConnectedSessionBase::CheckDeferredDestructionConditionsMet()
 {
     if (transferBuffers) {
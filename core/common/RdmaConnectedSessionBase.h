@@ -3,39 +3,72 @@
 
 #pragma once
 #include "RdmaSession.h"
+#include "RdmaSharedReceivePool.h"
+#include "ThreadUtility.h"
 #include <boost/thread.hpp>
 #include <queue>
 #include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <future>
 
 class RdmaBufferQueue;
 class RdmaBuffer;
 class RdmaMemoryRegion;
+class CompletionNotifier;
+struct RdmaBufferCompletion;
 
 class RdmaConnectedSessionBase : public RdmaSession
 {
 public:
     RdmaConnectedSessionBase();
-    RdmaConnectedSessionBase(const std::vector<uint8_t>& _connectionData);
+    RdmaConnectedSessionBase(const std::vector<uint8_t>& _connectionData, uint64_t _inlineThreshold);
     virtual ~RdmaConnectedSessionBase();
 
     void ConfigureBuffers(size_t maxTransactionSize, size_t maxConcurrentTransactions) override;
     void ConfigureExternalBuffer(void* externalBuffer, size_t bufferSize, size_t maxConcurrentTransactions) override;
-    RdmaBufferRegion* AcquireSendRegion(int32_t timeoutMs) override;
+    RdmaBufferRegion* AcquireSendRegion(int32_t timeoutMs, RdmaError& status) override;
     void QueueBufferRegion(RdmaBufferRegion* region, const BufferCompletionCallbackData& callbackData) override;
-    void QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs) override;
-    RdmaBufferRegion* AcquireReceivedRegion(int32_t timeoutMs) override;
+    void QueueBufferRegions(RdmaBufferRegion** regions, size_t numRegions, const BufferCompletionCallbackData* callbackData) override;
+    bool QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs, RdmaError& status) override;
+    RdmaBufferRegion* AcquireReceivedRegion(int32_t timeoutMs, RdmaError& status) override;
+    size_t AcquireReceivedRegions(RdmaBufferRegion** regions, size_t minRegions, size_t maxRegions, int32_t timeoutMs, RdmaError& status) override;
+    void ReleaseReceivedRegions(RdmaBufferRegion** regions, size_t numRegions) override;
     bool IsConnected() const override;
     void Cancel() override;
     PropertyData GetProperty(uint32_t propertyId) override;
     virtual void SetProperty(uint32_t propertyId, const void* value, size_t valueSize) override;
+    void SetBufferPool(uint32_t propertyId, const std::shared_ptr<RdmaBufferPool>& pool) override;
 
     void QueueBuffer(RdmaBuffer* buffer);
+    void QueueBuffers(RdmaBuffer** buffers, size_t numBuffers);
 
-    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize) = 0;
-    virtual void QueueToQp(Direction _direction, RdmaBuffer* buffer) = 0;
+    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access) = 0;
+    // For memory owned by the user. The region may be shared with other sessions, and cover more than the buffer.
+    // With onDemand, a new registration leaves the memory unpinned and the device faults pages in as it uses them.
+    virtual std::shared_ptr<RdmaMemoryRegion> AcquireExternalMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access, bool onDemand) = 0;
+    // NUMA node the device is attached to, or -1 if unknown
+    virtual int GetNumaNode() = 0;
+    // easyrdma_OnDemandPagingCaps_* flags for the device, or 0 if it isn't known yet
+    virtual uint32_t GetOnDemandPagingCaps() = 0;
+    // RDMA reads the QP may have in flight, as agreed on when connecting: the ones we issue when receiving, or the
+    // ones we serve when sending. Pull mode needs at least one.
+    virtual size_t GetReadDepth() = 0;
+    // Posts the buffers to the QP in order. Implementations should hand the whole batch to the NIC at once where possible.
+    virtual void QueueToQp(Direction _direction, RdmaBuffer** buffers, size_t numBuffers) = 0;
+    // Sends credits to the remote side as immediate data. Only called once protocol version 2 has been negotiated.
+    virtual void QueueImmediateCredits(const uint64_t* bufferLengths, size_t numCredits) = 0;
+    // Tells the sender where to write, ahead of any credits for the ring. Only used with protocol version 2.
+    virtual void QueueRingAnnouncement(RdmaMemoryRegion* ringRegion, void* ring, uint64_t ringSize) = 0;
     virtual bool CheckDeferredDestructionConditionsMet() override;
 
-    virtual void PollForReceive(int32_t timeoutMs) = 0;
+    // Returns false if nothing completed within timeoutMs
+    virtual bool PollForReceive(int32_t timeoutMs) = 0;
+
+    bool UsesCompletionEngine() const
+    {
+        return useCompletionEngine;
+    }
 
 protected:
     enum class BufferOwnership
@@ -58,21 +91,97 @@ protected:
     virtual void SetupQueuePair() = 0;
     virtual void DestroyQP() = 0;
     void AckHandlerThread();
+    // Applies every credit message that has arrived so far without waiting for more
+    void ProcessCreditMessages();
+    void DispatchCompletions(RdmaBufferCompletion* completions, size_t numCompletions);
+
+    // Maximum number of completions drained from a completion queue by a single poll
+    static const size_t kMaxCompletionsPerPoll = 32;
 
-    void QueueSendBuffer(RdmaBuffer* buffer);
-    void QueueRecvBuffer(RdmaBuffer* buffer, bool sendCreditUpdate);
+    void QueueSendBuffers(RdmaBuffer** buffers, size_t numBuffers);
+    void QueueRecvBuffers(RdmaBuffer** buffers, size_t numBuffers, bool sendCreditUpdate);
+    void AddCredits(const uint64_t* bufferSizes, size_t numCredits);
+    bool UsesImmediateCredits() const;
+    void EnableRemoteRing(uint64_t ringSize);
+    void CompletePulledTransfers(const uint64_t* bytesTransferred, size_t numCompletions);
+    void AbortTransfers(int32_t errorCode);
 
     void CheckQueueStatus();
 
+    // Starts one of the session's internal threads under the policy for its role, and keeps track of it so
+    // that later policy changes reach it too. The thread holds off running func until its policy is in place, so
+    // a policy that can't be applied leaves no thread behind.
+    template <typename Callable>
+    void StartThread(boost::thread& thread, uint32_t role, Callable func, kThreadPriority priority, const char* label)
+    {
+        auto policyApplied = std::make_shared<std::promise<bool>>();
+        std::shared_future<bool> run = policyApplied->get_future().share();
+        boost::thread newThread = CreatePriorityThread([run, func]() mutable {
+            try {
+                if (!run.get()) {
+                    return;
+                }
+            } catch (const std::future_error&) {
+                // Starting the thread failed before the policy was even tried
+                return;
+            }
+            func();
+        }, priority, label);
+        std::lock_guard<std::mutex> guard(threadPolicyLock);
+        try {
+            ApplyThreadPolicy(newThread, threadPolicies[role]);
+        } catch (std::exception&) {
+            policyApplied->set_value(false);
+            newThread.join();
+            throw;
+        }
+        thread = std::move(newThread);
+        if (std::find(roleThreads.begin(), roleThreads.end(), std::make_pair(role, &thread)) == roleThreads.end()) {
+            roleThreads.push_back(std::make_pair(role, &thread));
+        }
+        policyApplied->set_value(true);
+    }
+
     Direction direction;
     std::vector<uint8_t> connectionData;
+    // Negotiated with the remote side during connection establishment
+    uint8_t protocolVersion = 1;
     bool usePolling = false;
+    // Completions are serviced by the process-wide completion engine rather than threads of our own
+    bool useCompletionEngine = false;
+    bool useRingBuffer = false;
+    // The sender publishes where its data is and the receiver reads it with RDMA reads when it has room
+    bool usePullMode = false;
+    // ConfigureBuffers carves its buffers out of one hugepage-backed slab on the device's NUMA node
+    bool useHugePages = false;
+    // ConfigureExternalBuffer registers the buffer without pinning it
+    bool useOnDemandPaging = false;
+    // Set for receiving sessions accepted from a listener with a shared receive queue
+    std::shared_ptr<RdmaSharedReceivePool> sharedReceivePool;
+    // Where ConfigureBuffers and the credit buffers take their buffers from, if not allocated for this session alone
+    std::shared_ptr<RdmaBufferPool> bufferPool;
+    std::shared_ptr<RdmaBufferPool> creditBufferPool;
+    // Size of the ring the remote side receives into, or zero if it uses individual buffers
+    uint64_t remoteRingSize = 0;
+    uint64_t sendSignalInterval = 1;
+    // How long acquiring a region spins before blocking, in microseconds
+    uint64_t spinWaitBudgetUs = 0;
+    // Sends at or below this size are copied into the work request instead of being read from the buffer by the NIC.
+    // The effective value is what the QP could actually reserve and is only known once it is created.
+    uint64_t inlineThreshold = 0;
+    uint64_t effectiveInlineThreshold = 0;
+    // Indexed by easyrdma_ThreadRole_*
+    tThreadPolicies threadPolicies;
 
 private:
-    void AddCredit(uint64_t bufferSize);
+    RdmaBufferQueue* CreateCreditBuffers(Direction creditDirection);
     void ProcessPreConfigureCredits();
-    void SendCreditUpdate(uint64_t* bufferLengths, size_t numBuffers);
+    void ApplyRemoteRing();
+    void SendCreditUpdate(const uint64_t* bufferLengths, size_t numBuffers);
+    void HandleCreditMessage(RdmaBuffer* creditBuffer);
 
+    // Declared ahead of the queues, which signal it, so that it outlives them
+    std::unique_ptr<CompletionNotifier> completionNotifier;
     std::unique_ptr<RdmaBufferQueue> transferBuffers;
     std::unique_ptr<RdmaBufferQueue> creditBuffers;
     std::queue<uint64_t> preConfigureCredits;
@@ -82,6 +191,12 @@ private:
     BufferOwnership bufferOwnership;
     BufferType bufferType;
     std::mutex configureLock;
+    std::mutex creditUpdateLock;
     bool connected = false;
-    bool bufferWaitInProgress = false;
+    // Threads blocked in AcquireSendRegion, AcquireReceivedRegion(s) or QueueExternalBufferRegion. Only one is
+    // allowed unless allowConcurrentWaits is set, in which case each gets a distinct buffer.
+    std::atomic<size_t> bufferWaitsInProgress{0};
+    std::atomic<bool> allowConcurrentWaits{false};
+    std::mutex threadPolicyLock;
+    std::vector<std::pair<uint32_t, boost::thread*>> roleThreads;
 };
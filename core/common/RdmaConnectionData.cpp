@@ -3,6 +3,7 @@
 
 #include "RdmaCommon.h"
 #include "RdmaConnectionData.h"
+#include <algorithm>
 
 namespace EasyRDMA
 {
@@ -36,4 +37,22 @@ void ValidateConnectionData(const std::vector<uint8_t>& buffer, Direction myDire
         RDMA_THROW(easyrdma_Error_InvalidDirection);
     }
 }
+
+uint8_t NegotiateProtocolVersion(const std::vector<uint8_t>& localBuffer, const std::vector<uint8_t>& remoteBuffer)
+{
+    // Both sides take the lower of the two advertised versions, so they always agree. The local side may have had
+    // its connection data overridden, in which case it speaks whatever it advertised (capped to what we implement).
+    // Anything unrecognizable is treated as the original protocol.
+    auto advertisedVersion = [](const std::vector<uint8_t>& buffer) -> uint8_t {
+        if (buffer.size() < sizeof(easyrdma_ConnectionData)) {
+            return 1;
+        }
+        const easyrdma_ConnectionData& data = reinterpret_cast<const easyrdma_ConnectionData&>(*buffer.data());
+        if (data.protocolId != kDefaultConnectionData.protocolId || data.protocolVersion < 1) {
+            return 1;
+        }
+        return data.protocolVersion;
+    };
+    return std::min({advertisedVersion(localBuffer), advertisedVersion(remoteBuffer), kMaxProtocolVersion});
+}
 }; // namespace EasyRDMA
\ No newline at end of file
@@ -20,13 +20,46 @@ struct easyrdma_ConnectionData
 
 static const uint32_t kConnectionDataProtocol = 0x52444D41; // 'RDMA'
 
+// Protocol versions:
+//  1 - Credits are sent as a separate stream of messages holding big-endian buffer lengths
+//  2 - Credits are carried in the immediate data of zero-length sends
+// ND2 has no way to send immediate data, so Windows stays on version 1
+static const uint8_t kImmediateCreditsProtocolVersion = 2;
+#ifdef _WIN32
+static const uint8_t kMaxProtocolVersion = 1;
+#else
+static const uint8_t kMaxProtocolVersion = kImmediateCreditsProtocolVersion;
+#endif
+
 static const easyrdma_ConnectionData kDefaultConnectionData = {
     kConnectionDataProtocol,
-    1, /* protocolVersion */
+    kMaxProtocolVersion, /* protocolVersion */
     1, /* oldestCompatibleVersion */
     static_cast<uint8_t>(Direction::Unknown)};
 
+// Sent once by a receiver that uses a ring (easyrdma_Property_UseRingBuffer), ahead of its first credits.
+// The sender writes each transfer straight into the ring and credits come back as byte counts.
+#pragma pack(push, 1)
+struct easyrdma_RingAnnouncement
+{
+    boost::endian::big_uint64_t address;
+    boost::endian::big_uint64_t size;
+    boost::endian::big_uint32_t rkey;
+};
+#pragma pack(pop)
+
+// Sent in place of the data when pulling (easyrdma_Property_UsePullMode). The length goes along as immediate data.
+// The receiver reads the data and tells the sender it is done with a zero-length write carrying the length.
+#pragma pack(push, 1)
+struct easyrdma_PullDescriptor
+{
+    boost::endian::big_uint64_t address;
+    boost::endian::big_uint32_t rkey;
+};
+#pragma pack(pop)
+
 const std::vector<uint8_t> CreateDefaultConnectionData(Direction direction);
 void ValidateConnectionData(const std::vector<uint8_t>& buffer, Direction myDirection);
+uint8_t NegotiateProtocolVersion(const std::vector<uint8_t>& localBuffer, const std::vector<uint8_t>& remoteBuffer);
 
 }; // namespace EasyRDMA
@@ -11,13 +11,75 @@ RdmaListenerBase::~RdmaListenerBase()
 {
 }
 
+PropertyData RdmaListenerBase::GetProperty(uint32_t propertyId)
+{
+    switch (propertyId) {
+        case easyrdma_Property_InlineThreshold:
+            return PropertyData(inlineThreshold);
+        case easyrdma_Property_SharedReceiveBufferSize:
+            return PropertyData(sharedReceiveBufferSize);
+        case easyrdma_Property_SharedReceiveBufferCount:
+            return PropertyData(sharedReceiveBufferCount);
+        case easyrdma_Property_SharedReceiveShortages:
+            return PropertyData(sharedReceivePool ? sharedReceivePool->GetShortages() : static_cast<uint64_t>(0));
+        case easyrdma_Property_BufferPool:
+        case easyrdma_Property_CreditBufferPool:
+            RDMA_THROW(easyrdma_Error_WriteOnlyProperty);
+        default:
+            RDMA_THROW(easyrdma_Error_InvalidProperty);
+    }
+}
+
 void RdmaListenerBase::SetProperty(uint32_t propertyId, const void* value, size_t valueSize)
 {
     switch (propertyId) {
         case easyrdma_Property_ConnectionData:
             connectionData = std::vector<uint8_t>(static_cast<const uint8_t*>(value), static_cast<const uint8_t*>(value) + valueSize);
             break;
+        case easyrdma_Property_InlineThreshold:
+            if (valueSize != sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            inlineThreshold = *reinterpret_cast<const uint64_t*>(value);
+            break;
+        case easyrdma_Property_SharedReceiveBufferSize:
+        case easyrdma_Property_SharedReceiveBufferCount: {
+            if (valueSize != sizeof(uint64_t)) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            uint64_t _value = *reinterpret_cast<const uint64_t*>(value);
+            if (sharedReceivePool) {
+                RDMA_THROW(easyrdma_Error_AlreadyConfigured);
+            }
+#ifdef _WIN32
+            // Not yet implemented on top of ND2's shared receive queues
+            if (_value) {
+                RDMA_THROW(easyrdma_Error_OperationNotSupported);
+            }
+#endif
+            if (propertyId == easyrdma_Property_SharedReceiveBufferSize) {
+                sharedReceiveBufferSize = _value;
+            } else {
+                sharedReceiveBufferCount = _value;
+            }
+            break;
+        }
         default:
             RDMA_THROW(easyrdma_Error_ReadOnlyProperty);
     }
 }
+
+void RdmaListenerBase::SetBufferPool(uint32_t propertyId, const std::shared_ptr<RdmaBufferPool>& pool)
+{
+    // Each accepted session checks that the pool suits it
+    switch (propertyId) {
+        case easyrdma_Property_BufferPool:
+            bufferPool = pool;
+            break;
+        case easyrdma_Property_CreditBufferPool:
+            creditBufferPool = pool;
+            break;
+        default:
+            RDMA_THROW(easyrdma_Error_InvalidProperty);
+    }
+}
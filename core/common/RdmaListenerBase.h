@@ -3,6 +3,8 @@
 
 #pragma once
 #include "RdmaSession.h"
+#include "RdmaSharedReceivePool.h"
+#include <memory>
 
 class RdmaListenerBase : public RdmaSession
 {
@@ -10,8 +12,20 @@ public:
     RdmaListenerBase();
     virtual ~RdmaListenerBase();
 
+    PropertyData GetProperty(uint32_t propertyId) override;
     virtual void SetProperty(uint32_t propertyId, const void* value, size_t valueSize) override;
+    void SetBufferPool(uint32_t propertyId, const std::shared_ptr<RdmaBufferPool>& pool) override;
 
 protected:
     std::vector<uint8_t> connectionData;
+    // Applied to every session this listener accepts
+    uint64_t inlineThreshold = 0;
+    // When both are set, receiving sessions accepted from this listener share one pool of receive buffers.
+    // The pool is created by the first such accept.
+    uint64_t sharedReceiveBufferSize = 0;
+    uint64_t sharedReceiveBufferCount = 0;
+    std::shared_ptr<RdmaSharedReceivePool> sharedReceivePool;
+    // Handed to every session this listener accepts
+    std::shared_ptr<RdmaBufferPool> bufferPool;
+    std::shared_ptr<RdmaBufferPool> creditBufferPool;
 };
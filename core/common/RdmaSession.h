@@ -16,6 +16,19 @@ enum class Direction : uint32_t
     Receive = 0x01
 };
 
+// What the remote side is allowed to do with a registered memory region
+enum class MemoryAccess : uint32_t
+{
+    Local,
+    RemoteWrite,
+    RemoteRead
+};
+
+class RdmaBufferPool;
+
+// Batches of regions up to this size are passed through the API without allocating
+static const size_t kRegionsOnStack = 64;
+
 class RdmaBufferRegion
 {
 public:
@@ -23,6 +36,8 @@ public:
     virtual size_t GetSize() const = 0;
     virtual void SetUsed(size_t size) = 0;
     virtual size_t GetUsed() const = 0;
+    // Position in the order the session's transfers completed
+    virtual uint64_t GetSequenceNumber() const = 0;
     virtual void Requeue() = 0;
     virtual void Release() = 0;
 };
@@ -98,6 +113,12 @@ public:
     {
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     };
+    // Sets easyrdma_Property_BufferPool or easyrdma_Property_CreditBufferPool, once the API has looked up the handle.
+    // A null pool goes back to allocating buffers per session.
+    virtual void SetBufferPool(uint32_t propertyId, const std::shared_ptr<RdmaBufferPool>& pool)
+    {
+        RDMA_THROW(easyrdma_Error_InvalidProperty);
+    };
 
     virtual RdmaAddress GetLocalAddress()
     {
@@ -123,10 +144,14 @@ public:
     //-----------------------------------------------
     // Below are used for internally-managed buffers
     // For LV, the buffer regions are returned as EDVRs
+    //
+    // The calls that wait report timeouts, an empty queue and a cancelled or failed session through status
+    // instead of throwing, returning nullptr (or 0 regions) in that case, since callers often poll with a
+    // timeout of 0 and hit these on every call. Misuse is still thrown.
     //-----------------------------------------------
     // Used for Send and Recv with an internally-allocated buffer to retrieve a region of the buffer.
     // For send it is expected to be filled by the user before queueing.
-    virtual RdmaBufferRegion* AcquireSendRegion(int32_t timeoutMs)
+    virtual RdmaBufferRegion* AcquireSendRegion(int32_t timeoutMs, RdmaError& status)
     {
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     };
@@ -137,8 +162,28 @@ public:
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     };
 
+    // Used for Send and Recv to queue a batch of idle buffers with a single call. callbackData is either
+    // nullptr or an array with one entry per region.
+    virtual void QueueBufferRegions(RdmaBufferRegion** regions, size_t numRegions, const BufferCompletionCallbackData* callbackData)
+    {
+        RDMA_THROW(easyrdma_Error_InvalidOperation);
+    };
+
     // Used for Recv to wait for a previously queued buffer to complete
-    virtual RdmaBufferRegion* AcquireReceivedRegion(int32_t timeoutMs)
+    virtual RdmaBufferRegion* AcquireReceivedRegion(int32_t timeoutMs, RdmaError& status)
+    {
+        RDMA_THROW(easyrdma_Error_InvalidOperation);
+    };
+
+    // Used for Recv to take every completed buffer (up to maxRegions) with a single call, once at least
+    // minRegions have completed. Returns how many were placed in regions.
+    virtual size_t AcquireReceivedRegions(RdmaBufferRegion** regions, size_t minRegions, size_t maxRegions, int32_t timeoutMs, RdmaError& status)
+    {
+        RDMA_THROW(easyrdma_Error_InvalidOperation);
+    };
+
+    // Used for Recv to queue a batch of acquired buffers to be received into again
+    virtual void ReleaseReceivedRegions(RdmaBufferRegion** regions, size_t numRegions)
     {
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     };
@@ -148,7 +193,8 @@ public:
     //-----------------------------------------------
     // Used for Send and Recv with an externally-managed buffer to queue a region of that buffer for send or recv
     // For LV, this is just an EDVR coming from an API like RIO, and the callbacks are handled internally via the EDVR
-    virtual void QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs)
+    // Returns false, with status set, if no region was free in time (see above)
+    virtual bool QueueExternalBufferRegion(void* pointerWithinBuffer, size_t size, const BufferCompletionCallbackData& callbackData, int32_t timeoutMs, RdmaError& status)
     {
         RDMA_THROW(easyrdma_Error_InvalidOperation);
     };
@@ -0,0 +1,25 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+class RdmaMemoryRegion;
+
+// Receive buffers shared by every receiving session accepted from one listener. The buffers are carved out of
+// a single registered allocation and are identified by their offset within it. Data for any of the sessions
+// lands in whichever buffer the adapter picks, and each buffer is handed back once its session is done with it.
+class RdmaSharedReceivePool
+{
+public:
+    virtual ~RdmaSharedReceivePool(){};
+
+    virtual void* GetBase() const = 0;
+    virtual size_t GetBufferSize() const = 0;
+    virtual RdmaMemoryRegion* GetMemoryRegion() const = 0;
+    // Makes buffers available to receive into again
+    virtual void ReturnBuffers(const uint64_t* offsets, size_t numBuffers) = 0;
+    // Number of times the pool has been seen running low on posted buffers
+    virtual uint64_t GetShortages() const = 0;
+};
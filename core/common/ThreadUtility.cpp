@@ -6,9 +6,14 @@
 #include "api/easyrdma.h"
 #include "RdmaError.h"
 #include <boost/filesystem.hpp>
+#include <mutex>
 
 #ifdef __linux__
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
 #endif
 
 bool IsRealtimeKernel()
@@ -78,3 +83,197 @@ void ValidatePriorityForCurrentThread(kThreadPriority priority)
     }
 #endif
 }
+
+void ValidateAffinity(uint64_t cpuMask)
+{
+    if (!cpuMask) {
+        return;
+    }
+#ifdef __linux__
+    long numCpus = sysconf(_SC_NPROCESSORS_CONF);
+    uint64_t available = numCpus >= 64 ? ~0ULL : ((1ULL << numCpus) - 1);
+#elif defined(_WIN32)
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+    uint64_t available = processMask;
+#else
+    uint64_t available = ~0ULL;
+#endif
+    if (!(cpuMask & available)) {
+        RDMA_THROW(easyrdma_Error_InvalidArgument);
+    }
+}
+
+void SetAffinityForCurrentThread(uint64_t cpuMask)
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (cpuMask) {
+        for (size_t cpu = 0; cpu < 64; ++cpu) {
+            if (cpuMask & (1ULL << cpu)) {
+                CPU_SET(cpu, &cpuSet);
+            }
+        }
+    } else {
+        // The kernel leaves out whatever the process isn't allowed to use
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InvalidArgument, ret);
+    }
+#elif defined(_WIN32)
+    DWORD_PTR mask = static_cast<DWORD_PTR>(cpuMask);
+    if (!mask) {
+        DWORD_PTR systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask);
+    }
+    if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InvalidArgument, GetLastError());
+    }
+#endif
+}
+
+static std::mutex defaultThreadPoliciesLock;
+static tThreadPolicies defaultThreadPolicies = {};
+
+tThreadPolicies GetDefaultThreadPolicies()
+{
+    std::lock_guard<std::mutex> guard(defaultThreadPoliciesLock);
+    return defaultThreadPolicies;
+}
+
+void SetDefaultThreadPolicies(const tThreadPolicies& policies)
+{
+    for (auto& policy : policies) {
+        ValidateThreadPolicy(policy);
+    }
+    std::lock_guard<std::mutex> guard(defaultThreadPoliciesLock);
+    defaultThreadPolicies = policies;
+}
+
+#ifdef __linux__
+static int ToSchedPolicy(int32_t schedPolicy)
+{
+    switch (schedPolicy) {
+        case easyrdma_SchedPolicy_Fifo:
+            return SCHED_FIFO;
+        case easyrdma_SchedPolicy_RoundRobin:
+            return SCHED_RR;
+        case easyrdma_SchedPolicy_Other:
+        default:
+            return SCHED_OTHER;
+    }
+}
+#endif
+
+void ValidateThreadPolicy(const easyrdma_ThreadPolicy& policy)
+{
+    ValidateAffinity(policy.cpuMask);
+    switch (policy.schedPolicy) {
+        case easyrdma_SchedPolicy_Default:
+            if (policy.schedPriority) {
+                RDMA_THROW(easyrdma_Error_InvalidArgument);
+            }
+            return;
+        case easyrdma_SchedPolicy_Other:
+        case easyrdma_SchedPolicy_Fifo:
+        case easyrdma_SchedPolicy_RoundRobin:
+            break;
+        default:
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+    }
+#ifdef __linux__
+    int schedPolicy = ToSchedPolicy(policy.schedPolicy);
+    if (policy.schedPriority < sched_get_priority_min(schedPolicy) || policy.schedPriority > sched_get_priority_max(schedPolicy)) {
+        RDMA_THROW(easyrdma_Error_InvalidArgument);
+    }
+#else
+    RDMA_THROW(easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+void ApplyThreadPolicy(boost::thread& thread, const easyrdma_ThreadPolicy& policy)
+{
+    if (!thread.joinable()) {
+        return;
+    }
+#ifdef __linux__
+    pthread_t handle = thread.native_handle();
+    if (policy.cpuMask) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (size_t cpu = 0; cpu < 64; ++cpu) {
+            if (policy.cpuMask & (1ULL << cpu)) {
+                CPU_SET(cpu, &cpuSet);
+            }
+        }
+        int ret = pthread_setaffinity_np(handle, sizeof(cpuSet), &cpuSet);
+        if (ret != 0) {
+            RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InvalidArgument, ret);
+        }
+    }
+    if (policy.schedPolicy != easyrdma_SchedPolicy_Default) {
+        struct sched_param params;
+        params.sched_priority = policy.schedPriority;
+        int ret = pthread_setschedparam(handle, ToSchedPolicy(policy.schedPolicy), &params);
+        if (ret != 0) {
+            // Most likely EPERM, since real-time policies need privileges the process may not have
+            RDMA_THROW_WITH_SUBCODE(easyrdma_Error_OperationNotSupported, ret);
+        }
+    }
+#elif defined(_WIN32)
+    if (policy.cpuMask && !SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(policy.cpuMask))) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InvalidArgument, GetLastError());
+    }
+#endif
+}
+
+tThreadSchedState SaveThreadSchedState(boost::thread& thread)
+{
+    tThreadSchedState state = {};
+    if (!thread.joinable()) {
+        return state;
+    }
+#ifdef __linux__
+    pthread_t handle = thread.native_handle();
+    int ret = pthread_getaffinity_np(handle, sizeof(state.cpuSet), &state.cpuSet);
+    if (ret == 0) {
+        ret = pthread_getschedparam(handle, &state.schedPolicy, &state.schedParams);
+    }
+    if (ret != 0) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InternalError, ret);
+    }
+#elif defined(_WIN32)
+    // There's no way to read a thread's mask other than by setting it, which returns the one it replaced
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InternalError, GetLastError());
+    }
+    DWORD_PTR previousMask = SetThreadAffinityMask(thread.native_handle(), processMask);
+    if (!previousMask) {
+        RDMA_THROW_WITH_SUBCODE(easyrdma_Error_InternalError, GetLastError());
+    }
+    SetThreadAffinityMask(thread.native_handle(), previousMask);
+    state.affinityMask = previousMask;
+#endif
+    return state;
+}
+
+void RestoreThreadSchedState(boost::thread& thread, const tThreadSchedState& state)
+{
+    if (!thread.joinable()) {
+        return;
+    }
+#ifdef __linux__
+    pthread_t handle = thread.native_handle();
+    pthread_setaffinity_np(handle, sizeof(state.cpuSet), &state.cpuSet);
+    pthread_setschedparam(handle, state.schedPolicy, &state.schedParams);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(state.affinityMask));
+#endif
+}
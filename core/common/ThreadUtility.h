@@ -4,7 +4,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <array>
 #include <boost/thread.hpp>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
 #include "RdmaError.h"
 #include "api/easyrdma.h"
 
@@ -30,9 +34,48 @@ struct tThreadAttrs
 };
 
 bool IsRealtimeKernel();
+
+// Hints to the CPU that the caller is busy-waiting, which saves power and frees the core for a sibling hyperthread
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
 tThreadAttrs GetThreadAttrs(kThreadPriority priority);
 void SetPriorityForCurrentThread(kThreadPriority priority);
 void ValidatePriorityForCurrentThread(kThreadPriority priority);
+// Bit n of cpuMask allows CPU n. Zero allows every CPU the process may use.
+void ValidateAffinity(uint64_t cpuMask);
+void SetAffinityForCurrentThread(uint64_t cpuMask);
+
+typedef std::array<easyrdma_ThreadPolicy, easyrdma_NumThreadRoles> tThreadPolicies;
+
+// Policies sessions start with. Each session copies them when it is created.
+tThreadPolicies GetDefaultThreadPolicies();
+void SetDefaultThreadPolicies(const tThreadPolicies& policies);
+void ValidateThreadPolicy(const easyrdma_ThreadPolicy& policy);
+// Can be applied to a running thread. Anything left at its default is not touched.
+void ApplyThreadPolicy(boost::thread& thread, const easyrdma_ThreadPolicy& policy);
+
+// What ApplyThreadPolicy may change on a thread, saved beforehand so that a change can be rolled back
+struct tThreadSchedState
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    int schedPolicy;
+    struct sched_param schedParams;
+#else
+    uint64_t affinityMask;
+#endif
+};
+tThreadSchedState SaveThreadSchedState(boost::thread& thread);
+// Best effort, for undoing a change that went wrong part way
+void RestoreThreadSchedState(boost::thread& thread, const tThreadSchedState& state);
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -68,6 +68,14 @@ public:
         return _buffer[getReadIndex(0)];
     }
     //------------------------------------------------------------------------
+    //  at() - returns the element offset positions behind the front
+    //------------------------------------------------------------------------
+    T& at(size_t offset)
+    {
+        assert(offset < size());
+        return _buffer[getReadIndex(offset)];
+    }
+    //------------------------------------------------------------------------
     //  pop() - removes first element from front
     //------------------------------------------------------------------------
     void pop()
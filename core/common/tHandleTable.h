@@ -0,0 +1,216 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//============================================================================
+//  Class tHandleTable
+//
+//  Maps opaque handles to shared objects. A handle encodes a slot index and
+//  the generation the slot was at when the object was inserted, so looking
+//  one up is an index plus a generation check and never takes a lock. Slots
+//  are reused once their object is erased, but the generation is bumped on
+//  every erase so stale handles stop resolving instead of finding whatever
+//  took their place. Insert and Erase are serialized by a mutex.
+//
+//  Slots live in fixed-size chunks that are never moved or freed while the
+//  table exists, so lookups can run while another thread grows the table.
+//============================================================================
+template <typename T>
+class tHandleTable
+{
+public:
+    typedef uintptr_t Handle;
+
+    //------------------------------------------------------------------------
+    //  Constructor
+    //------------------------------------------------------------------------
+    tHandleTable()
+    {
+        for (auto& chunk : _chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    ~tHandleTable()
+    {
+        for (auto& chunk : _chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+    tHandleTable(const tHandleTable&) = delete;
+    tHandleTable& operator=(const tHandleTable&) = delete;
+
+    //------------------------------------------------------------------------
+    //  Insert() - stores object and returns its handle, which is never 0.
+    //  Returns 0 if the table is full.
+    //------------------------------------------------------------------------
+    Handle Insert(const std::shared_ptr<T>& object)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        size_t index;
+        if (!_freeSlots.empty()) {
+            index = _freeSlots.back();
+            _freeSlots.pop_back();
+        } else {
+            if (_numSlots == kMaxSlots) {
+                return 0;
+            }
+            index = _numSlots;
+            if (index % kSlotsPerChunk == 0) {
+                _chunks[index / kSlotsPerChunk].store(new Slot[kSlotsPerChunk], std::memory_order_release);
+            }
+            _numSlots.store(index + 1, std::memory_order_release);
+        }
+        Slot& slot = GetSlot(index);
+        // Lookups only touch the object after seeing the slot occupied, and the last erase waited for all of them
+        // to finish with it, so nobody else is looking at it now
+        slot.object = object;
+        uint64_t state = slot.state.fetch_or(kOccupied, std::memory_order_release);
+        ++_size;
+        return MakeHandle(index, GetGeneration(state));
+    }
+    //------------------------------------------------------------------------
+    //  Erase() - removes the object behind handle and returns it, or null if
+    //  the handle doesn't refer to anything. Lookups of handle fail from here
+    //  on.
+    //------------------------------------------------------------------------
+    std::shared_ptr<T> Erase(Handle handle)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        Slot* slot = FindSlot(handle);
+        if (!slot) {
+            return nullptr;
+        }
+        uint64_t state = slot->state.load(std::memory_order_acquire);
+        if (!Matches(state, handle)) {
+            return nullptr;
+        }
+        // Clears the occupied bit and carries into the generation in one step. Only erases change either, and
+        // those are serialized by _lock, so the bit is known to be set here.
+        slot->state.fetch_add(kOccupied, std::memory_order_acq_rel);
+        // Anyone who got in before the bump is still copying the object out
+        while (slot->state.load(std::memory_order_acquire) & kPinMask) {
+            std::this_thread::yield();
+        }
+        std::shared_ptr<T> object = std::move(slot->object);
+        slot->object.reset();
+        _freeSlots.push_back(GetIndex(handle));
+        --_size;
+        return object;
+    }
+    //------------------------------------------------------------------------
+    //  Lookup() - returns the object behind handle, or null if the handle
+    //  doesn't refer to anything. Never blocks.
+    //------------------------------------------------------------------------
+    std::shared_ptr<T> Lookup(Handle handle) const
+    {
+        Slot* slot = FindSlot(handle);
+        if (!slot) {
+            return nullptr;
+        }
+        // Pinning first and checking afterward keeps this to a single atomic op. A pin taken on the wrong
+        // generation is simply dropped again without touching the object.
+        uint64_t state = slot->state.fetch_add(1, std::memory_order_acquire);
+        std::shared_ptr<T> object;
+        if (Matches(state, handle)) {
+            object = slot->object;
+        }
+        slot->state.fetch_sub(1, std::memory_order_release);
+        return object;
+    }
+    //------------------------------------------------------------------------
+    //  IsCurrent() - whether handle still refers to an object
+    //------------------------------------------------------------------------
+    bool IsCurrent(Handle handle) const
+    {
+        Slot* slot = FindSlot(handle);
+        return slot && Matches(slot->state.load(std::memory_order_acquire), handle);
+    }
+    //------------------------------------------------------------------------
+    //  size() - number of objects in the table
+    //------------------------------------------------------------------------
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _size;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    //  Handle layout: low bits are the slot index plus one, so that no handle
+    //  is 0, high bits are the low bits of the slot's generation.
+    //------------------------------------------------------------------------
+    static const unsigned kIndexBits = sizeof(Handle) >= 8 ? 32 : 20;
+    static const unsigned kGenerationBits = sizeof(Handle) * 8 - kIndexBits;
+    static const size_t kSlotsPerChunk = 256;
+    static const size_t kMaxChunks = 1024;
+    static const size_t kMaxSlots = kSlotsPerChunk * kMaxChunks;
+    static_assert(kMaxSlots < (static_cast<uint64_t>(1) << kIndexBits), "Slot index must fit in a handle");
+
+    //------------------------------------------------------------------------
+    //  Slot state: the generation in the upper 32 bits, an occupied flag in
+    //  bit 31 and the number of in-flight lookups below that.
+    //------------------------------------------------------------------------
+    static const uint64_t kOccupied = static_cast<uint64_t>(1) << 31;
+    static const uint64_t kPinMask = kOccupied - 1;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> state{0};
+        std::shared_ptr<T> object;
+    };
+
+    static uint32_t GetGeneration(uint64_t state)
+    {
+        return static_cast<uint32_t>(state >> 32);
+    }
+    static size_t GetIndex(Handle handle)
+    {
+        return static_cast<size_t>(handle & ((static_cast<Handle>(1) << kIndexBits) - 1)) - 1;
+    }
+    static Handle MakeHandle(size_t index, uint32_t generation)
+    {
+        Handle maskedGeneration = static_cast<Handle>(generation) & ((static_cast<Handle>(1) << kGenerationBits) - 1);
+        return (maskedGeneration << kIndexBits) | static_cast<Handle>(index + 1);
+    }
+    static bool Matches(uint64_t state, Handle handle)
+    {
+        return (state & kOccupied) && MakeHandle(GetIndex(handle), GetGeneration(state)) == handle;
+    }
+    Slot& GetSlot(size_t index) const
+    {
+        return _chunks[index / kSlotsPerChunk].load(std::memory_order_acquire)[index % kSlotsPerChunk];
+    }
+    Slot* FindSlot(Handle handle) const
+    {
+        if (!handle) {
+            return nullptr;
+        }
+        size_t index = GetIndex(handle);
+        if (index >= _numSlots.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &GetSlot(index);
+    }
+
+    //------------------------------------------------------------------------
+    //  Data members
+    //------------------------------------------------------------------------
+    std::atomic<Slot*> _chunks[kMaxChunks];
+    std::atomic<size_t> _numSlots{0};
+    mutable std::mutex _lock;
+    std::vector<size_t> _freeSlots;
+    size_t _size = 0;
+};
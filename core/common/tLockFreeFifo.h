@@ -0,0 +1,113 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <stddef.h>
+#include <assert.h>
+#include <atomic>
+#include <memory>
+
+//============================================================================
+//  Class tLockFreeFifo
+//
+//  Fixed-capacity fifo for handing elements from one thread to another
+//  without a lock. Only one thread may push at a time, so callers that have
+//  more than one producer must serialize them themselves. Pops need no such
+//  care: each element goes to exactly one of any number of concurrent
+//  consumers, and with a single consumer the claim is never contended. The
+//  producer and consumer indices live on separate cache lines so the two
+//  sides don't keep stealing the line from each other.
+//
+//  T must be trivially copyable and fit in a lock-free std::atomic.
+//============================================================================
+template <typename T>
+class tLockFreeFifo
+{
+public:
+    //------------------------------------------------------------------------
+    //  Constructor
+    //------------------------------------------------------------------------
+    tLockFreeFifo() :
+        _capacity(0)
+    {
+    }
+    tLockFreeFifo(size_t size)
+    {
+        reallocate(size);
+    }
+    //------------------------------------------------------------------------
+    //  reallocate() - discards the contents. Not safe against concurrent use.
+    //------------------------------------------------------------------------
+    void reallocate(size_t size)
+    {
+        _buffer.reset(size ? new std::atomic<T>[size] : nullptr);
+        _capacity = size;
+        _tail.store(0, std::memory_order_relaxed);
+        _head.store(0, std::memory_order_relaxed);
+    }
+    //------------------------------------------------------------------------
+    //  Basic container info. Only exact when neither side is running.
+    //------------------------------------------------------------------------
+    size_t size() const
+    {
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    //------------------------------------------------------------------------
+    //  push() - pushes element to back. Producer side only.
+    //------------------------------------------------------------------------
+    void push(T elem)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        assert(tail - _head.load(std::memory_order_acquire) < capacity());
+        _buffer[tail % _capacity].store(elem, std::memory_order_relaxed);
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+    //------------------------------------------------------------------------
+    //  pop() - removes the first element into elem. Returns false if there
+    //  was nothing to remove.
+    //------------------------------------------------------------------------
+    bool pop(T& elem)
+    {
+        size_t head = _head.load(std::memory_order_acquire);
+        while (true) {
+            if (head == _tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            // The slot can only be overwritten once head has moved past it, in which case the claim below fails
+            // and the value is thrown away
+            T candidate = _buffer[head % _capacity].load(std::memory_order_relaxed);
+            if (_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                elem = candidate;
+                return true;
+            }
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    //  Data members
+    //------------------------------------------------------------------------
+    static const size_t kCacheLineSize = 64;
+
+    std::unique_ptr<std::atomic<T>[]> _buffer;
+    size_t _capacity;
+    char _padBeforeTail[kCacheLineSize];
+    std::atomic<size_t> _tail{0};
+    char _padBeforeHead[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _head{0};
+    char _padAfterHead[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};
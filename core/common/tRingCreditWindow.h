@@ -0,0 +1,187 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+
+//============================================================================
+//  Class tRingCreditWindow
+//
+//  Byte-granular flow control for a ring of contiguous bytes exposed by the
+//  receiving side. Each transfer takes exactly the span it needs. A transfer
+//  that does not fit before the end of the ring skips the bytes that are left
+//  and starts over at the beginning. The receiver returns credits as counts of
+//  bytes it is done with (skipped bytes included) in the order they were taken.
+//  Each transfer also needs a slot, since it consumes a posted receive on the
+//  other side, and every credit returns one.
+//============================================================================
+class tRingCreditWindow
+{
+public:
+    tRingCreditWindow() :
+        _ringSize(0), _head(0), _available(0), _slots(0)
+    {
+    }
+    void reset(uint64_t ringSize)
+    {
+        _ringSize = ringSize;
+        _head = 0;
+        _available = ringSize;
+        _slots = 0;
+    }
+    bool enabled() const
+    {
+        return _ringSize != 0;
+    }
+    uint64_t ringSize() const
+    {
+        return _ringSize;
+    }
+    uint64_t available() const
+    {
+        return _available;
+    }
+    uint64_t slots() const
+    {
+        return _slots;
+    }
+    //------------------------------------------------------------------------
+    //  reserve() - takes a slot and a contiguous span of the ring. Returns
+    //  false if not enough has been credited back yet, leaving the window
+    //  untouched.
+    //------------------------------------------------------------------------
+    bool reserve(uint64_t length, uint64_t& offset)
+    {
+        assert(enabled() && length <= _ringSize);
+        uint64_t position = _head % _ringSize;
+        uint64_t skipped = (position + length > _ringSize) ? _ringSize - position : 0;
+        if (!_slots || skipped + length > _available) {
+            return false;
+        }
+        offset = skipped ? 0 : position;
+        _head += skipped + length;
+        _available -= skipped + length;
+        --_slots;
+        return true;
+    }
+    //------------------------------------------------------------------------
+    //  addCredit() - returns a slot along with the bytes the receiver is now
+    //  done with (possibly zero)
+    //------------------------------------------------------------------------
+    void addCredit(uint64_t bytes)
+    {
+        _available += bytes;
+        ++_slots;
+        assert(_available <= _ringSize);
+    }
+
+private:
+    uint64_t _ringSize;
+    uint64_t _head;
+    uint64_t _available;
+    uint64_t _slots;
+};
+
+//============================================================================
+//  Class tRingSpanTracker
+//
+//  Receiving side of tRingCreditWindow. Each span that lands in the ring is
+//  held by one of a fixed number of receive slots. Slots may be released in
+//  any order, but bytes are only credited back once every span ahead of them
+//  has been released, since the sender reuses the ring strictly in order. A
+//  span released early is folded into the one ahead of it, so the tracker
+//  never holds more spans than there are slots.
+//============================================================================
+class tRingSpanTracker
+{
+public:
+    tRingSpanTracker() :
+        _ringSize(0), _written(0), _credited(0), _newest(kNoSlot), _outstanding(0)
+    {
+    }
+    void reset(uint64_t ringSize, size_t numSlots)
+    {
+        _ringSize = ringSize;
+        _written = 0;
+        _credited = 0;
+        _newest = kNoSlot;
+        _outstanding = 0;
+        _slots.assign(numSlots, Slot());
+    }
+    size_t outstanding() const
+    {
+        return _outstanding;
+    }
+    //------------------------------------------------------------------------
+    //  arrive() - records a span the sender wrote at the given offset
+    //------------------------------------------------------------------------
+    void arrive(size_t slot, uint64_t offset, uint64_t length)
+    {
+        assert(slot < _slots.size() && !_slots[slot].inUse);
+        uint64_t position = _written % _ringSize;
+        if (offset != position) {
+            // The sender skipped the end of the ring
+            assert(offset == 0);
+            _written += _ringSize - position;
+        }
+        _written += length;
+        Slot& span = _slots[slot];
+        span.end = _written;
+        span.inUse = true;
+        span.previous = _newest;
+        span.next = kNoSlot;
+        if (_newest != kNoSlot) {
+            _slots[_newest].next = slot;
+        }
+        _newest = slot;
+        ++_outstanding;
+    }
+    //------------------------------------------------------------------------
+    //  release() - marks a slot's span as consumed and returns the number of
+    //  bytes that can now be credited back to the sender (possibly zero)
+    //------------------------------------------------------------------------
+    uint64_t release(size_t slot)
+    {
+        assert(slot < _slots.size() && _slots[slot].inUse);
+        Slot& span = _slots[slot];
+        span.inUse = false;
+        --_outstanding;
+        uint64_t credit = 0;
+        if (span.previous == kNoSlot) {
+            credit = span.end - _credited;
+            _credited = span.end;
+        } else {
+            _slots[span.previous].end = span.end;
+            _slots[span.previous].next = span.next;
+        }
+        if (span.next != kNoSlot) {
+            _slots[span.next].previous = span.previous;
+        } else {
+            _newest = span.previous;
+        }
+        return credit;
+    }
+
+private:
+    static const size_t kNoSlot = static_cast<size_t>(-1);
+    struct Slot
+    {
+        uint64_t end = 0;
+        size_t previous = kNoSlot;
+        size_t next = kNoSlot;
+        bool inUse = false;
+    };
+    std::vector<Slot> _slots;
+    uint64_t _ringSize;
+    uint64_t _written;
+    uint64_t _credited;
+    size_t _newest;
+    size_t _outstanding;
+};
@@ -0,0 +1,60 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <stddef.h>
+#include <memory>
+
+//============================================================================
+//  Class tSmallArray
+//
+//  Scratch array whose size is only known at run time, for batch calls on the
+//  data path. Up to N elements live inside the object itself, so a batch of a
+//  typical size costs no allocation. Larger ones fall back to the heap.
+//============================================================================
+template <typename T, size_t N>
+class tSmallArray
+{
+public:
+    explicit tSmallArray(size_t size) :
+        _data(_inline), _size(size)
+    {
+        if (size > N) {
+            _heap.reset(new T[size]);
+            _data = _heap.get();
+        }
+    }
+    tSmallArray(const tSmallArray&) = delete;
+    tSmallArray& operator=(const tSmallArray&) = delete;
+
+    T* data()
+    {
+        return _data;
+    }
+    size_t size() const
+    {
+        return _size;
+    }
+    T& operator[](size_t index)
+    {
+        return _data[index];
+    }
+    T* begin()
+    {
+        return _data;
+    }
+    T* end()
+    {
+        return _data + _size;
+    }
+
+private:
+    T _inline[N];
+    std::unique_ptr<T[]> _heap;
+    T* _data;
+    size_t _size;
+};
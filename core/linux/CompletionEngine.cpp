@@ -0,0 +1,163 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#include "RdmaCommon.h"
+#include "CompletionEngine.h"
+#include "ThreadUtility.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Maximum number of ready fds a worker picks up per wait
+static const int kMaxEventsPerWait = 64;
+// Wake-ups are told apart from registrations by this id, which Register() never hands out
+static const CompletionEngine::RegistrationId kWakeId = 0;
+
+static thread_local void* currentWorker = nullptr;
+
+CompletionEngine& GetCompletionEngine()
+{
+    // Never destroyed, since detached workers may still be using it while the process exits
+    static CompletionEngine* completionEngine = new CompletionEngine();
+    return *completionEngine;
+}
+
+CompletionEngine::CompletionEngine()
+{
+}
+
+void CompletionEngine::SetThreadCount(size_t count)
+{
+    std::lock_guard<std::mutex> guard(engineLock);
+    threadCount = count;
+}
+
+size_t CompletionEngine::GetThreadCount()
+{
+    std::lock_guard<std::mutex> guard(engineLock);
+    return threadCount;
+}
+
+bool CompletionEngine::IsEnabled()
+{
+    return GetThreadCount() != 0;
+}
+
+CompletionEngine::RegistrationId CompletionEngine::Register(int fd, const Handler& handler)
+{
+    std::lock_guard<std::mutex> guard(engineLock);
+    if (!threadCount) {
+        RDMA_THROW(easyrdma_Error_InvalidOperation);
+    }
+    size_t index = nextWorker++ % threadCount;
+    while (workers.size() <= index) {
+        // Like the event channel thread, workers live for the rest of the process
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        HandleError(worker->epollFd);
+        worker->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        HandleError(worker->wakeFd);
+        epoll_event wakeEvent = {};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.u64 = kWakeId;
+        HandleError(epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, worker->wakeFd, &wakeEvent));
+        auto priority = IsRealtimeKernel() ? kThreadPriority::High : kThreadPriority::Normal;
+        auto thread = CreatePriorityThread(boost::bind(&CompletionEngine::WorkerThread, this, worker.get()), priority, "CompletionEng");
+        thread.detach();
+        workers.push_back(std::move(worker));
+    }
+    Worker* worker = workers[index].get();
+
+    RegistrationId id = nextId++;
+    std::shared_ptr<Registration> registration(new Registration({fd, handler, true}));
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    HandleError(epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, fd, &event));
+    registrations[id] = std::make_pair(registration, worker);
+
+    // Anything that completed before the fd was armed won't make it readable, so the handler runs once up front
+    worker->kicked.push_back(id);
+    uint64_t wake = 1;
+    (void)!write(worker->wakeFd, &wake, sizeof(wake));
+    return id;
+}
+
+void CompletionEngine::Unregister(RegistrationId id)
+{
+    std::unique_lock<std::mutex> guard(engineLock);
+    auto found = registrations.find(id);
+    if (found == registrations.end()) {
+        return;
+    }
+    auto registration = found->second.first;
+    Worker* worker = found->second.second;
+    registrations.erase(found);
+    if (registration->active) {
+        epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, registration->fd, nullptr);
+    }
+    // A handler unregistering itself is already done as far as its worker is concerned
+    if (currentWorker != worker) {
+        handlerFinished.wait(guard, [&]() { return worker->running != id; });
+    }
+}
+
+void CompletionEngine::RunHandler(Worker* worker, RegistrationId id)
+{
+    std::shared_ptr<Registration> registration;
+    {
+        std::lock_guard<std::mutex> guard(engineLock);
+        auto found = registrations.find(id);
+        if (found == registrations.end() || !found->second.first->active) {
+            return;
+        }
+        registration = found->second.first;
+        worker->running = id;
+    }
+    bool keepRunning = false;
+    try {
+        keepRunning = registration->handler();
+    } catch (std::exception&) {
+        // Errors are reported through the session's queues. The handler just stops being called.
+    }
+    {
+        std::lock_guard<std::mutex> guard(engineLock);
+        worker->running = 0;
+        if (!keepRunning && registration->active && registrations.count(id)) {
+            registration->active = false;
+            epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, registration->fd, nullptr);
+        }
+    }
+    handlerFinished.notify_all();
+}
+
+void CompletionEngine::WorkerThread(Worker* worker)
+{
+    currentWorker = worker;
+    epoll_event events[kMaxEventsPerWait];
+    std::vector<RegistrationId> ready;
+    while (true) {
+        int numEvents = epoll_wait(worker->epollFd, events, kMaxEventsPerWait, -1);
+        if (numEvents < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ready.clear();
+        for (int i = 0; i < numEvents; ++i) {
+            if (events[i].data.u64 == kWakeId) {
+                uint64_t wakes;
+                (void)!read(worker->wakeFd, &wakes, sizeof(wakes));
+                std::lock_guard<std::mutex> guard(engineLock);
+                ready.insert(ready.end(), worker->kicked.begin(), worker->kicked.end());
+                worker->kicked.clear();
+            } else {
+                ready.push_back(events[i].data.u64);
+            }
+        }
+        for (auto id : ready) {
+            RunHandler(worker, id);
+        }
+    }
+}
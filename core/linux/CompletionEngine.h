@@ -0,0 +1,67 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <vector>
+
+// Services completion channels for any number of sessions from a small, fixed pool of threads, so the number of
+// threads no longer grows with the number of sessions. Each registered fd is pinned to one thread, which calls its
+// handler whenever the fd is readable (and once right after it is registered). Handlers sharing a thread run one
+// at a time, so a slow handler holds up every other session on its thread. User completion callbacks are never run
+// here; sessions using the engine always hand them to the callback executor, which gets a worker even when
+// CallbackExecutorThreads is zero. Nor do handlers wait on the remote side: credits and reads that find the send
+// queue full are left for the session's send CQ handler to post once earlier sends complete.
+class CompletionEngine
+{
+public:
+    // Returns false if the handler should not be called again, e.g. once its session can make no more progress
+    typedef std::function<bool()> Handler;
+    typedef uint64_t RegistrationId;
+
+    CompletionEngine();
+
+    // Zero leaves sessions with their own handler threads. Only affects sessions connected afterwards, so any that
+    // are registered keep being serviced by the thread they were given.
+    void SetThreadCount(size_t count);
+    size_t GetThreadCount();
+    bool IsEnabled();
+
+    RegistrationId Register(int fd, const Handler& handler);
+    // Once this returns, the handler is not running and will not be called again. May be called from a handler.
+    void Unregister(RegistrationId id);
+
+private:
+    struct Registration
+    {
+        int fd;
+        Handler handler;
+        bool active;
+    };
+    struct Worker
+    {
+        int epollFd = -1;
+        int wakeFd = -1;
+        // Registrations whose handler has to run once without waiting for their fd
+        std::vector<RegistrationId> kicked;
+        RegistrationId running = 0;
+    };
+
+    void WorkerThread(Worker* worker);
+    void RunHandler(Worker* worker, RegistrationId id);
+
+    std::mutex engineLock;
+    std::condition_variable handlerFinished;
+    std::map<RegistrationId, std::pair<std::shared_ptr<Registration>, Worker*>> registrations;
+    std::vector<std::unique_ptr<Worker>> workers;
+    size_t threadCount = 0;
+    size_t nextWorker = 0;
+    RegistrationId nextId = 1;
+};
+
+CompletionEngine& GetCompletionEngine();
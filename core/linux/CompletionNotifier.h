@@ -0,0 +1,36 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaCommon.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// An eventfd that becomes readable whenever buffers complete on a session or the session fails, so an application
+// can wait on many sessions from its own epoll loop. It stays readable until the application reads it, after which
+// it should take everything that has completed without blocking.
+class CompletionNotifier
+{
+public:
+    CompletionNotifier()
+    {
+        fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        HandleError(fd);
+    }
+    ~CompletionNotifier()
+    {
+        close(fd);
+    }
+    void Signal()
+    {
+        uint64_t count = 1;
+        (void)!write(fd, &count, sizeof(count));
+    }
+    int32_t GetFd() const
+    {
+        return fd;
+    }
+
+private:
+    int fd = -1;
+};
@@ -5,6 +5,7 @@
 #include <condition_variable>
 #include <queue>
 #include <map>
+#include <functional>
 #include "RdmaCommon.h"
 
 class iEventHandler
@@ -29,6 +30,9 @@ public:
         std::mutex queueMutex;
         std::condition_variable moreEvents;
         bool waitAborted = false;
+        // When set, disconnects are handed to this from the event thread instead of being queued
+        std::function<void()> disconnectHandler;
+        std::mutex disconnectHandlerMutex;
 
         // Note: There should only ever be one thread waiting on a specific connection at a time
         //       -cancelledResult is an optional parameter to communicate cancellation without
@@ -64,6 +68,13 @@ public:
 
         void SignalEvent(rdma_cm_event* event)
         {
+            if (event->event == RDMA_CM_EVENT_DISCONNECTED) {
+                std::lock_guard<std::mutex> handlerLock(disconnectHandlerMutex);
+                if (disconnectHandler) {
+                    disconnectHandler();
+                    return;
+                }
+            }
             std::lock_guard<std::mutex> lock(queueMutex);
             ConnectionEvent incomingEvent = {};
             incomingEvent.eventType = event->event;
@@ -76,6 +87,27 @@ public:
             moreEvents.notify_one();
         }
 
+        // Once cleared, the previous handler is guaranteed not to be running. A disconnect that was queued before
+        // the handler was set is handed to it right away.
+        void SetDisconnectHandler(const std::function<void()>& handler)
+        {
+            std::lock_guard<std::mutex> handlerLock(disconnectHandlerMutex);
+            disconnectHandler = handler;
+            if (handler) {
+                bool disconnected = false;
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    while (!events.empty()) {
+                        disconnected |= events.front().eventType == RDMA_CM_EVENT_DISCONNECTED;
+                        events.pop();
+                    }
+                }
+                if (disconnected) {
+                    disconnectHandler();
+                }
+            }
+        }
+
         void CancelWaits()
         {
             std::lock_guard<std::mutex> lock(queueMutex);
@@ -115,6 +147,12 @@ public:
         connectionQueue->CancelWaits();
     }
 
+    void SetDisconnectHandler(rdma_cm_id* connection, const std::function<void()>& handler)
+    {
+        auto connectionQueue = GetConnectionQueue(connection);
+        connectionQueue->SetDisconnectHandler(handler);
+    }
+
     void CreateConnectionQueue(rdma_cm_id* connection)
     {
         std::lock_guard<std::mutex> lock(mapMutex);
@@ -8,6 +8,17 @@
 #include <valgrind.h>
 #include "EventManager.h"
 #include "ThreadUtility.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+// From linux/mempolicy.h, which would otherwise need libnuma's headers
+static const int kMemoryPolicyPreferred = 1;
+static const size_t k2MB = 2 * 1024 * 1024;
+static const size_t k1GB = 1024 * 1024 * 1024;
 
 // File local variables
 static std::mutex eventChannelMutex;
@@ -64,4 +75,72 @@ bool IsValgrindRunning()
 {
     static bool running = RUNNING_ON_VALGRIND;
     return running;
-}
\ No newline at end of file
+}
+
+static size_t RoundUp(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+static void* MapHugePages(size_t size, size_t pageSize)
+{
+    int pageSizeFlag = (pageSize == k1GB ? 30 : 21) << MAP_HUGE_SHIFT;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageSizeFlag, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+void* AllocateHugePageMemory(size_t& size, int numaNode)
+{
+    // Explicit hugepages only exist if some were reserved (vm.nr_hugepages), so fall back to asking for
+    // transparent ones, which the kernel uses when it can
+    void* memory = nullptr;
+    size_t mappedSize = 0;
+    if (size >= k1GB) {
+        mappedSize = RoundUp(size, k1GB);
+        memory = MapHugePages(mappedSize, k1GB);
+    }
+    if (!memory) {
+        mappedSize = RoundUp(size, k2MB);
+        memory = MapHugePages(mappedSize, k2MB);
+    }
+    if (!memory) {
+        memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            RDMA_THROW(easyrdma_Error_OutOfMemory);
+        }
+        madvise(memory, mappedSize, MADV_HUGEPAGE);
+    }
+    if (numaNode >= 0 && numaNode < static_cast<int>(sizeof(unsigned long) * 8)) {
+        // Nothing has been touched yet, so every page lands on the node as it is first faulted in. Only a
+        // preference, so that running out of memory on the node doesn't fail the allocation.
+        unsigned long nodeMask = 1UL << numaNode;
+        syscall(SYS_mbind, memory, mappedSize, kMemoryPolicyPreferred, &nodeMask, sizeof(nodeMask) * 8, 0);
+    }
+    size = mappedSize;
+    return memory;
+}
+
+void FreeHugePageMemory(void* ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+uint32_t QueryOnDemandPagingCaps(ibv_context* context)
+{
+    ibv_device_attr_ex attributes = {};
+    if (ibv_query_device_ex(context, nullptr, &attributes) || !(attributes.odp_caps.general_caps & IBV_ODP_SUPPORT)) {
+        return 0;
+    }
+    uint32_t caps = 0;
+    uint32_t rcCaps = attributes.odp_caps.per_transport_caps.rc_odp_caps;
+    if ((rcCaps & (IBV_ODP_SUPPORT_SEND | IBV_ODP_SUPPORT_RECV)) == (IBV_ODP_SUPPORT_SEND | IBV_ODP_SUPPORT_RECV)) {
+        caps |= easyrdma_OnDemandPagingCaps_Supported;
+        if (rcCaps & IBV_ODP_SUPPORT_READ) {
+            caps |= easyrdma_OnDemandPagingCaps_PullMode;
+        }
+        if (attributes.odp_caps.general_caps & IBV_ODP_SUPPORT_IMPLICIT) {
+            caps |= easyrdma_OnDemandPagingCaps_Implicit;
+        }
+    }
+    return caps;
+}
@@ -80,6 +80,14 @@ inline void FreeAlignedMemory(void* ptr)
     free(ptr);
 }
 
+// Backs an allocation with hugepages where possible and places it on numaNode (-1 for anywhere). Rounds size up to
+// what was actually mapped, which has to be passed back to FreeHugePageMemory.
+void* AllocateHugePageMemory(size_t& size, int numaNode);
+void FreeHugePageMemory(void* ptr, size_t size);
+
+// Returns the easyrdma_OnDemandPagingCaps_* flags for a device, as they apply to reliable connections
+uint32_t QueryOnDemandPagingCaps(ibv_context* context);
+
 rdma_event_channel* GetEventChannel();
 EventManager& GetEventManager();
 bool IsValgrindRunning();
\ No newline at end of file
@@ -7,27 +7,45 @@
 #include "RdmaBuffer.h"
 #include "common/RdmaAddress.h"
 #include "RdmaMemoryRegion.h"
+#include "RdmaSharedReceiveQueue.h"
+#include "RdmaRegistrationCache.h"
 #include <assert.h>
+#include <algorithm>
+#include <limits>
+#include <arpa/inet.h>
+#include <fstream>
 #include "rdma/rdma_verbs.h"
 #include "EventManager.h"
+#include "CompletionEngine.h"
 #include "ThreadUtility.h"
 
 using namespace EasyRDMA;
 
+// Maximum number of work requests linked into a single post to the QP
+static const size_t kMaxWorkRequestsPerPost = 64;
+// Depth of each of the QP's send and receive queues
+static const size_t kMaxWorkRequestsPerQueue = 1024;
+// How often an immediate credit send asks for a completion
+static const size_t kImmediateCreditSignalInterval = 64;
+
 RdmaConnectedSession::RdmaConnectedSession() :
     RdmaConnectedSessionBase(), cm_id(nullptr), createdQp(false)
 {
 }
 
-RdmaConnectedSession::RdmaConnectedSession(Direction _direction, rdma_cm_id* acceptedId, const std::vector<uint8_t>& connectionDataIn, const std::vector<uint8_t>& connectionDataOut) :
-    RdmaConnectedSessionBase(connectionDataOut), cm_id(acceptedId), createdQp(false)
+RdmaConnectedSession::RdmaConnectedSession(Direction _direction, rdma_cm_id* acceptedId, const std::vector<uint8_t>& connectionDataIn, const std::vector<uint8_t>& connectionDataOut, uint64_t inlineThreshold, const std::shared_ptr<RdmaSharedReceivePool>& _sharedReceivePool, const std::shared_ptr<RdmaBufferPool>& _bufferPool, const std::shared_ptr<RdmaBufferPool>& _creditBufferPool) :
+    RdmaConnectedSessionBase(connectionDataOut, inlineThreshold), cm_id(acceptedId), createdQp(false)
 {
+    sharedReceivePool = _sharedReceivePool;
+    bufferPool = _bufferPool;
+    creditBufferPool = _creditBufferPool;
     try {
         GetEventManager().CreateConnectionQueue(acceptedId);
 
         PreConnect(_direction);
         try {
             ValidateConnectionData(connectionDataIn, _direction);
+            protocolVersion = NegotiateProtocolVersion(connectionData, connectionDataIn);
         } catch (const RdmaException& e) {
             // If validation of the private_data from the connector side fails, the listener calls reject
             rdma_reject(acceptedId, connectionDataIn.data(), connectionDataIn.size());
@@ -39,6 +57,14 @@ RdmaConnectedSession::RdmaConnectedSession(Direction _direction, rdma_cm_id* acc
         connectParams.private_data_len = connectionData.size();
         connectParams.retry_count = 10;
         connectParams.rnr_retry_count = 10;
+        if (sharedReceivePool) {
+            // Our sender's credits can outnumber the buffers left in the shared pool, so it must keep retrying until
+            // another session returns some. The field is only 3 bits wide and 7 means retry forever.
+            connectParams.rnr_retry_count = 7;
+        }
+        if (UsesImmediateCredits()) {
+            SetReadDepth(connectParams);
+        }
         HandleError(rdma_accept(acceptedId, &connectParams));
 
         // Wait for connection to be established
@@ -71,16 +97,24 @@ void RdmaConnectedSession::Destroy()
     }
 
     queueFdPoller.Cancel();
+    for (auto registration : completionRegistrations) {
+        GetCompletionEngine().Unregister(registration);
+    }
+    completionRegistrations.clear();
     if (transferHandler.joinable()) {
         transferHandler.join();
     }
     if (ackHandler.joinable()) {
         ackHandler.join();
     }
+    if (pullHandler.joinable()) {
+        pullHandler.join();
+    }
 
-    // Unblock connection handler
+    // Unblock connection handler, or wait out the disconnect handler if the completion engine is in use
     if (cm_id) {
         GetEventManager().AbortWaits(cm_id);
+        GetEventManager().SetDisconnectHandler(cm_id, nullptr);
     }
     if (connectionHandler.joinable()) {
         connectionHandler.join();
@@ -92,6 +126,7 @@ void RdmaConnectedSession::Destroy()
 
     if (cm_id) {
         if (createdQp) {
+            ReturnUnclaimedSharedReceives();
             rdma_destroy_qp(cm_id);
             createdQp = false;
         }
@@ -101,17 +136,58 @@ void RdmaConnectedSession::Destroy()
     }
 }
 
+void RdmaConnectedSession::ReturnUnclaimedSharedReceives()
+{
+    // Receives this QP took from the shared queue but that were never handed to our buffer queue would otherwise
+    // be lost to the other sessions. Once disconnected, anything the QP took has completed on our receive CQ.
+    if (!sharedReceivePool) {
+        return;
+    }
+    ibv_wc wc[kMaxCompletionsPerPoll];
+    int numCompletions;
+    while ((numCompletions = ibv_poll_cq(cm_id->recv_cq, kMaxCompletionsPerPoll, wc)) > 0) {
+        for (int i = 0; i < numCompletions; ++i) {
+            uint64_t offset = wc[i].wr_id;
+            sharedReceivePool->ReturnBuffers(&offset, 1);
+        }
+    }
+}
+
 void RdmaConnectedSession::PostConnect()
 {
     remoteAddress = RdmaAddress(rdma_get_peer_addr(cm_id));
+    useCompletionEngine = GetCompletionEngine().IsEnabled();
+    // What the two sides offered was settled when the QP was brought up
+    ibv_qp_attr qpAttr = {};
+    ibv_qp_init_attr qpInitAttr = {};
+    HandleError(rdma_seterrno(ibv_query_qp(cm_id->qp, &qpAttr, IBV_QP_MAX_QP_RD_ATOMIC | IBV_QP_MAX_DEST_RD_ATOMIC, &qpInitAttr)));
+    readDepth = (direction == Direction::Receive) ? qpAttr.max_rd_atomic : qpAttr.max_dest_rd_atomic;
     RdmaConnectedSessionBase::PostConnect();
-    connectionHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::ConnectionHandlerThread, this), kThreadPriority::Normal, "ConnHandler");
+    if (useCompletionEngine) {
+        // Same division of work as the threads below, but nothing here blocks waiting for it
+        MakeCQsNonBlocking();
+        GetEventManager().SetDisconnectHandler(cm_id, boost::bind(&RdmaConnectedSession::HandleDisconnect, this));
+        // A receiver's send CQ carries its credits, and with immediate credits it is also where credits and pulled
+        // reads that couldn't be posted right away are picked up again
+        if (direction == Direction::Send) {
+            RegisterCompletionHandler(Direction::Receive);
+        } else {
+            RegisterCompletionHandler(Direction::Send);
+        }
+        return;
+    }
+    StartThread(connectionHandler, easyrdma_ThreadRole_Connection, boost::bind(&RdmaConnectedSession::ConnectionHandlerThread, this), kThreadPriority::Normal, "ConnHandler");
 
-    // Always start our ack handler at connection time, because the other side might configure first
-    if (direction == Direction::Send) {
-        ackHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Receive), kThreadPriority::Normal, "AckRecvHandler");
+    // Always start our ack handler at connection time, because the other side might configure first.
+    // The receive side has nothing to reap when credits are sent as immediate data; see QueueImmediateCredits().
+    if (UsesImmediateCredits()) {
+        if (direction == Direction::Send) {
+            StartThread(ackHandler, easyrdma_ThreadRole_Ack, boost::bind(&RdmaConnectedSession::ImmediateCreditHandlerThread, this), kThreadPriority::Normal, "AckRecvHandler");
+        }
+    } else if (direction == Direction::Send) {
+        StartThread(ackHandler, easyrdma_ThreadRole_Ack, boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Receive), kThreadPriority::Normal, "AckRecvHandler");
     } else {
-        ackHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Send), kThreadPriority::Normal, "AckSendHandler");
+        StartThread(ackHandler, easyrdma_ThreadRole_Ack, boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Send), kThreadPriority::Normal, "AckSendHandler");
     }
 }
 
@@ -123,10 +199,26 @@ void RdmaConnectedSession::PostConfigure()
             // distinction between Linux RT and Desktop, but holds up true enough for the time being. Really this comes down
             // more to privileges of the current process rather than OS capabilities.
             auto priority = IsRealtimeKernel() ? kThreadPriority::High : kThreadPriority::Normal;
-            transferHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Receive), priority, "RecvHandler");
+            if (useCompletionEngine) {
+                RegisterCompletionHandler(Direction::Receive);
+            } else {
+                StartThread(transferHandler, easyrdma_ThreadRole_ReceiveCompletion, boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Receive), priority, "RecvHandler");
+            }
+        }
+        // With the completion engine, the send CQ handler registered when connecting also picks up pulled reads
+        if (usePullMode && !useCompletionEngine) {
+            StartThread(pullHandler, easyrdma_ThreadRole_ReceiveCompletion, boost::bind(&RdmaConnectedSession::PullHandlerThread, this), kThreadPriority::Normal, "PullHandler");
         }
     } else {
-        transferHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Send), kThreadPriority::Normal, "SendHandler");
+        if (usePullMode) {
+            pullDescriptors.resize(kMaxWorkRequestsPerQueue);
+            pullDescriptorRegion = CreateMemoryRegion(pullDescriptors.data(), pullDescriptors.size() * sizeof(easyrdma_PullDescriptor), MemoryAccess::Local);
+        }
+        if (useCompletionEngine) {
+            RegisterCompletionHandler(Direction::Send);
+        } else {
+            StartThread(transferHandler, easyrdma_ThreadRole_SendCompletion, boost::bind(&RdmaConnectedSession::SendReceiveHandlerThread, this, Direction::Send), kThreadPriority::Normal, "SendHandler");
+        }
     }
     RdmaConnectedSessionBase::PostConfigure();
 }
@@ -163,27 +255,396 @@ void RdmaConnectedSession::ConnectionHandlerThread()
     }
 }
 
-void RdmaConnectedSession::QueueToQp(Direction _direction, RdmaBuffer* buffer)
+void RdmaConnectedSession::QueueToQp(Direction _direction, RdmaBuffer** buffers, size_t numBuffers)
 {
-    if (_direction == Direction::Send) {
-        HandleError(rdma_post_send(cm_id, buffer, buffer->GetPointer(), buffer->GetUsed(), buffer->GetMemoryRegion()->GetMR(), IBV_SEND_SIGNALED));
-    } else {
-        // If this process is being instrumented by Valgrind, it has no way of knowing that this buffer for RDMA is going to be written to
-        // by the hardware. This has the downside of flagging memory passed for recv as possibly uninitialized, unless the entity allocating it
-        // initializes it. For recv, this is unnecessary (and costs performance), so it is expected to not do this. Our own internal allocations are not
-        // initialized either. The problem with this is that valgrind becomes unusable, because the possibly-uninitalized data taints a bunch of code paths
-        // (like the credit mechanism). So to be nice for that use case, if we detect we're running under valgrind, we will initialize their memory on every
-        // recv. Note that valgrind already adds so much overhead that this isn't a big deal.
-        if (IsValgrindRunning()) {
-            memset(buffer->GetPointer(), 0, buffer->GetSize());
+    // Work requests are linked into chains and posted with a single call per chain, so the NIC doorbell
+    // is rung once for the whole batch instead of once per buffer
+    ibv_sge sges[kMaxWorkRequestsPerPost];
+    while (numBuffers) {
+        size_t chainLength = std::min(numBuffers, kMaxWorkRequestsPerPost);
+        for (size_t i = 0; i < chainLength; ++i) {
+            RdmaBuffer* buffer = buffers[i];
+            sges[i].addr = reinterpret_cast<uintptr_t>(buffer->GetPointer());
+            sges[i].length = static_cast<uint32_t>(_direction == Direction::Send ? buffer->GetUsed() : buffer->GetSize());
+            sges[i].lkey = buffer->GetMemoryRegion()->GetMR()->lkey;
+        }
+        if (_direction == Direction::Send) {
+            ibv_send_wr wrs[kMaxWorkRequestsPerPost];
+            memset(wrs, 0, sizeof(ibv_send_wr) * chainLength);
+            for (size_t i = 0; i < chainLength; ++i) {
+                wrs[i].wr_id = reinterpret_cast<uintptr_t>(buffers[i]);
+                wrs[i].next = (i + 1 < chainLength) ? &wrs[i + 1] : nullptr;
+                wrs[i].sg_list = &sges[i];
+                wrs[i].num_sge = 1;
+                if (usePullMode) {
+                    // Publish where the data is instead of sending it. A descriptor slot only comes around again once the
+                    // send queue has taken as many requests as it can hold, so the send that used it last has completed.
+                    easyrdma_PullDescriptor& descriptor = pullDescriptors[nextPullDescriptor++ % pullDescriptors.size()];
+                    descriptor.address = sges[i].addr;
+                    descriptor.rkey = buffers[i]->GetMemoryRegion()->GetMR()->rkey;
+                    wrs[i].opcode = IBV_WR_SEND_WITH_IMM;
+                    wrs[i].imm_data = htonl(sges[i].length);
+                    sges[i].addr = reinterpret_cast<uintptr_t>(&descriptor);
+                    sges[i].length = sizeof(descriptor);
+                    sges[i].lkey = pullDescriptorRegion->GetMR()->lkey;
+                } else if (remoteRingSize) {
+                    // The other side receives into a ring. The data is written straight to the offset the credit window
+                    // picked, and the offset goes along as immediate data to consume one of the receiver's slots.
+                    wrs[i].opcode = IBV_WR_RDMA_WRITE_WITH_IMM;
+                    wrs[i].wr.rdma.remote_addr = remoteRingAddress + buffers[i]->GetRemoteOffset();
+                    wrs[i].wr.rdma.rkey = remoteRingKey;
+                    wrs[i].imm_data = htonl(static_cast<uint32_t>(buffers[i]->GetRemoteOffset()));
+                } else {
+                    wrs[i].opcode = IBV_WR_SEND;
+                }
+                wrs[i].send_flags = buffers[i]->IsSignaled() ? IBV_SEND_SIGNALED : 0;
+                // Inline payloads are copied into the WQE at post time, saving the NIC a DMA read of the buffer
+                if (sges[i].length && sges[i].length <= effectiveInlineThreshold) {
+                    wrs[i].send_flags |= IBV_SEND_INLINE;
+                }
+            }
+            ibv_send_wr* badWr = nullptr;
+            HandleError(rdma_seterrno(ibv_post_send(cm_id->qp, wrs, &badWr)));
+        } else if (sharedReceivePool) {
+            // Receives are posted to the shared queue as its buffers are returned. Our slots only track what
+            // the sender may have outstanding.
+        } else {
+            ibv_recv_wr wrs[kMaxWorkRequestsPerPost];
+            for (size_t i = 0; i < chainLength; ++i) {
+                // If this process is being instrumented by Valgrind, it has no way of knowing that this buffer for RDMA is going to be written to
+                // by the hardware. This has the downside of flagging memory passed for recv as possibly uninitialized, unless the entity allocating it
+                // initializes it. For recv, this is unnecessary (and costs performance), so it is expected to not do this. Our own internal allocations are not
+                // initialized either. The problem with this is that valgrind becomes unusable, because the possibly-uninitalized data taints a bunch of code paths
+                // (like the credit mechanism). So to be nice for that use case, if we detect we're running under valgrind, we will initialize their memory on every
+                // recv. Note that valgrind already adds so much overhead that this isn't a big deal.
+                if (IsValgrindRunning()) {
+                    memset(buffers[i]->GetPointer(), 0, buffers[i]->GetSize());
+                }
+                wrs[i].wr_id = reinterpret_cast<uintptr_t>(buffers[i]);
+                wrs[i].next = (i + 1 < chainLength) ? &wrs[i + 1] : nullptr;
+                wrs[i].sg_list = &sges[i];
+                // Ring slots have no memory of their own, since the data is written into the ring
+                wrs[i].num_sge = sges[i].length ? 1 : 0;
+            }
+            ibv_recv_wr* badWr = nullptr;
+            HandleError(rdma_seterrno(ibv_post_recv(cm_id->qp, wrs, &badWr)));
+        }
+        buffers += chainLength;
+        numBuffers -= chainLength;
+    }
+}
+
+void RdmaConnectedSession::QueueImmediateCredits(const uint64_t* bufferLengths, size_t numCredits)
+{
+    std::lock_guard<std::mutex> guard(immediateCreditLock);
+    // Credits have to go out in order, so none can skip ahead of ones that are still waiting for room
+    if (!pendingImmediateCredits.empty()) {
+        PostPendingImmediateCredits();
+    }
+    if (pendingImmediateCredits.empty()) {
+        size_t posted = PostImmediateCredits(bufferLengths, numCredits);
+        bufferLengths += posted;
+        numCredits -= posted;
+    }
+    pendingImmediateCredits.insert(pendingImmediateCredits.end(), bufferLengths, bufferLengths + numCredits);
+}
+
+void RdmaConnectedSession::PostPendingImmediateCredits()
+{
+    size_t posted = PostImmediateCredits(pendingImmediateCredits.data(), pendingImmediateCredits.size());
+    pendingImmediateCredits.erase(pendingImmediateCredits.begin(), pendingImmediateCredits.begin() + posted);
+}
+
+size_t RdmaConnectedSession::PostImmediateCredits(const uint64_t* bufferLengths, size_t numCredits)
+{
+    size_t posted = 0;
+    while (posted < numCredits) {
+        size_t chainLength = std::min(numCredits - posted, kMaxWorkRequestsPerPost);
+        chainLength = std::min(chainLength, ReapImmediateCreditSends(chainLength, !useCompletionEngine));
+        if (!chainLength) {
+            break;
+        }
+        ibv_send_wr wrs[kMaxWorkRequestsPerPost];
+        memset(wrs, 0, sizeof(ibv_send_wr) * chainLength);
+        for (size_t i = 0; i < chainLength; ++i) {
+            // Receive buffer lengths always fit since a single SGE can't describe more than 32 bits worth
+            assert(bufferLengths[i] <= std::numeric_limits<uint32_t>::max());
+            wrs[i].next = (i + 1 < chainLength) ? &wrs[i + 1] : nullptr;
+            wrs[i].opcode = IBV_WR_SEND_WITH_IMM;
+            wrs[i].imm_data = htonl(static_cast<uint32_t>(bufferLengths[i]));
+            wrs[i].send_flags = NextImmediateCreditSendFlags();
+        }
+        ibv_send_wr* badWr = nullptr;
+        HandleError(rdma_seterrno(ibv_post_send(cm_id->qp, wrs, &badWr)));
+        immediateCreditSendsOutstanding += chainLength;
+        bufferLengths += chainLength;
+        posted += chainLength;
+    }
+    return posted;
+}
+
+void RdmaConnectedSession::QueueRingAnnouncement(RdmaMemoryRegion* ringRegion, void* ring, uint64_t ringSize)
+{
+    std::lock_guard<std::mutex> guard(immediateCreditLock);
+    ringAnnouncement.address = reinterpret_cast<uintptr_t>(ring);
+    ringAnnouncement.size = ringSize;
+    ringAnnouncement.rkey = ringRegion->GetMR()->rkey;
+    ringAnnouncementRegion = CreateMemoryRegion(&ringAnnouncement, sizeof(ringAnnouncement), MemoryAccess::Local);
+
+    // Goes out on the same stream as the immediate credits, so it is always ahead of the first of them. Nothing has
+    // gone out on that stream before configuring, so there is always room for it.
+    ReapImmediateCreditSends(1, true);
+    ibv_sge sge = {};
+    sge.addr = reinterpret_cast<uintptr_t>(&ringAnnouncement);
+    sge.length = sizeof(ringAnnouncement);
+    sge.lkey = ringAnnouncementRegion->GetMR()->lkey;
+    ibv_send_wr wr = {};
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    wr.opcode = IBV_WR_SEND;
+    wr.send_flags = NextImmediateCreditSendFlags();
+    ibv_send_wr* badWr = nullptr;
+    HandleError(rdma_seterrno(ibv_post_send(cm_id->qp, &wr, &badWr)));
+    ++immediateCreditSendsOutstanding;
+}
+
+size_t RdmaConnectedSession::NextImmediateCreditSendFlags()
+{
+    // Only every Nth credit is signaled. Reaping its completion retires all the unsignaled ones before it.
+    if (++immediateCreditsSinceSignal == kImmediateCreditSignalInterval) {
+        immediateCreditsSinceSignal = 0;
+        return IBV_SEND_SIGNALED;
+    }
+    return 0;
+}
+
+size_t RdmaConnectedSession::ReapImmediateCreditSends(size_t sendsToPost, bool waitForRoom)
+{
+    // Without the completion engine there's no handler thread on the send CQ of a receiving session (unless it is
+    // pulling), so it is drained here instead, spinning when the send queue doesn't have room for the next chain.
+    // That is rare since the other side consumes credits as fast as they arrive. Completion engine threads never
+    // wait, since the one that would repost the receives our sends land in may be the one waiting.
+    ibv_wc wc[kMaxCompletionsPerPoll];
+    do {
+        int numCompletions = ibv_poll_cq(cm_id->send_cq, kMaxCompletionsPerPoll, wc);
+        if (numCompletions < 0) {
+            HandleError(rdma_seterrno(numCompletions));
+        }
+        for (int i = 0; i < numCompletions; ++i) {
+            if (wc[i].wr_id) {
+                // Only reads of pulled transfers carry a buffer. They are handed to the pull handler to dispatch.
+                RdmaBufferCompletion completion;
+                completion.buffer = reinterpret_cast<RdmaBuffer*>(wc[i].wr_id);
+                if (wc[i].status != IBV_WC_SUCCESS) {
+                    completion.status.Assign(RdmaErrorTranslation::IBVErrorToRdmaError(wc[i].status), wc[i].status, __FILE__, __LINE__);
+                } else {
+                    completion.bytesTransferred = completion.buffer->GetUsed();
+                }
+                completedPullReads.push_back(completion);
+                --immediateCreditSendsOutstanding;
+                --pullReadsOutstanding;
+                continue;
+            }
+            if (wc[i].status != IBV_WC_SUCCESS) {
+                RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::IBVErrorToRdmaError(wc[i].status), wc[i].status);
+            }
+            assert(immediateCreditSendsOutstanding >= kImmediateCreditSignalInterval);
+            immediateCreditSendsOutstanding -= kImmediateCreditSignalInterval;
+        }
+        if (!IsConnected()) {
+            RDMA_THROW(easyrdma_Error_Disconnected);
+        }
+    } while (waitForRoom && immediateCreditSendsOutstanding + sendsToPost > kMaxWorkRequestsPerQueue);
+    return kMaxWorkRequestsPerQueue - immediateCreditSendsOutstanding;
+}
+
+void RdmaConnectedSession::QueuePullReads(RdmaBuffer** buffers, size_t numBuffers)
+{
+    std::lock_guard<std::mutex> guard(immediateCreditLock);
+    pendingPullReads.insert(pendingPullReads.end(), buffers, buffers + numBuffers);
+    PostPendingPullReads();
+}
+
+void RdmaConnectedSession::PostPendingPullReads()
+{
+    // Each read is followed by a fenced zero-length write that tells the sender the read is done, so the sender
+    // learns of it without us having to wait for the read to complete first. A read past the depth the QP agreed
+    // to would fail on the sender's side, so the rest stay pending until HandleCreditSendCompletions() reaps one.
+    static const size_t kMaxReadsPerPost = kMaxWorkRequestsPerPost / 2;
+    while (!pendingPullReads.empty() && pullReadsOutstanding < readDepth) {
+        size_t chainLength = std::min({pendingPullReads.size(), kMaxReadsPerPost, readDepth - pullReadsOutstanding});
+        chainLength = std::min(chainLength, ReapImmediateCreditSends(chainLength * 2, !useCompletionEngine) / 2);
+        if (!chainLength) {
+            break;
+        }
+        ibv_sge sges[kMaxReadsPerPost];
+        ibv_send_wr wrs[kMaxReadsPerPost * 2];
+        memset(wrs, 0, sizeof(ibv_send_wr) * chainLength * 2);
+        for (size_t i = 0; i < chainLength; ++i) {
+            RdmaBuffer* buffer = pendingPullReads[i];
+            // The descriptor arrived in the buffer the data is about to be read into
+            auto descriptor = *reinterpret_cast<const easyrdma_PullDescriptor*>(buffer->GetPointer());
+            uint32_t length = static_cast<uint32_t>(buffer->GetUsed());
+            sges[i].addr = reinterpret_cast<uintptr_t>(buffer->GetPointer());
+            sges[i].length = length;
+            sges[i].lkey = buffer->GetMemoryRegion()->GetMR()->lkey;
+            ibv_send_wr& read = wrs[i * 2];
+            read.wr_id = reinterpret_cast<uintptr_t>(buffer);
+            read.next = &wrs[i * 2 + 1];
+            read.sg_list = &sges[i];
+            read.num_sge = length ? 1 : 0;
+            read.opcode = IBV_WR_RDMA_READ;
+            read.send_flags = IBV_SEND_SIGNALED;
+            read.wr.rdma.remote_addr = descriptor.address;
+            read.wr.rdma.rkey = descriptor.rkey;
+            ibv_send_wr& done = wrs[i * 2 + 1];
+            done.next = (i + 1 < chainLength) ? &wrs[i * 2 + 2] : nullptr;
+            done.opcode = IBV_WR_RDMA_WRITE_WITH_IMM;
+            done.imm_data = htonl(length);
+            done.send_flags = NextImmediateCreditSendFlags() | IBV_SEND_FENCE;
+        }
+        ibv_send_wr* badWr = nullptr;
+        HandleError(rdma_seterrno(ibv_post_send(cm_id->qp, wrs, &badWr)));
+        immediateCreditSendsOutstanding += chainLength * 2;
+        pullReadsOutstanding += chainLength;
+        pendingPullReads.erase(pendingPullReads.begin(), pendingPullReads.begin() + chainLength);
+    }
+}
+
+void RdmaConnectedSession::PullHandlerThread()
+{
+    // Reads complete on the send CQ, which the immediate credits also drain whenever the send queue runs short
+    // of room. Whoever reaps a read parks it in completedPullReads and this thread dispatches it. The CQ is armed
+    // before draining, so anything reaped elsewhere afterwards still wakes us up.
+    try {
+        MakeCQsNonBlocking();
+        while (IsConnected()) {
+            int ret = ibv_req_notify_cq(cm_id->send_cq, 0);
+            if (ret) {
+                HandleError(rdma_seterrno(ret));
+            }
+            HandleCreditSendCompletions();
+            if (!queueFdPoller.PollOnFd(cm_id->send_cq_channel->fd, -1)) {
+                break;
+            }
+            ibv_cq* eventCq;
+            void* context;
+            HandleError(ibv_get_cq_event(cm_id->send_cq_channel, &eventCq, &context));
+            ibv_ack_cq_events(cm_id->send_cq, 1);
+        }
+    } catch (std::exception&) {
+        // No-op, silently exit thread.
+    }
+}
+
+void RdmaConnectedSession::HandleCreditSendCompletions()
+{
+    std::vector<RdmaBufferCompletion> completions;
+    {
+        std::lock_guard<std::mutex> guard(immediateCreditLock);
+        ReapImmediateCreditSends(0, false);
+        // Sends and reads that finished make room for the ones that had to wait
+        PostPendingImmediateCredits();
+        PostPendingPullReads();
+        completions.swap(completedPullReads);
+    }
+    if (!completions.empty()) {
+        DispatchCompletions(completions.data(), completions.size());
+    }
+}
+
+void RdmaConnectedSession::RegisterCompletionHandler(Direction cqDirection)
+{
+    ibv_comp_channel* channel = cqDirection == Direction::Send ? cm_id->send_cq_channel : cm_id->recv_cq_channel;
+    auto handler = boost::bind(&RdmaConnectedSession::HandleCompletionEvent, this, cqDirection);
+    completionRegistrations.push_back(GetCompletionEngine().Register(channel->fd, handler));
+}
+
+bool RdmaConnectedSession::HandleCompletionEvent(Direction cqDirection)
+{
+    // Called by the completion engine in place of the handler threads. Everything the channel has signaled is
+    // acknowledged and the CQ is armed again before it is drained, so anything that completes while we drain
+    // signals the channel once more.
+    ibv_cq* cq = cqDirection == Direction::Send ? cm_id->send_cq : cm_id->recv_cq;
+    ibv_comp_channel* channel = cqDirection == Direction::Send ? cm_id->send_cq_channel : cm_id->recv_cq_channel;
+    ibv_cq* eventCq;
+    void* context;
+    unsigned int numEvents = 0;
+    while (ibv_get_cq_event(channel, &eventCq, &context) == 0) {
+        ++numEvents;
+    }
+    if (numEvents) {
+        ibv_ack_cq_events(cq, numEvents);
+    }
+    int ret = ibv_req_notify_cq(cq, 0);
+    if (ret) {
+        HandleError(rdma_seterrno(ret));
+    }
+
+    if (cqDirection == Direction::Send && direction == Direction::Receive && UsesImmediateCredits()) {
+        HandleCreditSendCompletions();
+        return true;
+    }
+    ibv_wc wc[kMaxCompletionsPerPoll];
+    int numCompletions;
+    while ((numCompletions = ibv_poll_cq(cq, kMaxCompletionsPerPoll, wc)) > 0) {
+        if (cqDirection == Direction::Receive && direction == Direction::Send) {
+            if (UsesImmediateCredits()) {
+                if (!HandleImmediateCredits(wc, numCompletions)) {
+                    return false;
+                }
+            } else {
+                HandleCompletions(wc, numCompletions);
+                ProcessCreditMessages();
+            }
+        } else {
+            HandleCompletions(wc, numCompletions);
         }
-        HandleError(rdma_post_recv(cm_id, buffer, buffer->GetPointer(), buffer->GetSize(), buffer->GetMemoryRegion()->GetMR()));
     }
+    if (numCompletions < 0) {
+        HandleError(rdma_seterrno(numCompletions));
+    }
+    return true;
+}
+
+std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access)
+{
+    return std::unique_ptr<RdmaMemoryRegion>(new RdmaMemoryRegion(cm_id, buffer, bufferSize, access));
+}
+
+std::shared_ptr<RdmaMemoryRegion> RdmaConnectedSession::AcquireExternalMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access, bool onDemand)
+{
+    return GetRegistrationCache().Acquire(cm_id, buffer, bufferSize, access, onDemand);
+}
+
+int RdmaConnectedSession::GetNumaNode()
+{
+    // The kernel reports -1 itself for devices that aren't attached to any particular node
+    int numaNode = -1;
+    if (cm_id->verbs) {
+        std::ifstream(std::string("/sys/class/infiniband/") + ibv_get_device_name(cm_id->verbs->device) + "/device/numa_node") >> numaNode;
+    }
+    return numaNode;
+}
+
+uint32_t RdmaConnectedSession::GetOnDemandPagingCaps()
+{
+    return cm_id->verbs ? QueryOnDemandPagingCaps(cm_id->verbs) : 0;
 }
 
-std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void* buffer, size_t bufferSize)
+size_t RdmaConnectedSession::GetReadDepth()
 {
-    return std::unique_ptr<RdmaMemoryRegion>(new RdmaMemoryRegion(cm_id, buffer, bufferSize));
+    return readDepth;
+}
+
+void RdmaConnectedSession::SetReadDepth(rdma_conn_param& connectParams)
+{
+    // Left at zero, the QP can neither issue nor serve RDMA reads. Each side offers what its device allows and the
+    // connection manager settles on what both can handle.
+    ibv_device_attr deviceAttr = {};
+    HandleError(rdma_seterrno(ibv_query_device(cm_id->verbs, &deviceAttr)));
+    connectParams.initiator_depth = static_cast<uint8_t>(std::min(deviceAttr.max_qp_init_rd_atom, 255));
+    connectParams.responder_resources = static_cast<uint8_t>(std::min(deviceAttr.max_qp_rd_atom, 255));
 }
 
 void RdmaConnectedSession::MakeCQsNonBlocking()
@@ -196,32 +657,88 @@ void RdmaConnectedSession::MakeCQsNonBlocking()
     HandleError(fcntl(cm_id->send_cq_channel->fd, F_SETFL, flags | O_NONBLOCK));
 }
 
-void RdmaConnectedSession::PollForReceive(int32_t timeoutMs)
+bool RdmaConnectedSession::PollForReceive(int32_t timeoutMs)
 {
-    ibv_wc wc;
-    PollCompletionQueue(Direction::Receive, &wc, false, timeoutMs);
-    // TRACE("Completed buffer: direction = %s, status = %d, size = %d", direction == Direction::Receive ? "Recv" : "Send", wc.status, wc.byte_len);
-    RdmaBuffer* buffer = reinterpret_cast<RdmaBuffer*>(wc.wr_id);
-    RdmaError completionStatus;
-    if (wc.status != IBV_WC_SUCCESS) {
-        try {
-            RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::IBVErrorToRdmaError(wc.status), wc.status);
-        } catch (const RdmaException& e) {
-            completionStatus.Assign(e.rdmaError);
+    ibv_wc wc[kMaxCompletionsPerPoll];
+    int numCompletions = PollCompletionQueue(Direction::Receive, wc, kMaxCompletionsPerPoll, false, timeoutMs);
+    HandleCompletions(wc, numCompletions);
+    return numCompletions != 0;
+}
+
+void RdmaConnectedSession::HandleCompletions(ibv_wc* wc, int numCompletions)
+{
+    RdmaBufferCompletion completions[kMaxCompletionsPerPoll];
+    RdmaBuffer* pullBuffers[kMaxCompletionsPerPoll];
+    size_t numDispatched = 0;
+    size_t numPulls = 0;
+    assert(numCompletions <= static_cast<int>(kMaxCompletionsPerPoll));
+    for (int i = 0; i < numCompletions; ++i) {
+        // TRACE("Completed buffer: direction = %s, status = %d, size = %d", direction == Direction::Receive ? "Recv" : "Send", wc[i].status, wc[i].byte_len);
+        RdmaBuffer* buffer = reinterpret_cast<RdmaBuffer*>(wc[i].wr_id);
+        if (sharedReceivePool && direction == Direction::Receive) {
+            // The work request id is where in the shared pool the data landed. It completes our oldest queued slot.
+            buffer = nullptr;
+        }
+        if (usePullMode) {
+            if (wc[i].status != IBV_WC_SUCCESS) {
+                // Pulled transfers are completed from another CQ, so a failure here can't be retired in order with
+                // them. The QP is unusable after a failure anyway, so fail everything that is queued.
+                AbortTransfers(RdmaErrorTranslation::IBVErrorToRdmaError(wc[i].status));
+                continue;
+            }
+            if (wc[i].opcode == IBV_WC_SEND) {
+                // Only the descriptor has gone out. The buffer completes once the receiver says it has read it.
+                continue;
+            }
+            if (wc[i].opcode == IBV_WC_RECV && (wc[i].wc_flags & IBV_WC_WITH_IMM)) {
+                // A descriptor to pull from. The length rides along in the immediate data.
+                uint32_t length = ntohl(wc[i].imm_data);
+                if (wc[i].byte_len != sizeof(easyrdma_PullDescriptor) || length > buffer->GetSize()) {
+                    AbortTransfers(easyrdma_Error_SendTooLargeForRecvBuffer);
+                    continue;
+                }
+                buffer->SetCompletedBytes(length);
+                pullBuffers[numPulls++] = buffer;
+                continue;
+            }
+        }
+        RdmaBufferCompletion& completion = completions[numDispatched++];
+        completion.buffer = buffer;
+        if (!buffer) {
+            completion.landedOffset = wc[i].wr_id;
+        }
+        if (wc[i].status != IBV_WC_SUCCESS) {
+            try {
+                RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::IBVErrorToRdmaError(wc[i].status), wc[i].status);
+            } catch (const RdmaException& e) {
+                completion.status.Assign(e.rdmaError);
+            }
+        }
+        switch (wc[i].opcode) {
+            case IBV_WC_RECV:
+                completion.bytesTransferred = wc[i].byte_len;
+                if (completion.status.IsSuccess() && (wc[i].wc_flags & IBV_WC_WITH_IMM)) {
+                    // The sender is pulling, but we weren't told to
+                    completion.status.Assign(easyrdma_Error_OperationNotSupported, 0, __FILE__, __LINE__);
+                    completion.bytesTransferred = 0;
+                }
+                break;
+            case IBV_WC_RECV_RDMA_WITH_IMM:
+                completion.bytesTransferred = wc[i].byte_len;
+                completion.landedOffset = ntohl(wc[i].imm_data);
+                break;
+            case IBV_WC_SEND:
+            case IBV_WC_RDMA_WRITE:
+                completion.bytesTransferred = completion.status.IsSuccess() ? buffer->GetUsed() : 0;
+                break;
+            default:
+                RDMA_THROW(easyrdma_Error_InternalError);
         }
     }
-    size_t bytesTransferred;
-    switch (wc.opcode) {
-        case IBV_WC_RECV:
-            bytesTransferred = wc.byte_len;
-            break;
-        case IBV_WC_SEND:
-            bytesTransferred = completionStatus.IsSuccess() ? buffer->GetUsed() : 0;
-            break;
-        default:
-            RDMA_THROW(easyrdma_Error_InternalError);
+    if (numPulls) {
+        QueuePullReads(pullBuffers, numPulls);
     }
-    buffer->HandleCompletion(completionStatus, bytesTransferred);
+    DispatchCompletions(completions, numDispatched);
 }
 
 // This function is modeled after the inline functions rdma_get_send_comp/rdma_get_recv_comp.
@@ -229,7 +746,9 @@ void RdmaConnectedSession::PollForReceive(int32_t timeoutMs)
 //  - Combine send/recv into a single function with direction specified
 //  - Use the ibv dynlib wrapper instead of directly calling exported functions
 //  - Make use of poll instead of blocking in ibv_get_cq_event and allow cancellation
-void RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc, bool blocking, int32_t nonBlockingPollTimeoutMs)
+//  - Drain up to maxCompletions at once and return how many were retrieved
+//  - A non-blocking poll that times out returns 0 instead of throwing
+int RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc, int maxCompletions, bool blocking, int32_t nonBlockingPollTimeoutMs)
 {
     ibv_cq* cq = _direction == Direction::Send ? cm_id->send_cq : cm_id->recv_cq;
     ibv_comp_channel* channel = _direction == Direction::Send ? cm_id->send_cq_channel : cm_id->recv_cq_channel;
@@ -242,7 +761,7 @@ void RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc,
 
     do {
         // The below are inline functions in the verbs header
-        ret = ibv_poll_cq(cq, 1, wc);
+        ret = ibv_poll_cq(cq, maxCompletions, wc);
         if (ret)
             break;
 
@@ -251,7 +770,7 @@ void RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc,
             if (ret)
                 HandleError(rdma_seterrno(ret));
 
-            ret = ibv_poll_cq(cq, 1, wc);
+            ret = ibv_poll_cq(cq, maxCompletions, wc);
             if (ret)
                 break;
 
@@ -270,7 +789,8 @@ void RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc,
             CheckQueueStatus();
             if (nonBlockingPollTimeoutMs != -1) {
                 if (std::chrono::steady_clock::now() - pollStart > std::chrono::milliseconds(nonBlockingPollTimeoutMs)) {
-                    RDMA_THROW(easyrdma_Error_Timeout);
+                    // Running out of time is routine for a poller, so it's left to the caller to report
+                    break;
                 }
             }
         }
@@ -279,37 +799,17 @@ void RdmaConnectedSession::PollCompletionQueue(Direction _direction, ibv_wc* wc,
     if (ret < 0) {
         HandleError(rdma_seterrno(ret));
     }
+    return ret;
 }
 
 void RdmaConnectedSession::SendReceiveHandlerThread(Direction _direction)
 {
     try {
-        ibv_wc wc;
+        ibv_wc wc[kMaxCompletionsPerPoll];
         MakeCQsNonBlocking();
         while (IsConnected()) {
-            PollCompletionQueue(_direction, &wc, true, 0);
-            // TRACE("Completed buffer: direction = %s, status = %d, size = %d", direction == Direction::Receive ? "Recv" : "Send", wc.status, wc.byte_len);
-            RdmaBuffer* buffer = reinterpret_cast<RdmaBuffer*>(wc.wr_id);
-            RdmaError completionStatus;
-            if (wc.status != IBV_WC_SUCCESS) {
-                try {
-                    RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::IBVErrorToRdmaError(wc.status), wc.status);
-                } catch (const RdmaException& e) {
-                    completionStatus.Assign(e.rdmaError);
-                }
-            }
-            size_t bytesTransferred;
-            switch (wc.opcode) {
-                case IBV_WC_RECV:
-                    bytesTransferred = wc.byte_len;
-                    break;
-                case IBV_WC_SEND:
-                    bytesTransferred = completionStatus.IsSuccess() ? buffer->GetUsed() : 0;
-                    break;
-                default:
-                    RDMA_THROW(easyrdma_Error_InternalError);
-            }
-            buffer->HandleCompletion(completionStatus, bytesTransferred);
+            int numCompletions = PollCompletionQueue(_direction, wc, kMaxCompletionsPerPoll, true, 0);
+            HandleCompletions(wc, numCompletions);
         }
     } catch (std::exception& e) {
         // TRACE("Error in buffer completion: direction = %s, error = %s\n", direction == Direction::Receive ? "Recv" : "Send", e.what());
@@ -317,6 +817,70 @@ void RdmaConnectedSession::SendReceiveHandlerThread(Direction _direction)
     }
 }
 
+void RdmaConnectedSession::ImmediateCreditHandlerThread()
+{
+    try {
+        ibv_wc wc[kMaxCompletionsPerPoll];
+        MakeCQsNonBlocking();
+        while (IsConnected()) {
+            int numCompletions = PollCompletionQueue(Direction::Receive, wc, kMaxCompletionsPerPoll, true, 0);
+            if (!HandleImmediateCredits(wc, numCompletions)) {
+                return;
+            }
+        }
+    } catch (std::exception&) {
+        // No-op, silently exit thread.
+    }
+}
+
+bool RdmaConnectedSession::HandleImmediateCredits(ibv_wc* wc, int numCompletions)
+{
+    RdmaBuffer* buffers[kMaxCompletionsPerPoll];
+    uint64_t bufferSizes[kMaxCompletionsPerPoll];
+    uint64_t pulledSizes[kMaxCompletionsPerPoll];
+    int numCredits = 0;
+    int numPulled = 0;
+    for (int i = 0; i < numCompletions; ++i) {
+        if (wc[i].status != IBV_WC_SUCCESS) {
+            // Flushed by a disconnect
+            return false;
+        }
+        buffers[i] = reinterpret_cast<RdmaBuffer*>(wc[i].wr_id);
+        if (wc[i].opcode == IBV_WC_RECV_RDMA_WITH_IMM) {
+            // The receiver is done reading one of our published regions
+            pulledSizes[numPulled++] = ntohl(wc[i].imm_data);
+        } else if (wc[i].wc_flags & IBV_WC_WITH_IMM) {
+            bufferSizes[numCredits++] = ntohl(wc[i].imm_data);
+        } else if (numCredits || !HandleRingAnnouncement(wc[i])) {
+            // The other side isn't speaking the negotiated protocol
+            return false;
+        }
+    }
+    // The credit receives carry no payload we still need, so they go straight back to the QP without a trip through their queue
+    QueueToQp(Direction::Receive, buffers, numCompletions);
+    AddCredits(bufferSizes, numCredits);
+    if (numPulled) {
+        CompletePulledTransfers(pulledSizes, numPulled);
+    }
+    return true;
+}
+
+bool RdmaConnectedSession::HandleRingAnnouncement(const ibv_wc& wc)
+{
+    // Only the first message may announce a ring, and it must come before any credits
+    if (remoteRingSize || wc.byte_len != sizeof(easyrdma_RingAnnouncement)) {
+        return false;
+    }
+    auto announcement = reinterpret_cast<const easyrdma_RingAnnouncement*>(reinterpret_cast<RdmaBuffer*>(wc.wr_id)->GetPointer());
+    if (!announcement->size || announcement->size > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    remoteRingAddress = announcement->address;
+    remoteRingKey = announcement->rkey;
+    EnableRemoteRing(announcement->size);
+    return true;
+}
+
 void RdmaConnectedSession::SetupQueuePair()
 {
     assert(!createdQp);
@@ -328,14 +892,34 @@ void RdmaConnectedSession::SetupQueuePair()
     // added code to get that on Linux. We can revisit raising these or querying the max
     // if this becomes an issue. There are not many practical applications for having
     // this many concurrently queued requests.
-    qp_init.cap.max_send_wr = 1024;
-    qp_init.cap.max_recv_wr = 1024;
+    qp_init.cap.max_send_wr = kMaxWorkRequestsPerQueue;
+    qp_init.cap.max_recv_wr = kMaxWorkRequestsPerQueue;
     // We always use a single buffer per request
     qp_init.cap.max_recv_sge = 1;
     qp_init.cap.max_send_sge = 1;
+    qp_init.cap.max_inline_data = static_cast<uint32_t>(std::min<uint64_t>(inlineThreshold, std::numeric_limits<uint32_t>::max()));
+    if (sharedReceivePool) {
+        // Receives come from the listener's shared queue instead of our own
+        qp_init.srq = static_cast<RdmaSharedReceiveQueue*>(sharedReceivePool.get())->GetSRQ();
+        qp_init.cap.max_recv_wr = 0;
+        qp_init.cap.max_recv_sge = 0;
+    }
     qp_init.qp_type = IBV_QPT_RC;
     qp_init.qp_context = cm_id;
-    HandleError(rdma_create_qp(cm_id, nullptr, &qp_init));
+    int result = rdma_create_qp(cm_id, nullptr, &qp_init);
+    if (result && qp_init.cap.max_inline_data) {
+        // The device can't reserve the requested inline space. Inlining is only an optimization, so fall back to
+        // regular sends rather than failing the connection. The effective threshold is readable via the property.
+        TRACE("Unable to reserve %u bytes of inline data, disabling inline sends\n", qp_init.cap.max_inline_data);
+        qp_init.cap.max_inline_data = 0;
+        result = rdma_create_qp(cm_id, nullptr, &qp_init);
+    }
+    // Checked here rather than through HandleError(), whose own local would shadow this one
+    if (result == -1) {
+        THROW_OS_ERROR(errno);
+    }
+    // The provider may round the reservation up, but we never inline more than was asked for
+    effectiveInlineThreshold = std::min<uint64_t>(inlineThreshold, qp_init.cap.max_inline_data);
     createdQp = true;
 }
 
@@ -4,9 +4,12 @@
 #pragma once
 #include "RdmaCommon.h"
 #include "RdmaConnectedSessionBase.h"
+#include "RdmaConnectionData.h"
 #include <thread>
+#include <deque>
 #include <boost/thread.hpp>
 #include "FdPoller.h"
+#include "CompletionEngine.h"
 
 class RdmaBufferQueue;
 class RdmaBuffer;
@@ -16,25 +19,47 @@ class RdmaConnectedSession : public RdmaConnectedSessionBase
 {
 public:
     RdmaConnectedSession();
-    RdmaConnectedSession(Direction _direction, rdma_cm_id* acceptedId, const std::vector<uint8_t>& connectionDataIn, const std::vector<uint8_t>& connectionDataOut);
+    RdmaConnectedSession(Direction _direction, rdma_cm_id* acceptedId, const std::vector<uint8_t>& connectionDataIn, const std::vector<uint8_t>& connectionDataOut, uint64_t inlineThreshold, const std::shared_ptr<RdmaSharedReceivePool>& _sharedReceivePool, const std::shared_ptr<RdmaBufferPool>& _bufferPool, const std::shared_ptr<RdmaBufferPool>& _creditBufferPool);
     virtual ~RdmaConnectedSession();
     RdmaAddress GetLocalAddress() override;
     RdmaAddress GetRemoteAddress() override;
 
-    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize);
-    virtual void QueueToQp(Direction _direction, RdmaBuffer* buffer);
+    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access);
+    std::shared_ptr<RdmaMemoryRegion> AcquireExternalMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access, bool onDemand) override;
+    int GetNumaNode() override;
+    uint32_t GetOnDemandPagingCaps() override;
+    size_t GetReadDepth() override;
+    virtual void QueueToQp(Direction _direction, RdmaBuffer** buffers, size_t numBuffers);
+    virtual void QueueImmediateCredits(const uint64_t* bufferLengths, size_t numCredits);
+    virtual void QueueRingAnnouncement(RdmaMemoryRegion* ringRegion, void* ring, uint64_t ringSize);
 
 protected:
     void ConnectionHandlerThread();
     void SendReceiveHandlerThread(Direction _direction);
-    void PollCompletionQueue(Direction _direction, ibv_wc* wc, bool blocking, int32_t nonBlockingPollTimeoutMs);
+    void ImmediateCreditHandlerThread();
+    bool HandleImmediateCredits(ibv_wc* wc, int numCompletions);
+    void PostPendingImmediateCredits();
+    size_t PostImmediateCredits(const uint64_t* bufferLengths, size_t numCredits);
+    // Returns how much room the send queue has left
+    size_t ReapImmediateCreditSends(size_t sendsToPost, bool waitForRoom);
+    bool HandleRingAnnouncement(const ibv_wc& wc);
+    void QueuePullReads(RdmaBuffer** buffers, size_t numBuffers);
+    void PostPendingPullReads();
+    void PullHandlerThread();
+    void HandleCreditSendCompletions();
+    void RegisterCompletionHandler(Direction cqDirection);
+    bool HandleCompletionEvent(Direction cqDirection);
+    int PollCompletionQueue(Direction _direction, ibv_wc* wc, int maxCompletions, bool blocking, int32_t nonBlockingPollTimeoutMs);
+    void HandleCompletions(ibv_wc* wc, int numCompletions);
     void MakeCQsNonBlocking();
     void PostConnect() override;
     void PostConfigure() override;
     void SetupQueuePair() override;
     void DestroyQP() override;
+    void SetReadDepth(rdma_conn_param& connectParams);
     void Destroy();
-    void PollForReceive(int32_t timeoutMs) override;
+    void ReturnUnclaimedSharedReceives();
+    bool PollForReceive(int32_t timeoutMs) override;
 
     rdma_cm_id* cm_id;
     RdmaAddress localAddress;
@@ -43,6 +68,36 @@ protected:
 
     boost::thread transferHandler;
     boost::thread ackHandler;
+    boost::thread pullHandler;
     FdPoller queueFdPoller;
+    // Used instead of the handler threads above when the completion engine is enabled
+    std::vector<CompletionEngine::RegistrationId> completionRegistrations;
     bool createdQp;
+
+    // Immediate credits are posted from whichever thread requeues receive buffers
+    std::mutex immediateCreditLock;
+    size_t immediateCreditsSinceSignal = 0;
+    size_t immediateCreditSendsOutstanding = 0;
+    // Receiver: credits that found the send queue full with the completion engine in use, in the order they were
+    // queued. They go out from the send CQ's handler once earlier sends complete.
+    std::vector<uint64_t> pendingImmediateCredits;
+    size_t NextImmediateCreditSendFlags();
+
+    // Receiver: our ring, sent from registered memory that has to stay put until the send completes
+    EasyRDMA::easyrdma_RingAnnouncement ringAnnouncement = {};
+    std::unique_ptr<RdmaMemoryRegion> ringAnnouncementRegion;
+    // Sender: where transfers are written when the other side receives into a ring
+    uint64_t remoteRingAddress = 0;
+    uint32_t remoteRingKey = 0;
+    // Sender: descriptors of pulled transfers, reused round robin
+    std::vector<EasyRDMA::easyrdma_PullDescriptor> pullDescriptors;
+    std::unique_ptr<RdmaMemoryRegion> pullDescriptorRegion;
+    size_t nextPullDescriptor = 0;
+    // Receiver: reads reaped from the send CQ, waiting for the pull handler to dispatch them
+    std::vector<RdmaBufferCompletion> completedPullReads;
+    // RDMA reads the QP may have in flight, as agreed on when connecting
+    size_t readDepth = 0;
+    // Receiver: descriptors that arrived while readDepth reads were already in flight, in the order they arrived
+    std::deque<RdmaBuffer*> pendingPullReads;
+    size_t pullReadsOutstanding = 0;
 };
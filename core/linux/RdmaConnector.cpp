@@ -56,12 +56,17 @@ void RdmaConnector::Connect(Direction _direction, const RdmaAddress& remoteAddre
         connectParams.private_data_len = connectionData.size();
         connectParams.retry_count = 10;
         connectParams.rnr_retry_count = 10;
+        // Pull mode is only chosen after connecting, so reads are allowed whenever the protocol it needs is offered
+        if (kMaxProtocolVersion >= kImmediateCreditsProtocolVersion) {
+            SetReadDepth(connectParams);
+        }
         HandleError(rdma_connect(cm_id, &connectParams));
         event = GetEventManager().WaitForEvent(cm_id, timeoutMs);
         if (event.eventType != RDMA_CM_EVENT_ESTABLISHED) {
             RDMA_THROW_WITH_SUBCODE(easyrdma_Error_UnableToConnect, event.eventType);
         }
         ValidateConnectionData(event.connectionData, _direction);
+        protocolVersion = NegotiateProtocolVersion(connectionData, event.connectionData);
         PostConnect();
         everConnected = true;
         connectInProgress = false;
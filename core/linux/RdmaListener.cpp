@@ -4,6 +4,7 @@
 #include "RdmaListener.h"
 #include "RdmaCommon.h"
 #include "EventManager.h"
+#include "RdmaSharedReceiveQueue.h"
 #include "api/tAccessSuspender.h"
 
 RdmaListener::RdmaListener(const RdmaAddress& _localAddress) :
@@ -36,7 +37,18 @@ std::shared_ptr<RdmaSession> RdmaListener::Accept(Direction direction, int32_t t
         if (connectRequestEvent.eventType != RDMA_CM_EVENT_CONNECT_REQUEST) {
             RDMA_THROW(easyrdma_Error_UnableToConnect);
         }
-        std::shared_ptr<RdmaSession> connectedSession = std::make_shared<RdmaConnectedSession>(direction, connectRequestEvent.incomingConnectionId, connectRequestEvent.connectionData, connectionData);
+        std::shared_ptr<RdmaSharedReceivePool> sessionReceivePool;
+        if (direction == Direction::Receive && sharedReceiveBufferSize && sharedReceiveBufferCount) {
+            try {
+                sessionReceivePool = GetSharedReceiveQueue(connectRequestEvent.incomingConnectionId);
+            } catch (std::exception&) {
+                // No session owns the incoming id yet
+                rdma_reject(connectRequestEvent.incomingConnectionId, nullptr, 0);
+                rdma_destroy_id(connectRequestEvent.incomingConnectionId);
+                throw;
+            }
+        }
+        std::shared_ptr<RdmaSession> connectedSession = std::make_shared<RdmaConnectedSession>(direction, connectRequestEvent.incomingConnectionId, connectRequestEvent.connectionData, connectionData, inlineThreshold, sessionReceivePool, bufferPool, creditBufferPool);
         acceptInProgress = false;
         return connectedSession;
     } catch (std::exception&) {
@@ -45,6 +57,18 @@ std::shared_ptr<RdmaSession> RdmaListener::Accept(Direction direction, int32_t t
     }
 }
 
+std::shared_ptr<RdmaSharedReceivePool> RdmaListener::GetSharedReceiveQueue(rdma_cm_id* incomingId)
+{
+    if (!sharedReceivePool) {
+        sharedReceivePool = std::make_shared<RdmaSharedReceiveQueue>(incomingId, sharedReceiveBufferSize, sharedReceiveBufferCount);
+    }
+    // The queue belongs to one device. A listener bound to a wildcard address can take connections on others.
+    if (static_cast<RdmaSharedReceiveQueue*>(sharedReceivePool.get())->GetPD() != incomingId->pd) {
+        RDMA_THROW(easyrdma_Error_OperationNotSupported);
+    }
+    return sharedReceivePool;
+}
+
 RdmaAddress RdmaListener::GetLocalAddress()
 {
     return localAddress;
@@ -22,6 +22,8 @@ public:
     void Cancel() override;
 
 private:
+    std::shared_ptr<RdmaSharedReceivePool> GetSharedReceiveQueue(rdma_cm_id* incomingId);
+
     rdma_cm_id* cm_id;
     RdmaAddress localAddress;
     bool acceptInProgress;
@@ -4,15 +4,40 @@
 #pragma once
 
 #include "RdmaCommon.h"
+#include "RdmaSession.h"
 #include "rdma/rdma_verbs.h"
 
 class RdmaMemoryRegion
 {
 public:
-    RdmaMemoryRegion(rdma_cm_id* _cm_id, void* buffer, size_t length) :
+    // With onDemand, the memory isn't pinned and the device faults pages in as it uses them. A null buffer with a length
+    // of SIZE_MAX covers the whole address space (implicit on-demand paging).
+    RdmaMemoryRegion(rdma_cm_id* _cm_id, void* buffer, size_t length, MemoryAccess access, bool onDemand = false) :
         cm_id(_cm_id)
     {
-        mr = rdma_reg_msgs(cm_id, buffer, length);
+        if (onDemand) {
+            // The librdmacm helpers can't pass extra access flags, so these match what each of them asks for
+            int flags = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_ON_DEMAND;
+            if (access == MemoryAccess::RemoteWrite) {
+                flags |= IBV_ACCESS_REMOTE_WRITE;
+            } else if (access == MemoryAccess::RemoteRead) {
+                flags |= IBV_ACCESS_REMOTE_READ;
+            }
+            mr = ibv_reg_mr(cm_id->pd, buffer, length, flags);
+            HandleErrorFromPointer(mr);
+            return;
+        }
+        switch (access) {
+            case MemoryAccess::RemoteWrite:
+                mr = rdma_reg_write(cm_id, buffer, length);
+                break;
+            case MemoryAccess::RemoteRead:
+                mr = rdma_reg_read(cm_id, buffer, length);
+                break;
+            default:
+                mr = rdma_reg_msgs(cm_id, buffer, length);
+                break;
+        }
         HandleErrorFromPointer(mr);
     }
     ~RdmaMemoryRegion()
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#include "RdmaRegistrationCache.h"
+#include <algorithm>
+#include <limits>
+
+static RdmaRegistrationCache registrationCache;
+
+RdmaRegistrationCache& GetRegistrationCache()
+{
+    return registrationCache;
+}
+
+RdmaRegistrationCache::Domain::~Domain()
+{
+    if (cm_id) {
+        rdma_destroy_id(cm_id);
+    }
+}
+
+void RdmaRegistrationCache::Register(const RdmaAddress& localAddress, void* buffer, size_t length, MemoryAccess access, bool onDemand)
+{
+    bool implicit = onDemand && !buffer && length == std::numeric_limits<size_t>::max();
+    if ((!buffer || !length) && !implicit) {
+        RDMA_THROW(easyrdma_Error_InvalidArgument);
+    }
+    // Binding an id to the address is what ties it to a device, and so to the device's protection domain
+    std::shared_ptr<Domain> domain = std::make_shared<Domain>();
+    HandleError(rdma_create_id(nullptr, &domain->cm_id, nullptr, RDMA_PS_TCP));
+    RdmaAddress bindAddress(localAddress);
+    HandleError(rdma_bind_addr(domain->cm_id, bindAddress));
+    if (!domain->cm_id->pd) {
+        RDMA_THROW(easyrdma_Error_InvalidAddress);
+    }
+    if (onDemand) {
+        uint32_t required = easyrdma_OnDemandPagingCaps_Supported;
+        required |= (access == MemoryAccess::RemoteRead) ? easyrdma_OnDemandPagingCaps_PullMode : 0;
+        required |= implicit ? easyrdma_OnDemandPagingCaps_Implicit : 0;
+        if ((QueryOnDemandPagingCaps(domain->cm_id->verbs) & required) != required) {
+            RDMA_THROW(easyrdma_Error_OperationNotSupported);
+        }
+    }
+
+    // Registering a large buffer takes a while, so it is done without the lock
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->pd = domain->cm_id->pd;
+    entry->start = reinterpret_cast<uintptr_t>(buffer);
+    entry->end = entry->start + length;
+    entry->access = access;
+    entry->pinned = true;
+    entry->region.reset(new RdmaMemoryRegion(domain->cm_id, buffer, length, access, onDemand));
+
+    std::lock_guard<std::mutex> guard(cacheLock);
+    domains.erase(std::remove_if(domains.begin(), domains.end(), [](const std::weak_ptr<Domain>& existing) { return existing.expired(); }), domains.end());
+    for (auto& existing : domains) {
+        auto existingDomain = existing.lock();
+        if (existingDomain && existingDomain->cm_id->pd == entry->pd) {
+            entry->domain = existingDomain;
+            break;
+        }
+    }
+    if (!entry->domain) {
+        entry->domain = domain;
+        domains.push_back(domain);
+    }
+    entries.push_back(entry);
+}
+
+void RdmaRegistrationCache::Unregister(void* buffer)
+{
+    std::vector<std::shared_ptr<Entry>> removed;
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        for (auto& entry : entries) {
+            if (entry->pinned && entry->start == reinterpret_cast<uintptr_t>(buffer)) {
+                entry->pinned = false;
+                removed.push_back(entry);
+            }
+        }
+        if (removed.empty()) {
+            RDMA_THROW(easyrdma_Error_InvalidArgument);
+        }
+        // Any still in use are deregistered once the last session lets go of them
+        for (auto& entry : removed) {
+            if (!entry->users) {
+                Remove(entry);
+            }
+        }
+    }
+    // The regions are deregistered here, without the lock, as the last references go away
+}
+
+std::shared_ptr<RdmaMemoryRegion> RdmaRegistrationCache::Acquire(rdma_cm_id* cm_id, void* buffer, size_t length, MemoryAccess access, bool onDemand)
+{
+    uintptr_t start = reinterpret_cast<uintptr_t>(buffer);
+    uintptr_t end = start + length;
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        auto entry = FindCovering(cm_id->pd, start, end, access);
+        if (entry) {
+            return Hold(entry);
+        }
+    }
+
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->pd = cm_id->pd;
+    entry->start = start;
+    entry->end = end;
+    entry->access = access;
+    entry->region.reset(new RdmaMemoryRegion(cm_id, buffer, length, access, onDemand));
+
+    std::lock_guard<std::mutex> guard(cacheLock);
+    // Another session may have registered the same memory in the meantime, in which case ours goes unused
+    auto existing = FindCovering(cm_id->pd, start, end, access);
+    if (existing) {
+        return Hold(existing);
+    }
+    entries.push_back(entry);
+    return Hold(entry);
+}
+
+size_t RdmaRegistrationCache::GetRegistrationCount()
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    return entries.size();
+}
+
+std::shared_ptr<RdmaRegistrationCache::Entry> RdmaRegistrationCache::FindCovering(ibv_pd* pd, uintptr_t start, uintptr_t end, MemoryAccess access)
+{
+    for (auto& entry : entries) {
+        // Any registration can be used locally, but remote access has to have been granted as asked for
+        if (entry->pd == pd && entry->start <= start && end <= entry->end && (access == MemoryAccess::Local || entry->access == access)) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<RdmaMemoryRegion> RdmaRegistrationCache::Hold(const std::shared_ptr<Entry>& entry)
+{
+    ++entry->users;
+    return std::shared_ptr<RdmaMemoryRegion>(entry->region.get(), [this, entry](RdmaMemoryRegion*) {
+        Release(entry);
+    });
+}
+
+void RdmaRegistrationCache::Remove(const std::shared_ptr<Entry>& entry)
+{
+    entries.erase(std::remove(entries.begin(), entries.end(), entry), entries.end());
+}
+
+void RdmaRegistrationCache::Release(const std::shared_ptr<Entry>& entry)
+{
+    std::lock_guard<std::mutex> guard(cacheLock);
+    if (!--entry->users && !entry->pinned) {
+        Remove(entry);
+    }
+}
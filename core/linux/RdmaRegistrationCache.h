@@ -0,0 +1,69 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaCommon.h"
+#include "RdmaAddress.h"
+#include "RdmaMemoryRegion.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Memory registrations shared by every session in the process, keyed by protection domain and address range.
+// librdmacm gives all ids on a device the same protection domain, so a region registered once can be used by any
+// session on that device.
+//
+// Memory registered explicitly stays registered until it is unregistered, and past that for as long as a session is
+// still using it. Registrations made for a session on its own are shared with other sessions using the same memory
+// at the same time, but are released along with the last of them: once nobody holds the memory, there is nothing to
+// tell us if it was freed and its addresses handed out again.
+//
+// A registration covers the same memory whether or not it was made for on-demand paging, so either kind is reused
+// for the other. An implicit on-demand registration of the whole address space covers everything on its device.
+class RdmaRegistrationCache
+{
+public:
+    // Registers memory on the device behind localAddress until Unregister() is called. With onDemand, a null buffer
+    // and a length of SIZE_MAX register the whole address space.
+    void Register(const RdmaAddress& localAddress, void* buffer, size_t length, MemoryAccess access, bool onDemand);
+    // Drops every explicit registration starting at buffer
+    void Unregister(void* buffer);
+    // Returns a registration in the protection domain of cm_id that covers the buffer with at least the access
+    // asked for, registering it if there isn't one. It is held until the returned pointer is released.
+    std::shared_ptr<RdmaMemoryRegion> Acquire(rdma_cm_id* cm_id, void* buffer, size_t length, MemoryAccess access, bool onDemand);
+    size_t GetRegistrationCount();
+
+private:
+    // Keeps a device's protection domain alive, since librdmacm frees it once no id refers to the device
+    struct Domain
+    {
+        ~Domain();
+        rdma_cm_id* cm_id = nullptr;
+    };
+    struct Entry
+    {
+        ibv_pd* pd;
+        uintptr_t start;
+        uintptr_t end;
+        MemoryAccess access;
+        std::unique_ptr<RdmaMemoryRegion> region;
+        // Set for explicit registrations, which hold their device's protection domain themselves. Sessions using
+        // the others hold it through their own ids.
+        std::shared_ptr<Domain> domain;
+        bool pinned = false;
+        size_t users = 0;
+    };
+
+    // Called with the lock held
+    std::shared_ptr<Entry> FindCovering(ibv_pd* pd, uintptr_t start, uintptr_t end, MemoryAccess access);
+    std::shared_ptr<RdmaMemoryRegion> Hold(const std::shared_ptr<Entry>& entry);
+    void Remove(const std::shared_ptr<Entry>& entry);
+
+    void Release(const std::shared_ptr<Entry>& entry);
+
+    std::mutex cacheLock;
+    std::vector<std::shared_ptr<Entry>> entries;
+    std::vector<std::weak_ptr<Domain>> domains;
+};
+
+RdmaRegistrationCache& GetRegistrationCache();
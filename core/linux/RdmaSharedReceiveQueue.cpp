@@ -0,0 +1,105 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#include "RdmaSharedReceiveQueue.h"
+#include <algorithm>
+#include <limits>
+
+// Maximum number of receives linked into a single post to the SRQ
+static const size_t kMaxReceivesPerPost = 64;
+
+RdmaSharedReceiveQueue::RdmaSharedReceiveQueue(rdma_cm_id* cm_id, size_t _bufferSize, size_t _numBuffers) :
+    pd(cm_id->pd), bufferSize(_bufferSize), numBuffers(_numBuffers)
+{
+    // A single SGE can't describe more than 32 bits worth
+    if (bufferSize == 0 || bufferSize > std::numeric_limits<uint32_t>::max() || numBuffers == 0 || numBuffers > std::numeric_limits<uint32_t>::max()) {
+        RDMA_THROW(easyrdma_Error_InvalidSize);
+    }
+    // Keep every buffer cache-aligned
+    size_t stride = (bufferSize + 63) & ~static_cast<size_t>(63);
+    bufferSize = stride;
+    pool = AllocateAlignedMemory(bufferSize * numBuffers, 64);
+    try {
+        memoryRegion.reset(new RdmaMemoryRegion(cm_id, pool, bufferSize * numBuffers, MemoryAccess::Local));
+        ibv_srq_init_attr attr = {};
+        attr.attr.max_wr = static_cast<uint32_t>(numBuffers);
+        attr.attr.max_sge = 1;
+        srq = ibv_create_srq(pd, &attr);
+        HandleErrorFromPointer(srq);
+
+        std::vector<uint64_t> offsets(numBuffers);
+        for (size_t i = 0; i < numBuffers; ++i) {
+            offsets[i] = i * bufferSize;
+        }
+        ReturnBuffers(offsets.data(), offsets.size());
+        // Sessions may together hold more slots than there are buffers, so keep an eye out for the pool running low
+        lowWaterMark = static_cast<uint32_t>(std::max<size_t>(numBuffers / 8, 1));
+        if (lowWaterMark < numBuffers) {
+            ArmLimit();
+        }
+    } catch (std::exception&) {
+        if (srq) {
+            ibv_destroy_srq(srq);
+        }
+        memoryRegion.reset();
+        FreeAlignedMemory(pool);
+        throw;
+    }
+}
+
+RdmaSharedReceiveQueue::~RdmaSharedReceiveQueue()
+{
+    // Every QP attached to us holds a reference, so they are all gone by now
+    ibv_destroy_srq(srq);
+    memoryRegion.reset();
+    FreeAlignedMemory(pool);
+}
+
+void RdmaSharedReceiveQueue::ReturnBuffers(const uint64_t* offsets, size_t numToReturn)
+{
+    ibv_sge sges[kMaxReceivesPerPost];
+    ibv_recv_wr wrs[kMaxReceivesPerPost];
+    const size_t numReturned = numToReturn;
+    while (numToReturn) {
+        size_t chainLength = std::min(numToReturn, kMaxReceivesPerPost);
+        for (size_t i = 0; i < chainLength; ++i) {
+            assert(offsets[i] % bufferSize == 0 && offsets[i] < bufferSize * numBuffers);
+            sges[i].addr = reinterpret_cast<uintptr_t>(pool) + offsets[i];
+            sges[i].length = static_cast<uint32_t>(bufferSize);
+            sges[i].lkey = memoryRegion->GetMR()->lkey;
+            // The offset is all a session needs to find the data again
+            wrs[i].wr_id = offsets[i];
+            wrs[i].next = (i + 1 < chainLength) ? &wrs[i + 1] : nullptr;
+            wrs[i].sg_list = &sges[i];
+            wrs[i].num_sge = 1;
+        }
+        ibv_recv_wr* badWr = nullptr;
+        HandleError(rdma_seterrno(ibv_post_srq_recv(srq, wrs, &badWr)));
+        offsets += chainLength;
+        numToReturn -= chainLength;
+    }
+    CheckLimit(numReturned);
+}
+
+void RdmaSharedReceiveQueue::ArmLimit()
+{
+    ibv_srq_attr attr = {};
+    attr.srq_limit = lowWaterMark;
+    HandleError(rdma_seterrno(ibv_modify_srq(srq, &attr, IBV_SRQ_LIMIT)));
+}
+
+void RdmaSharedReceiveQueue::CheckLimit(size_t numReturned)
+{
+    if (!lowWaterMark || lowWaterMark >= numBuffers || returnedSinceCheck.fetch_add(numReturned) + numReturned < lowWaterMark) {
+        return;
+    }
+    returnedSinceCheck = 0;
+    // A limit that reads back as zero has fired since it was last armed
+    ibv_srq_attr attr = {};
+    HandleError(rdma_seterrno(ibv_query_srq(srq, &attr)));
+    if (attr.srq_limit == 0) {
+        ++shortages;
+        TRACE("Shared receive queue fell below %u posted buffers\n", lowWaterMark);
+        ArmLimit();
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaCommon.h"
+#include "RdmaSharedReceivePool.h"
+#include "RdmaMemoryRegion.h"
+#include <atomic>
+#include <memory>
+
+// A shared receive queue (SRQ) and the pool of buffers posted to it. Every QP attached to it takes its receives
+// from the same pool, but each still reports them on its own receive CQ, which is how data finds its session.
+class RdmaSharedReceiveQueue : public RdmaSharedReceivePool
+{
+public:
+    // The protection domain of the given id is used, so only ids on the same device can attach to the queue
+    RdmaSharedReceiveQueue(rdma_cm_id* cm_id, size_t _bufferSize, size_t _numBuffers);
+    virtual ~RdmaSharedReceiveQueue();
+
+    void* GetBase() const override
+    {
+        return pool;
+    }
+    size_t GetBufferSize() const override
+    {
+        return bufferSize;
+    }
+    RdmaMemoryRegion* GetMemoryRegion() const override
+    {
+        return memoryRegion.get();
+    }
+    void ReturnBuffers(const uint64_t* offsets, size_t numBuffers) override;
+    uint64_t GetShortages() const override
+    {
+        return shortages;
+    }
+
+    ibv_srq* GetSRQ() const
+    {
+        return srq;
+    }
+    ibv_pd* GetPD() const
+    {
+        return pd;
+    }
+
+private:
+    void ArmLimit();
+    void CheckLimit(size_t numReturned);
+
+    ibv_pd* pd = nullptr;
+    ibv_srq* srq = nullptr;
+    void* pool = nullptr;
+    size_t bufferSize = 0;
+    size_t numBuffers = 0;
+    // The adapter disarms the SRQ limit once fewer buffers than this are posted. We look for that every so many
+    // returned buffers rather than on each return, since querying the SRQ is a trip into the kernel.
+    uint32_t lowWaterMark = 0;
+    std::atomic<size_t> returnedSinceCheck = {0};
+    std::atomic<uint64_t> shortages = {0};
+    std::unique_ptr<RdmaMemoryRegion> memoryRegion;
+};
@@ -0,0 +1,33 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaError.h"
+#include "api/easyrdma.h"
+
+// The process-wide completion engine is only implemented on Linux. Sessions here always use their own handler
+// threads, so only the default (disabled) setting is accepted.
+class CompletionEngine
+{
+public:
+    void SetThreadCount(size_t count)
+    {
+        if (count) {
+            RDMA_THROW(easyrdma_Error_OperationNotSupported);
+        }
+    }
+    size_t GetThreadCount()
+    {
+        return 0;
+    }
+    bool IsEnabled()
+    {
+        return false;
+    }
+};
+
+inline CompletionEngine& GetCompletionEngine()
+{
+    static CompletionEngine completionEngine;
+    return completionEngine;
+}
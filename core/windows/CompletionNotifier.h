@@ -0,0 +1,23 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaError.h"
+#include "api/easyrdma.h"
+
+// Completion notification fds are only implemented on Linux
+class CompletionNotifier
+{
+public:
+    CompletionNotifier()
+    {
+        RDMA_THROW(easyrdma_Error_OperationNotSupported);
+    }
+    void Signal()
+    {
+    }
+    int32_t GetFd() const
+    {
+        return -1;
+    }
+};
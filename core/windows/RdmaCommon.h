@@ -212,3 +212,30 @@ inline void FreeAlignedMemory(void* ptr)
 {
     _aligned_free(ptr);
 }
+
+// Large pages need the SeLockMemoryPrivilege, so this falls back to regular pages without it. The adapter's NUMA
+// node isn't known here, so numaNode is always -1.
+inline void* AllocateHugePageMemory(size_t& size, int numaNode)
+{
+    void* memory = nullptr;
+    size_t largePageSize = GetLargePageMinimum();
+    if (largePageSize) {
+        size_t roundedSize = (size + largePageSize - 1) / largePageSize * largePageSize;
+        memory = VirtualAlloc(nullptr, roundedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory) {
+            size = roundedSize;
+        }
+    }
+    if (!memory) {
+        memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!memory) {
+            RDMA_THROW(easyrdma_Error_OutOfMemory);
+        }
+    }
+    return memory;
+}
+
+inline void FreeHugePageMemory(void* ptr, size_t size)
+{
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
@@ -18,8 +18,8 @@ RdmaConnectedSession::RdmaConnectedSession() :
 {
 }
 
-RdmaConnectedSession::RdmaConnectedSession(Direction _direction, IND2Adapter* _adapter, HANDLE _adapterFile, IND2Connector* _incomingConnection, const std::vector<uint8_t>& _connectionData, int32_t timeoutMs) :
-    RdmaConnectedSessionBase(_connectionData),
+RdmaConnectedSession::RdmaConnectedSession(Direction _direction, IND2Adapter* _adapter, HANDLE _adapterFile, IND2Connector* _incomingConnection, const std::vector<uint8_t>& _connectionData, uint64_t _inlineThreshold, int32_t timeoutMs) :
+    RdmaConnectedSessionBase(_connectionData, _inlineThreshold),
     adapterFile(_adapterFile),
     adapter(_adapter),
     connector(_incomingConnection),
@@ -95,7 +95,8 @@ void RdmaConnectedSession::SetupQueuePair()
     // but realistically most NICs seem to have the maximum be virtually unbounded, so it doesn't seem
     // to matter.
     DWORD queueDepth = std::min(adapterInfo.MaxCompletionQueueDepth, adapterInfo.MaxInitiatorQueueDepth);
-    DWORD inlineThreshold = adapterInfo.InlineRequestThreshold;
+    DWORD maxInlineData = adapterInfo.InlineRequestThreshold;
+    effectiveInlineThreshold = std::min<uint64_t>(inlineThreshold, maxInlineData);
 
     HandleHR(adapter->CreateCompletionQueue(
         IID_IND2CompletionQueue,
@@ -115,7 +116,7 @@ void RdmaConnectedSession::SetupQueuePair()
         queueDepth,
         nSge,
         nSge,
-        inlineThreshold,
+        maxInlineData,
         qp));
 }
 
@@ -131,10 +132,10 @@ void RdmaConnectedSession::PostConnect()
     HandleHR(connector->GetPeerAddress(reinterpret_cast<sockaddr*>(&remoteAddress.address), &addrSize));
 
     assert(!eventHandler.joinable());
-    eventHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::EventHandlerThread, this), kThreadPriority::Normal, "EventHandler");
+    StartThread(eventHandler, easyrdma_ThreadRole_Connection, boost::bind(&RdmaConnectedSession::EventHandlerThread, this), kThreadPriority::Normal, "EventHandler");
 
     RdmaConnectedSessionBase::PostConnect();
-    connectionHandler = CreatePriorityThread(boost::bind(&RdmaConnectedSession::ConnectionHandlerThread, this), kThreadPriority::Normal, "ConnHandler");
+    StartThread(connectionHandler, easyrdma_ThreadRole_Connection, boost::bind(&RdmaConnectedSession::ConnectionHandlerThread, this), kThreadPriority::Normal, "ConnHandler");
 }
 
 void RdmaConnectedSession::ConnectionHandlerThread()
@@ -156,29 +157,33 @@ void RdmaConnectedSession::EventHandlerThread()
     OverlappedWrapper overlappedLocal;
     try {
         while (!_closing && cq.get()) {
-            ND2_RESULT ndRes = {};
-            while (!_closing && cq.get() && cq->GetResults(&ndRes, 1) > 0) {
-                RdmaBuffer* buffer = static_cast<RdmaBuffer*>(ndRes.RequestContext);
-                RdmaError completionStatus;
-                if (ndRes.Status != ND_SUCCESS) {
-                    try {
-                        RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::OSErrorToRdmaError(ndRes.Status), ndRes.Status);
-                    } catch (const RdmaException& e) {
-                        completionStatus.Assign(e.rdmaError);
+            ND2_RESULT ndRes[kMaxCompletionsPerPoll] = {};
+            ULONG numResults = 0;
+            while (!_closing && cq.get() && (numResults = cq->GetResults(ndRes, kMaxCompletionsPerPoll)) > 0) {
+                RdmaBufferCompletion completions[kMaxCompletionsPerPoll];
+                for (ULONG i = 0; i < numResults; ++i) {
+                    RdmaBuffer* buffer = static_cast<RdmaBuffer*>(ndRes[i].RequestContext);
+                    RdmaBufferCompletion& completion = completions[i];
+                    completion.buffer = buffer;
+                    if (ndRes[i].Status != ND_SUCCESS) {
+                        try {
+                            RDMA_THROW_WITH_SUBCODE(RdmaErrorTranslation::OSErrorToRdmaError(ndRes[i].Status), ndRes[i].Status);
+                        } catch (const RdmaException& e) {
+                            completion.status.Assign(e.rdmaError);
+                        }
+                    }
+                    switch (ndRes[i].RequestType) {
+                        case Nd2RequestTypeReceive:
+                            completion.bytesTransferred = ndRes[i].BytesTransferred;
+                            break;
+                        case Nd2RequestTypeSend:
+                            completion.bytesTransferred = completion.status.IsSuccess() ? buffer->GetUsed() : 0;
+                            break;
+                        default:
+                            RDMA_THROW(easyrdma_Error_InternalError);
                     }
                 }
-                size_t bytesTransferred;
-                switch (ndRes.RequestType) {
-                    case Nd2RequestTypeReceive:
-                        bytesTransferred = ndRes.BytesTransferred;
-                        break;
-                    case Nd2RequestTypeSend:
-                        bytesTransferred = completionStatus.IsSuccess() ? buffer->GetUsed() : 0;
-                        break;
-                    default:
-                        RDMA_THROW(easyrdma_Error_InternalError);
-                }
-                buffer->HandleCompletion(completionStatus, bytesTransferred);
+                DispatchCompletions(completions, numResults);
             }
             HandleHROverlapped(cq->Notify(ND_CQ_NOTIFY_ANY, overlappedLocal), cq, overlappedLocal);
         }
@@ -200,8 +205,14 @@ RdmaAddress RdmaConnectedSession::GetRemoteAddress()
     return remoteAddress;
 }
 
-std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void* buffer, size_t bufferSize)
+std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access)
 {
+    ULONG flags = ND_MR_FLAG_ALLOW_LOCAL_WRITE;
+    if (access == MemoryAccess::RemoteWrite) {
+        flags |= ND_MR_FLAG_ALLOW_REMOTE_WRITE;
+    } else if (access == MemoryAccess::RemoteRead) {
+        flags |= ND_MR_FLAG_ALLOW_REMOTE_READ;
+    }
     AutoRef<IND2MemoryRegion> memoryRegion;
     HandleHR(adapter->CreateMemoryRegion(
         IID_IND2MemoryRegion,
@@ -211,7 +222,7 @@ std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void*
     HandleHROverlapped(memoryRegion->Register(
                            buffer,
                            bufferSize,
-                           ND_MR_FLAG_ALLOW_LOCAL_WRITE,
+                           flags,
                            overlapped),
         memoryRegion,
         overlapped);
@@ -220,16 +231,53 @@ std::unique_ptr<RdmaMemoryRegion> RdmaConnectedSession::CreateMemoryRegion(void*
     return std::move(memoryRegionWrapper);
 }
 
-void RdmaConnectedSession::QueueToQp(Direction _direction, RdmaBuffer* buffer)
+std::shared_ptr<RdmaMemoryRegion> RdmaConnectedSession::AcquireExternalMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access, bool onDemand)
+{
+    if (onDemand) {
+        RDMA_THROW(easyrdma_Error_OperationNotSupported);
+    }
+    // Registrations can't be shared between adapters, so each session has its own. See RdmaRegistrationCache.
+    return CreateMemoryRegion(buffer, bufferSize, access);
+}
+
+int RdmaConnectedSession::GetNumaNode()
 {
-    ND2_SGE sge = {};
-    sge.Buffer = buffer->GetBuffer();
-    sge.BufferLength = _direction == Direction::Receive ? static_cast<ULONG>(buffer->GetBufferLen())
-                                                        : static_cast<ULONG>(buffer->GetUsed());
-    sge.MemoryRegionToken = buffer->GetMemoryRegion()->GetMRLocalToken();
+    return -1;
+}
 
-    HandleHR(_direction == Direction::Receive ? GetQP()->Receive(buffer, &sge, 1)
-                                              : GetQP()->Send(buffer, &sge, 1, 0));
+uint32_t RdmaConnectedSession::GetOnDemandPagingCaps()
+{
+    // NetworkDirect always pins registered memory
+    return 0;
+}
+
+size_t RdmaConnectedSession::GetReadDepth()
+{
+    // Nothing here issues RDMA reads, so none are asked for when connecting
+    return 0;
+}
+
+void RdmaConnectedSession::QueueToQp(Direction _direction, RdmaBuffer** buffers, size_t numBuffers)
+{
+    for (size_t i = 0; i < numBuffers; ++i) {
+        RdmaBuffer* buffer = buffers[i];
+        ND2_SGE sge = {};
+        sge.Buffer = buffer->GetBuffer();
+        sge.BufferLength = _direction == Direction::Receive ? static_cast<ULONG>(buffer->GetBufferLen())
+                                                            : static_cast<ULONG>(buffer->GetUsed());
+        sge.MemoryRegionToken = buffer->GetMemoryRegion()->GetMRLocalToken();
+
+        // ND2 has no chained posting, but sends can defer ringing the doorbell until the last one in the batch
+        ULONG sendFlags = (i + 1 < numBuffers) ? ND_OP_FLAG_DEFER : 0;
+        if (!buffer->IsSignaled()) {
+            sendFlags |= ND_OP_FLAG_SILENT_SUCCESS;
+        }
+        if (sge.BufferLength && sge.BufferLength <= effectiveInlineThreshold) {
+            sendFlags |= ND_OP_FLAG_INLINE;
+        }
+        HandleHR(_direction == Direction::Receive ? GetQP()->Receive(buffer, &sge, 1)
+                                                  : GetQP()->Send(buffer, &sge, 1, sendFlags));
+    }
 }
 
 void RdmaConnectedSession::AcquireAndValidateConnectionData(IND2Connector* connector, Direction direction)
@@ -242,9 +290,22 @@ void RdmaConnectedSession::AcquireAndValidateConnectionData(IND2Connector* conne
     HandleHROverlapped(connector->GetPrivateData(&connectionDataBuffer[0], &cdSize), connector, overlapped);
     connectionDataBuffer.resize(cdSize);
     ValidateConnectionData(connectionDataBuffer, direction);
+    protocolVersion = NegotiateProtocolVersion(connectionData, connectionDataBuffer);
+}
+
+void RdmaConnectedSession::QueueImmediateCredits(const uint64_t* bufferLengths, size_t numCredits)
+{
+    // Shouldn't get here since ND2 can't send immediate data and we never negotiate that protocol version
+    RDMA_THROW(easyrdma_Error_InternalError);
+}
+
+void RdmaConnectedSession::QueueRingAnnouncement(RdmaMemoryRegion* ringRegion, void* ring, uint64_t ringSize)
+{
+    // Rings are only enabled on top of immediate credits, which we never negotiate
+    RDMA_THROW(easyrdma_Error_InternalError);
 }
 
-void RdmaConnectedSession::PollForReceive(int32_t timeoutMs)
+bool RdmaConnectedSession::PollForReceive(int32_t timeoutMs)
 {
     // Shouldn't get here since it isn't allowed
     RDMA_THROW(easyrdma_Error_InternalError);
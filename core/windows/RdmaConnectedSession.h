@@ -16,15 +16,21 @@ class RdmaConnectedSession : public RdmaConnectedSessionBase
 {
 public:
     RdmaConnectedSession();
-    RdmaConnectedSession(Direction _direction, IND2Adapter* _adapter, HANDLE _adapterFile, IND2Connector* _incomingConnection, const std::vector<uint8_t>& _connectionData, int32_t timeoutMs);
+    RdmaConnectedSession(Direction _direction, IND2Adapter* _adapter, HANDLE _adapterFile, IND2Connector* _incomingConnection, const std::vector<uint8_t>& _connectionData, uint64_t _inlineThreshold, int32_t timeoutMs);
 
     virtual ~RdmaConnectedSession();
     RdmaAddress GetLocalAddress() override;
     RdmaAddress GetRemoteAddress() override;
 
-    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize);
-    virtual void QueueToQp(Direction _direction, RdmaBuffer* buffer);
-    void PollForReceive(int32_t timeoutMs) override;
+    virtual std::unique_ptr<RdmaMemoryRegion> CreateMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access);
+    std::shared_ptr<RdmaMemoryRegion> AcquireExternalMemoryRegion(void* buffer, size_t bufferSize, MemoryAccess access, bool onDemand) override;
+    int GetNumaNode() override;
+    uint32_t GetOnDemandPagingCaps() override;
+    size_t GetReadDepth() override;
+    virtual void QueueToQp(Direction _direction, RdmaBuffer** buffers, size_t numBuffers);
+    virtual void QueueImmediateCredits(const uint64_t* bufferLengths, size_t numCredits);
+    virtual void QueueRingAnnouncement(RdmaMemoryRegion* ringRegion, void* ring, uint64_t ringSize);
+    bool PollForReceive(int32_t timeoutMs) override;
 
 protected:
     enum class BufferOwnership
@@ -51,7 +51,7 @@ std::shared_ptr<RdmaSession> RdmaListener::Accept(Direction direction, int32_t t
     std::shared_ptr<RdmaSession> acceptedSession;
     try {
         HandleHROverlappedWithTimeout(listen->GetConnectionRequest(connector, overlapped), connector, overlapped, timeoutMs);
-        acceptedSession = std::make_shared<RdmaConnectedSession>(direction, adapter, adapterFile, connector, connectionData, timeoutMs);
+        acceptedSession = std::make_shared<RdmaConnectedSession>(direction, adapter, adapterFile, connector, connectionData, inlineThreshold, timeoutMs);
         acceptInProgress = false;
         return acceptedSession;
     } catch (std::exception&) {
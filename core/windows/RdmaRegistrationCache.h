@@ -0,0 +1,33 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "RdmaError.h"
+#include "RdmaAddress.h"
+#include "RdmaSession.h"
+#include "api/easyrdma.h"
+
+// Sharing registrations between sessions is only implemented on Linux. Each session here opens its own adapter,
+// and memory registered with one adapter can't be used with another, so there is nothing for sessions to share.
+class RdmaRegistrationCache
+{
+public:
+    void Register(const RdmaAddress& localAddress, void* buffer, size_t length, MemoryAccess access, bool onDemand)
+    {
+        RDMA_THROW(easyrdma_Error_OperationNotSupported);
+    }
+    void Unregister(void* buffer)
+    {
+        RDMA_THROW(easyrdma_Error_OperationNotSupported);
+    }
+    size_t GetRegistrationCount()
+    {
+        return 0;
+    }
+};
+
+inline RdmaRegistrationCache& GetRegistrationCache()
+{
+    static RdmaRegistrationCache registrationCache;
+    return registrationCache;
+}
@@ -180,6 +180,15 @@ public:
         return std::move(bufferRegion);
     }
 
+    std::vector<BufferRegion> GetReceivedRegions(size_t minRegions, size_t maxRegions, int32_t timeoutMs = 5000)
+    {
+        std::vector<BufferRegion> bufferRegions(maxRegions);
+        size_t numRegions = 0;
+        RDMA_THROW_IF_FATAL(easyrdma_AcquireReceivedRegions(session, timeoutMs, bufferRegions.data(), minRegions, maxRegions, &numRegions));
+        bufferRegions.resize(numRegions);
+        return bufferRegions;
+    }
+
     void QueueRegionWithCallback(BufferRegion& bufferRegion, BufferCompletion* completionCallback, void* context = nullptr)
     {
         ASSERT_TRUE(!completionCallback || !completionCallback->IsCompleted());
@@ -198,11 +207,39 @@ public:
         QueueRegionWithCallback(bufferRegion, nullptr, nullptr);
     }
 
+    void QueueRegionsWithCallbacks(std::vector<BufferRegion>& bufferRegions, std::vector<BufferCompletion>* completionCallbacks)
+    {
+        std::vector<easyrdma_BufferCompletionCallbackData> callbackData;
+        if (completionCallbacks) {
+            ASSERT_EQ(bufferRegions.size(), completionCallbacks->size());
+            auto CallbackFunc = [](void* _context1, void* _context2, int32_t _status, size_t _completedBytes) {
+                BufferCompletion::Signal(_status, _completedBytes, _context1, _context2);
+            };
+            callbackData.resize(bufferRegions.size());
+            for (size_t i = 0; i < bufferRegions.size(); ++i) {
+                callbackData[i].callbackFunction = CallbackFunc;
+                callbackData[i].context1 = &(*completionCallbacks)[i];
+                callbackData[i].context2 = nullptr;
+            }
+        }
+        RDMA_THROW_IF_FATAL(easyrdma_QueueBufferRegions(session, bufferRegions.data(), bufferRegions.size(), completionCallbacks ? callbackData.data() : nullptr));
+    }
+
+    void QueueRegions(std::vector<BufferRegion>& bufferRegions)
+    {
+        QueueRegionsWithCallbacks(bufferRegions, nullptr);
+    }
+
     void ReleaseReceivedRegion(BufferRegion& bufferRegion)
     {
         RDMA_THROW_IF_FATAL(easyrdma_ReleaseReceivedBufferRegion(session, &bufferRegion));
     }
 
+    void ReleaseReceivedRegions(std::vector<BufferRegion>& bufferRegions)
+    {
+        RDMA_THROW_IF_FATAL(easyrdma_ReleaseReceivedBufferRegions(session, bufferRegions.data(), bufferRegions.size()));
+    }
+
     static void ReleaseUserRegionToIdle(easyrdma_Session sessionHandle, BufferRegion& bufferRegion)
     {
         RDMA_THROW_IF_FATAL(easyrdma_ReleaseUserBufferRegionToIdle(sessionHandle, &bufferRegion));
@@ -303,6 +340,11 @@ public:
         SetPropertyOnSession(session, propertyId, value);
     }
 
+    void SetPropertyU64(uint32_t propertyId, uint64_t value)
+    {
+        SetPropertyOnSession(session, propertyId, value);
+    }
+
     std::string GetLocalAddress()
     {
         easyrdma_AddressString address = {};
@@ -7,6 +7,12 @@
 #include <memory>
 #include <future>
 #include <regex>
+#include <array>
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 #include "core/common/RdmaAddress.h"
 #include "core/common/RdmaConnectionData.h"
 #include "utility/RdmaTestBase.h"
@@ -710,6 +716,208 @@ TEST_P(RdmaTest, ExternalMemorySend)
     RDMA_ASSERT_NO_THROW(connections.Close()); // Explicitly close the sessions before destroying the external buffer
 }
 
+TEST_P(RdmaTest, RegisterMemory_ReusedAcrossSessions)
+{
+    const size_t eachBufferLen = 64 * 1024;
+    const size_t bufferCount = 4;
+    std::vector<uint8_t> sendBuffer(bufferCount * eachBufferLen);
+    for (auto& b : sendBuffer) {
+        b = static_cast<uint8_t>(rand());
+    }
+    auto getRegistrations = []() {
+        return Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_NumMemoryRegistrations);
+    };
+    std::string localAddress = GetEndpointAddresses().second.GetAddrString();
+#ifdef __linux__
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_RegisterMemory(localAddress.c_str(), sendBuffer.data(), sendBuffer.size())));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+
+    // Each session reuses the registration, even for just part of the buffer
+    for (size_t i = 0; i < 3; ++i) {
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data() + eachBufferLen, eachBufferLen * (bufferCount - 1), bufferCount - 1));
+        RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(eachBufferLen, bufferCount));
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+        RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBuffer(sendBuffer.data() + eachBufferLen, eachBufferLen));
+        std::vector<uint8_t> receiveBuffer;
+        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+        ASSERT_EQ(receiveBuffer.size(), eachBufferLen);
+        EXPECT_EQ(memcmp(receiveBuffer.data(), sendBuffer.data() + eachBufferLen, eachBufferLen), 0);
+
+        // Unregistering while a session still uses the memory leaves it registered until that session closes
+        if (i == 2) {
+            RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_UnregisterMemory(sendBuffer.data())));
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+        }
+        RDMA_ASSERT_NO_THROW(connections.Close());
+    }
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(0U, getRegistrations()));
+    RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_UnregisterMemory(sendBuffer.data())), easyrdma_Error_InvalidArgument);
+#else
+    RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_RegisterMemory(localAddress.c_str(), sendBuffer.data(), sendBuffer.size())), easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+TEST_P(RdmaTest, OnDemandPaging_ExternalMemorySend)
+{
+    const size_t bufferLen = 256 * 1024;
+    std::vector<uint8_t> sendBuffer(bufferLen);
+    for (auto& b : sendBuffer) {
+        b = static_cast<uint8_t>(rand());
+    }
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    uint32_t caps = 0;
+    RDMA_ASSERT_NO_THROW(caps = Session::GetPropertyOnSession<uint32_t>(connections.sender.GetSessionHandle(), easyrdma_Property_OnDemandPagingCaps));
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyBool(easyrdma_Property_UseOnDemandPaging, true));
+    RDMA_ASSERT_NO_THROW(ASSERT_TRUE(connections.sender.GetPropertyBool(easyrdma_Property_UseOnDemandPaging)));
+    if (!(caps & easyrdma_OnDemandPagingCaps_Supported)) {
+        RDMA_ASSERT_THROW_WITHCODE(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), 1), easyrdma_Error_OperationNotSupported);
+        return;
+    }
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), 1));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferLen, 1));
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.SetPropertyBool(easyrdma_Property_UseOnDemandPaging, false), easyrdma_Error_AlreadyConfigured);
+    RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBuffer(sendBuffer.data(), sendBuffer.size()));
+    std::vector<uint8_t> receiveBuffer;
+    RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+    EXPECT_EQ(sendBuffer, receiveBuffer);
+}
+
+TEST_P(RdmaTest, OnDemandPaging_ImplicitRegistration)
+{
+    const size_t bufferLen = 64 * 1024;
+    std::vector<uint8_t> sendBuffer(bufferLen);
+    for (auto& b : sendBuffer) {
+        b = static_cast<uint8_t>(rand());
+    }
+    auto getRegistrations = []() {
+        return Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_NumMemoryRegistrations);
+    };
+    std::string localAddress = GetEndpointAddresses().second.GetAddrString();
+    uint32_t caps = 0;
+    {
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(caps = Session::GetPropertyOnSession<uint32_t>(connections.sender.GetSessionHandle(), easyrdma_Property_OnDemandPagingCaps));
+    }
+    if (!(caps & easyrdma_OnDemandPagingCaps_Implicit)) {
+        RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_RegisterMemory(localAddress.c_str(), nullptr, SIZE_MAX, easyrdma_RegisterFlags_OnDemand)), easyrdma_Error_OperationNotSupported);
+        return;
+    }
+    // Only the whole address space can be registered without a buffer
+    RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_RegisterMemory(localAddress.c_str(), nullptr, bufferLen, easyrdma_RegisterFlags_OnDemand)), easyrdma_Error_InvalidArgument);
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_RegisterMemory(localAddress.c_str(), nullptr, SIZE_MAX, easyrdma_RegisterFlags_OnDemand)));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+    {
+        // Any memory can be sent from without registering it again, whether or not the session asked for on-demand paging
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), 1));
+        RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferLen, 1));
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+        RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBuffer(sendBuffer.data(), sendBuffer.size()));
+        std::vector<uint8_t> receiveBuffer;
+        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+        EXPECT_EQ(sendBuffer, receiveBuffer);
+    }
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_UnregisterMemory(nullptr)));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(0U, getRegistrations()));
+}
+
+TEST_P(RdmaTest, BufferPool_SharedAcrossSessions)
+{
+    const size_t kBufferSize = 4096;
+    const size_t kNumBuffers = 8;
+    // The receivers are accepted from the listener, so the pool goes on its device
+    std::string localAddress = GetEndpointAddresses().first.GetAddrString();
+    easyrdma_BufferPool pool = nullptr;
+#ifdef __linux__
+    auto getRegistrations = []() {
+        return Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_NumMemoryRegistrations);
+    };
+    auto sendAndReceive = [&](ConnectionPair& connections) {
+        for (size_t i = 0; i < kNumBuffers * 2; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(kBufferSize, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kBufferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+        }
+    };
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_CreateBufferPool(localAddress.c_str(), kBufferSize, kNumBuffers, 0, &pool)));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+    {
+        ConnectionPair first, second;
+        RDMA_ASSERT_NO_THROW(first = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(second = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(first.receiver.GetSessionHandle(), easyrdma_Property_BufferPool, pool));
+        RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(second.receiver.GetSessionHandle(), easyrdma_Property_BufferPool, pool));
+        RDMA_ASSERT_THROW_WITHCODE(first.receiver.GetPropertyU64(easyrdma_Property_BufferPool), easyrdma_Error_WriteOnlyProperty);
+        RDMA_ASSERT_THROW_WITHCODE(first.receiver.ConfigureBuffers(kBufferSize + 1, kNumBuffers), easyrdma_Error_InvalidSize);
+        RDMA_ASSERT_NO_THROW(first.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+        RDMA_ASSERT_NO_THROW(first.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+
+        // The first session has every buffer, and the pool doesn't grow
+        RDMA_ASSERT_THROW_WITHCODE(second.receiver.ConfigureBuffers(kBufferSize, 1), easyrdma_Error_OutOfMemory);
+        sendAndReceive(first);
+        RDMA_ASSERT_NO_THROW(first.Close());
+        RDMA_ASSERT_NO_THROW(second.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+        RDMA_ASSERT_NO_THROW(second.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
+
+        // Destroying the pool leaves its memory with the session still using it
+        RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_DestroyBufferPool(pool)));
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getRegistrations()));
+        sendAndReceive(second);
+        RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession(second.sender.GetSessionHandle(), easyrdma_Property_BufferPool, pool), easyrdma_Error_InvalidArgument);
+        RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_DestroyBufferPool(pool)), easyrdma_Error_InvalidArgument);
+    }
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(0U, getRegistrations()));
+#else
+    RDMA_ASSERT_THROW_WITHCODE(RDMA_THROW_IF_FATAL(easyrdma_CreateBufferPool(localAddress.c_str(), kBufferSize, kNumBuffers, 0, &pool)), easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+TEST_P(RdmaTest, BufferPool_CreditBuffers)
+{
+#ifdef __linux__
+    auto endpoints = GetEndpointAddresses();
+    RdmaAddress localAddressListener = endpoints.first;
+    RdmaAddress localAddressConnector = endpoints.second;
+    // Enough for one sending session's credit buffers and no more
+    easyrdma_BufferPool creditPool = nullptr, smallPool = nullptr;
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_CreateBufferPool(localAddressConnector.GetAddrString().c_str(), 1024, 100, 0, &creditPool)));
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_CreateBufferPool(localAddressConnector.GetAddrString().c_str(), 64, 100, 0, &smallPool)));
+
+    Session sessionConnector, sessionListener, otherConnector;
+    RDMA_ASSERT_NO_THROW(sessionConnector = Session::CreateConnector(localAddressConnector.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(otherConnector = Session::CreateConnector(localAddressConnector.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(sessionListener = Session::CreateListener(localAddressListener.GetAddrString(), 0));
+    // Too small to hold a credit message
+    RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession(sessionConnector.GetSessionHandle(), easyrdma_Property_CreditBufferPool, smallPool), easyrdma_Error_InvalidSize);
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(sessionConnector.GetSessionHandle(), easyrdma_Property_CreditBufferPool, creditPool));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(otherConnector.GetSessionHandle(), easyrdma_Property_CreditBufferPool, creditPool));
+
+    std::future<Session> accept = std::async(std::launch::async, [&]() {
+        return sessionListener.Accept(easyrdma_Direction_Receive);
+    });
+    RDMA_ASSERT_NO_THROW(sessionConnector.Connect(easyrdma_Direction_Send, localAddressListener.GetAddrString(), sessionListener.GetLocalPort()));
+    Session sessionAccepted;
+    RDMA_ASSERT_NO_THROW(sessionAccepted = std::move(accept.get()));
+    RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession(sessionConnector.GetSessionHandle(), easyrdma_Property_CreditBufferPool, creditPool), easyrdma_Error_AlreadyConnected);
+    // Fails while posting its credit receives, before it ever reaches the listener
+    RDMA_ASSERT_THROW_WITHCODE(otherConnector.Connect(easyrdma_Direction_Send, localAddressListener.GetAddrString(), sessionListener.GetLocalPort()), easyrdma_Error_OutOfMemory);
+
+    RDMA_ASSERT_NO_THROW(sessionConnector.ConfigureBuffers(100, 10));
+    RDMA_ASSERT_NO_THROW(sessionAccepted.ConfigureBuffers(100, 10));
+    for (size_t i = 0; i < 100; ++i) {
+        RDMA_ASSERT_NO_THROW(sessionConnector.Send(std::vector<uint8_t>(100, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(100, static_cast<uint8_t>(i)), sessionAccepted.Receive())) << "Iteration: " << i;
+    }
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_DestroyBufferPool(creditPool)));
+    RDMA_ASSERT_NO_THROW(RDMA_THROW_IF_FATAL(easyrdma_DestroyBufferPool(smallPool)));
+#endif
+}
+
 TEST_P(RdmaTest, Send_Partial_ExternalMemory)
 {
     const size_t maxTransferSize = 100;
@@ -997,6 +1205,64 @@ TEST_P(RdmaTest, Receive_MultipleSimultaneous)
     RDMA_EXPECT_THROW_WITHCODE(receive.get(), easyrdma_Error_Timeout);
 }
 
+TEST_P(RdmaTest, Receive_ConcurrentWaits)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumConsumers = 4;
+    const size_t kNumTransfers = 1000;
+    RDMA_ASSERT_NO_THROW(ASSERT_FALSE(connections.receiver.GetPropertyBool(easyrdma_Property_AllowConcurrentWaits)));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_AllowConcurrentWaits, true));
+    RDMA_ASSERT_NO_THROW(ASSERT_TRUE(connections.receiver.GetPropertyBool(easyrdma_Property_AllowConcurrentWaits)));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(sizeof(uint32_t), 16));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(sizeof(uint32_t), 16));
+
+    // Every consumer waits at once. Each transfer goes to exactly one of them, and its sequence number says
+    // where it was in the stream.
+    std::atomic<size_t> numReceived(0);
+    std::vector<std::future<std::vector<std::pair<uint64_t, uint32_t>>>> consumers;
+    for (size_t c = 0; c < kNumConsumers; ++c) {
+        consumers.push_back(std::async(std::launch::async, [&]() {
+            std::vector<std::pair<uint64_t, uint32_t>> received;
+            while (numReceived < kNumTransfers) {
+                BufferRegion region;
+                try {
+                    region = connections.receiver.GetReceivedRegion(100);
+                } catch (const RdmaException& e) {
+                    if (e.rdmaError.GetCode() == easyrdma_Error_Timeout) {
+                        continue;
+                    }
+                    throw;
+                }
+                uint32_t value;
+                memcpy(&value, region.buffer, sizeof(value));
+                received.emplace_back(region.sequenceNumber, value);
+                ++numReceived;
+                connections.receiver.ReleaseReceivedRegion(region);
+            }
+            return received;
+        }));
+    }
+    for (uint32_t i = 0; i < kNumTransfers; ++i) {
+        std::vector<uint8_t> data(sizeof(i));
+        memcpy(data.data(), &i, sizeof(i));
+        RDMA_ASSERT_NO_THROW(connections.sender.Send(data));
+    }
+
+    std::vector<bool> seen(kNumTransfers, false);
+    for (auto& consumer : consumers) {
+        std::vector<std::pair<uint64_t, uint32_t>> received;
+        RDMA_ASSERT_NO_THROW(received = consumer.get());
+        for (auto& entry : received) {
+            ASSERT_LT(entry.first, kNumTransfers);
+            EXPECT_FALSE(seen[entry.first]);
+            seen[entry.first] = true;
+            EXPECT_EQ(entry.first, entry.second);
+        }
+    }
+    EXPECT_EQ(kNumTransfers, numReceived.load());
+}
+
 TEST_P(RdmaTest, Send_Cancel_WithClose)
 {
     ConnectionPair connections;
@@ -1331,6 +1597,48 @@ TEST_P(RdmaTest, ConnectionData_NewerCompatibleVersion)
     RDMA_ASSERT_NO_THROW(accept.get());
 }
 
+TEST_P(RdmaTest, ConnectionData_OriginalProtocolTransfer)
+{
+    // Each side advertising the original protocol version in turn must fall back to sending credits as messages
+    for (bool listenerIsOriginal : {true, false}) {
+        auto endpoints = GetEndpointAddresses();
+        RdmaAddress localAddressListener = endpoints.first;
+        RdmaAddress localAddressConnector = endpoints.second;
+
+        Session sessionConnectorSender, sessionListener, sessionReceiver;
+        RDMA_ASSERT_NO_THROW(sessionConnectorSender = Session::CreateConnector(localAddressConnector.GetAddrString(), 0));
+        RDMA_ASSERT_NO_THROW(sessionListener = Session::CreateListener(localAddressListener.GetAddrString(), 0));
+        easyrdma_ConnectionData cd = {
+            kConnectionDataProtocol,
+            1,
+            1,
+            static_cast<uint8_t>(listenerIsOriginal ? easyrdma_Direction_Receive : easyrdma_Direction_Send)};
+        if (listenerIsOriginal) {
+            sessionListener.SetProperty(easyrdma_Property_ConnectionData, &cd, sizeof(cd));
+        } else {
+            sessionConnectorSender.SetProperty(easyrdma_Property_ConnectionData, &cd, sizeof(cd));
+        }
+        auto accept = std::async(std::launch::async, [&]() { return sessionListener.Accept(easyrdma_Direction_Receive); });
+        RDMA_ASSERT_NO_THROW(sessionConnectorSender.Connect(easyrdma_Direction_Send, localAddressListener.GetAddrString(), sessionListener.GetLocalPort()));
+        RDMA_ASSERT_NO_THROW(sessionReceiver = accept.get());
+
+        const size_t kNumBuffers = 10;
+        const size_t kBufferSize = 64;
+        RDMA_ASSERT_NO_THROW(sessionReceiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+        RDMA_ASSERT_NO_THROW(sessionConnectorSender.ConfigureBuffers(kBufferSize, kNumBuffers));
+        const size_t kIterations = kNumBuffers * 10;
+        auto receiver = std::async(std::launch::async, [&]() {
+            for (size_t i = 0; i < kIterations; ++i) {
+                RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kBufferSize, static_cast<uint8_t>(i)), sessionReceiver.Receive())) << "Iteration: " << i;
+            }
+        });
+        for (size_t i = 0; i < kIterations; ++i) {
+            RDMA_ASSERT_NO_THROW(sessionConnectorSender.Send(std::vector<uint8_t>(kBufferSize, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+        }
+        RDMA_ASSERT_NO_THROW(receiver.get());
+    }
+}
+
 TEST_P(RdmaTest, ConnectionData_NewerIncompatibleVersion)
 {
     auto endpoints = GetEndpointAddresses();
@@ -1478,6 +1786,61 @@ TEST_P(RdmaTest, SendReceive_Continuous)
     });
 }
 
+TEST_P(RdmaTest, SendReceive_BurstWithCallbacks)
+{
+    // Completion objects must live longer than the connections
+    const size_t kNumBuffers = 64;
+    std::vector<BufferCompletion> sendCompletions(kNumBuffers);
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kEachTransferSize = 16;
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+
+    // Queue a burst of small sends back-to-back so that many completions are pending at once
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.SendWithCallback(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), &sendCompletions[i]));
+    }
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+    }
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(sendCompletions[i].WaitForCompletion(5000)) << "Iteration: " << i;
+        EXPECT_EQ(kEachTransferSize, sendCompletions[i].GetCompletedBytes());
+    }
+}
+
+TEST_P(RdmaTest, CallbackExecutor_BurstWithCallbacks)
+{
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorThreads, 2));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(2U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorThreads)));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorAffinity, 1));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorAffinity)));
+    {
+        // Completion objects must live longer than the connections
+        const size_t kNumBuffers = 64;
+        std::vector<BufferCompletion> sendCompletions(kNumBuffers);
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        const size_t kEachTransferSize = 16;
+        RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+        RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.SendWithCallback(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), &sendCompletions[i]));
+        }
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+        }
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            RDMA_ASSERT_NO_THROW(sendCompletions[i].WaitForCompletion(5000)) << "Iteration: " << i;
+            EXPECT_EQ(kEachTransferSize, sendCompletions[i].GetCompletedBytes());
+        }
+    }
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorAffinity, 0));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CallbackExecutorThreads, 0));
+}
+
 TEST_P(RdmaTest, TestBandwidth)
 {
     ConnectionPair connections;
@@ -1677,162 +2040,671 @@ TEST_P(RdmaTest, QueueBuffer_ReleaseReceivedBufferTwice)
     RDMA_ASSERT_THROW_WITHCODE(connections.receiver.ReleaseReceivedRegion(region), easyrdma_Error_InvalidOperation);
 }
 
-TEST_P(RdmaTest, Scaling_Connections)
+TEST_P(RdmaTest, QueueBufferRegions_Send)
 {
-    // First make connections in parallel
-    const size_t kNumConnections = 100;
-    const size_t kBufferSize = 4096;
-    std::vector<ConnectionPair> connections;
-    std::vector<std::future<ConnectionPair>> connectionAttempts;
-    for (size_t i = 0; i < kNumConnections; ++i) {
-        connectionAttempts.push_back(std::async(std::launch::async, [&]() {
-            return std::move(GetLoopbackConnection());
-        }));
-    }
-    for (size_t i = 0; i < kNumConnections; ++i) {
-        RDMA_ASSERT_NO_THROW(connections.push_back(std::move(connectionAttempts[i].get())));
-    }
+    // Completion objects must live longer than the connections
+    const size_t kNumRegions = 5;
+    std::vector<BufferCompletion> sendCompletions(kNumRegions);
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t bufferSize = 1;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, kNumRegions));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, kNumRegions));
 
-    // Configure in parallel
-    std::vector<std::future<void>> configureFutures;
-    for (auto& connection : connections) {
-        configureFutures.push_back(std::async(std::launch::async, [&]() {
-            connection.sender.ConfigureBuffers(kBufferSize, 10);
-            connection.receiver.ConfigureBuffers(kBufferSize, 10);
-        }));
-    }
-    for (auto& configure : configureFutures) {
-        RDMA_ASSERT_NO_THROW(configure.get());
+    std::vector<BufferRegion> regions(kNumRegions);
+    for (size_t i = 0; i < kNumRegions; ++i) {
+        RDMA_ASSERT_NO_THROW(regions[i] = connections.sender.GetSendRegion());
+        regions[i].CopyFromVector({static_cast<uint8_t>(i)});
     }
+    RDMA_ASSERT_NO_THROW(connections.sender.QueueRegionsWithCallbacks(regions, &sendCompletions));
 
-    // Send/recv
-    std::vector<std::future<void>> transferFutures;
-    for (auto& connection : connections) {
-        transferFutures.push_back(std::async(std::launch::async, [&]() {
-            std::vector<uint8_t> receiveBuffer;
-            for (size_t i = 0; i < 100; ++i) {
-                std::vector<uint8_t> sendBuffer(kBufferSize);
-                for (size_t j = 0; j < kBufferSize; ++j) {
-                    sendBuffer[j] = static_cast<uint8_t>(i + j);
-                }
-                connection.sender.Send(sendBuffer);
-                receiveBuffer = connection.receiver.Receive();
-                ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
-                EXPECT_EQ(sendBuffer, receiveBuffer);
-            }
-        }));
+    // Data should match the order of the batch
+    for (size_t i = 0; i < kNumRegions; ++i) {
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({static_cast<uint8_t>(i)}), connections.receiver.Receive()));
     }
-    for (auto& transfer : transferFutures) {
-        RDMA_ASSERT_NO_THROW(transfer.get());
+    for (auto& completion : sendCompletions) {
+        RDMA_ASSERT_NO_THROW(completion.WaitForCompletion(5000));
+        EXPECT_EQ(bufferSize, completion.GetCompletedBytes());
     }
 }
 
-TEST_P(RdmaTest, Scaling_Buffers_LessThanCreditCount)
+TEST_P(RdmaTest, QueueBufferRegions_ReleaseReceived)
 {
     ConnectionPair connections;
     RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
-    const size_t kBufferSize = 4096;
-    const size_t kNumBuffers = 100; // Currently the dll uses 100 buffers for issuing credits
-
-    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
-    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+    const size_t bufferSize = 1;
+    const size_t kNumRegions = 3;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, kNumRegions));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, kNumRegions));
 
-    std::vector<uint8_t> sendBuffer(kBufferSize);
-    for (size_t i = 0; i < kBufferSize; ++i) {
-        sendBuffer[i] = static_cast<uint8_t>(i);
+    uint8_t sendSequence = 0;
+    uint8_t recvSequence = 0;
+    for (size_t i = 0; i < kNumRegions; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send({sendSequence++}));
     }
-    std::vector<uint8_t> receiveBuffer;
 
-    for (size_t i = 0; i < kNumBuffers; ++i) {
-        RDMA_ASSERT_NO_THROW(connections.sender.Send(sendBuffer));
+    // Hold every receive buffer, then hand them all back with a single call
+    std::vector<BufferRegion> regions(kNumRegions);
+    for (auto& region : regions) {
+        RDMA_ASSERT_NO_THROW(region = connections.receiver.GetReceivedRegion());
+        EXPECT_EQ(region.ToVector(), std::vector<uint8_t>({recvSequence++}));
     }
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(kNumRegions, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
+    RDMA_ASSERT_NO_THROW(connections.receiver.QueueRegions(regions));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
 
-    for (size_t i = 0; i < kNumBuffers; ++i) {
-        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
-        ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
-        EXPECT_EQ(sendBuffer, receiveBuffer);
+    // Credits for all of the requeued buffers should have made it back to the sender
+    for (size_t i = 0; i < kNumRegions; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send({sendSequence++}));
+    }
+    for (size_t i = 0; i < kNumRegions; ++i) {
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({recvSequence++}), connections.receiver.Receive()));
     }
 }
 
-TEST_P(RdmaTest, Scaling_Buffers_MoreThanCreditCount)
+TEST_P(RdmaTest, QueueBufferRegions_InvalidRegionInBatch)
 {
-    // This test occasionally takes a long time to run (see #1622458)
     ConnectionPair connections;
     RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
-    const size_t kBufferSize = 4096;
-    const size_t kNumBuffers = 1024;
+    const size_t bufferSize = 1;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, 5));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, 5));
 
-    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
-    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+    std::vector<BufferRegion> regions(2);
+    RDMA_ASSERT_NO_THROW(regions[0] = connections.sender.GetSendRegion());
+    RDMA_ASSERT_NO_THROW(regions[1] = connections.sender.GetSendRegion());
+    regions[0].CopyFromVector({0});
+    regions[1].CopyFromVector({1});
+    RDMA_ASSERT_NO_THROW(connections.sender.QueueRegion(regions[1]));
 
-    std::vector<uint8_t> sendBuffer(kBufferSize);
-    for (size_t i = 0; i < kBufferSize; ++i) {
-        sendBuffer[i] = static_cast<uint8_t>(i);
-    }
-    std::vector<uint8_t> receiveBuffer;
+    // Second region in the batch was already queued, so nothing in the batch should be queued
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.QueueRegions(regions), easyrdma_Error_InvalidOperation);
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(1U, connections.sender.GetPropertyU64(easyrdma_Property_UserBuffers)));
 
-    for (size_t i = 0; i < kNumBuffers; ++i) {
-        RDMA_ASSERT_NO_THROW(connections.sender.Send(sendBuffer));
-    }
+    RDMA_ASSERT_NO_THROW(connections.sender.QueueRegion(regions[0]));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({1}), connections.receiver.Receive()));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({0}), connections.receiver.Receive()));
+}
 
-    for (size_t i = 0; i < kNumBuffers; ++i) {
-        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
-        ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
-        EXPECT_EQ(sendBuffer, receiveBuffer);
-    }
+TEST_P(RdmaTest, QueueBufferRegions_RegionFromOtherSession)
+{
+    ConnectionPair first, second;
+    RDMA_ASSERT_NO_THROW(first = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(second = GetLoopbackConnection());
+    const size_t bufferSize = 4;
+    RDMA_ASSERT_NO_THROW(first.sender.ConfigureBuffers(bufferSize, 5));
+    RDMA_ASSERT_NO_THROW(first.receiver.ConfigureBuffers(bufferSize, 5));
+    RDMA_ASSERT_NO_THROW(second.sender.ConfigureBuffers(bufferSize, 5));
+    RDMA_ASSERT_NO_THROW(second.receiver.ConfigureBuffers(bufferSize, 5));
+
+    std::vector<BufferRegion> regions(2);
+    RDMA_ASSERT_NO_THROW(regions[0] = first.sender.GetSendRegion());
+    RDMA_ASSERT_NO_THROW(regions[1] = second.sender.GetSendRegion());
+    regions[0].CopyFromVector({0, 1});
+    regions[1].CopyFromVector({2, 3, 4});
+
+    // A batch may only hold regions of the session it is queued on, and a rejected batch changes nothing
+    RDMA_ASSERT_THROW_WITHCODE(first.sender.QueueRegions(regions), easyrdma_Error_InvalidArgument);
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(1U, first.sender.GetPropertyU64(easyrdma_Property_UserBuffers)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(1U, second.sender.GetPropertyU64(easyrdma_Property_UserBuffers)));
+
+    RDMA_ASSERT_NO_THROW(first.sender.QueueRegion(regions[0]));
+    RDMA_ASSERT_NO_THROW(second.sender.QueueRegion(regions[1]));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({0, 1}), first.receiver.Receive()));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>({2, 3, 4}), second.receiver.Receive()));
 }
 
-TEST_P(RdmaTest, SendCallbacks_CancellationFromWaitingForCredits)
+TEST_P(RdmaTest, AcquireReceivedRegions_Burst)
 {
-    const int rxOverlappedCount = 25;
-    const int transferCount = 50;
-    const size_t eachBufferLen = 4096;
-    std::vector<uint8_t> sendBuffer(eachBufferLen);
     ConnectionPair connections;
     RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t bufferSize = 1;
+    const size_t kNumRegions = 64;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, kNumRegions));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, kNumRegions));
 
-    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), transferCount));
-    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(eachBufferLen, rxOverlappedCount));
-
-    BufferCompletion completedTransfers[transferCount];
-    auto sender = std::async(std::launch::async, [&]() {
-        for (int i = 0; i < transferCount; ++i) {
-            RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data(), sendBuffer.size(), &completedTransfers[i], nullptr, 100));
+    uint8_t sendSequence = 0;
+    uint8_t recvSequence = 0;
+    for (size_t round = 0; round < 2; ++round) {
+        for (size_t i = 0; i < kNumRegions; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send({sendSequence++}));
         }
-    });
-    RDMA_ASSERT_NO_THROW(sender.get());
-
-    // Now 50 should be queued, but only 25 sent
-    for (int i = 0; i < rxOverlappedCount; ++i) {
-        RDMA_ASSERT_NO_THROW(completedTransfers[i].WaitForCompletion(100));
-    }
-    // 25th should be queued waiting for a free buffer and not complete
-    EXPECT_THROW(completedTransfers[rxOverlappedCount].WaitForCompletion(50), std::runtime_error);
 
-    RDMA_EXPECT_NO_THROW(connections.Close());
-
-    // Now all the buffers should have completed with a cancelled state
-    for (int i = rxOverlappedCount; i < transferCount; ++i) {
-        RDMA_ASSERT_THROW_WITHCODE(completedTransfers[i].WaitForCompletion(0), easyrdma_Error_OperationCancelled);
+        // The whole burst comes back from a single call, in order, and goes back with another
+        std::vector<BufferRegion> regions;
+        RDMA_ASSERT_NO_THROW(regions = connections.receiver.GetReceivedRegions(kNumRegions, kNumRegions));
+        ASSERT_EQ(kNumRegions, regions.size());
+        for (auto& region : regions) {
+            EXPECT_EQ(region.ToVector(), std::vector<uint8_t>({recvSequence++}));
+        }
+        RDMA_ASSERT_NO_THROW(ASSERT_EQ(kNumRegions, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
+        RDMA_ASSERT_NO_THROW(connections.receiver.ReleaseReceivedRegions(regions));
+        RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
     }
 }
 
-TEST_P(RdmaTest, SendCallbacks_CancellationFromQueued)
+TEST_P(RdmaTest, AcquireReceivedRegions_FewerThanMinimum)
 {
-    const int rxOverlappedCount = 500;
-    const int transferCount = 500;
-    const size_t eachBufferLen = 1024 * 1024;
-    std::vector<uint8_t> sendBuffer(eachBufferLen);
     ConnectionPair connections;
     RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t bufferSize = 1;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, 5));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, 5));
 
-    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), transferCount));
-    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(eachBufferLen, rxOverlappedCount));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.GetReceivedRegions(0, 4), easyrdma_Error_InvalidArgument);
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.GetReceivedRegions(3, 2), easyrdma_Error_InvalidArgument);
 
-    BufferCompletion completedTransfers[transferCount];
-    auto sender = std::async(std::launch::async, [&]() {
-        for (int i = 0; i < transferCount; ++i) {
-            RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data(), sendBuffer.size(), &completedTransfers[i], nullptr, 100));
+    // Whatever has completed by the timeout is returned, even if it is short of the minimum
+    RDMA_ASSERT_NO_THROW(connections.sender.Send({1}));
+    std::vector<BufferRegion> regions;
+    RDMA_ASSERT_NO_THROW(regions = connections.receiver.GetReceivedRegions(2, 4, 100));
+    ASSERT_EQ(1U, regions.size());
+    EXPECT_EQ(regions[0].ToVector(), std::vector<uint8_t>({1}));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ReleaseReceivedRegions(regions));
+
+    // Only having nothing at all is a timeout
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.GetReceivedRegions(1, 4, 100), easyrdma_Error_Timeout);
+}
+
+TEST_P(RdmaTest, AcquireReceivedRegion_ZeroTimeout_ReturnsTimeout)
+{
+    // Expected outcomes like this come back as the return value, with the same code left as the last error
+    std::vector<bool> pollingModes = {false};
+#ifdef __linux__
+    pollingModes.push_back(true);
+#endif
+    for (bool usePolling : pollingModes) {
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        if (usePolling) {
+            RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UseRxPolling, true));
+        }
+        RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1, 4));
+        RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1, 4));
+
+        // Polling an empty session returns straight away, as often as it is asked
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < 1000; ++i) {
+            BufferRegion region;
+            ASSERT_EQ(easyrdma_Error_Timeout, easyrdma_AcquireReceivedRegion(connections.receiver.GetSessionHandle(), 0, &region)) << "Polling: " << usePolling;
+            BufferRegion regions[4];
+            size_t numRegions = 1;
+            ASSERT_EQ(easyrdma_Error_Timeout, easyrdma_AcquireReceivedRegions(connections.receiver.GetSessionHandle(), 0, regions, 1, 4, &numRegions)) << "Polling: " << usePolling;
+            ASSERT_EQ(0U, numRegions);
+        }
+        EXPECT_LE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+        easyrdma_ErrorInfo lastError = {};
+        EXPECT_EQ(0, easyrdma_GetLastError(&lastError));
+        EXPECT_EQ(easyrdma_Error_Timeout, lastError.errorCode);
+
+        // And still hands over data once there is some
+        RDMA_ASSERT_NO_THROW(connections.sender.Send({1}));
+        std::vector<uint8_t> received;
+        RDMA_ASSERT_NO_THROW(received = connections.receiver.Receive());
+        EXPECT_EQ(received, std::vector<uint8_t>({1}));
+    }
+}
+
+TEST_P(RdmaTest, AcquireReceivedRegions_Partial_ReturnsTakenRegions)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1, 4));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1, 4));
+
+    RDMA_ASSERT_NO_THROW(connections.sender.Send({1}));
+    RDMA_ASSERT_NO_THROW(connections.sender.Send({2}));
+
+    // Falling short of the minimum by the timeout isn't an error as long as something was taken
+    std::vector<BufferRegion> regions(4);
+    size_t numRegions = 0;
+    ASSERT_EQ(0, easyrdma_AcquireReceivedRegions(connections.receiver.GetSessionHandle(), 100, regions.data(), 4, 4, &numRegions));
+    ASSERT_EQ(2U, numRegions);
+    regions.resize(numRegions);
+    EXPECT_EQ(regions[0].ToVector(), std::vector<uint8_t>({1}));
+    EXPECT_EQ(regions[1].ToVector(), std::vector<uint8_t>({2}));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(2U, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ReleaseReceivedRegions(regions));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
+}
+
+TEST_P(RdmaTest, AcquireReceivedRegion_NoBuffersQueued_ReturnsCode)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1, 1));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1, 1));
+
+    // Holding on to the only buffer leaves nothing queued that could complete
+    RDMA_ASSERT_NO_THROW(connections.sender.Send({1}));
+    BufferRegion held;
+    RDMA_ASSERT_NO_THROW(held = connections.receiver.GetReceivedRegion());
+    BufferRegion region;
+    EXPECT_EQ(easyrdma_Error_NoBuffersQueued, easyrdma_AcquireReceivedRegion(connections.receiver.GetSessionHandle(), 100, &region));
+    BufferRegion regions[1];
+    size_t numRegions = 1;
+    EXPECT_EQ(easyrdma_Error_NoBuffersQueued, easyrdma_AcquireReceivedRegions(connections.receiver.GetSessionHandle(), 100, regions, 1, 1, &numRegions));
+    EXPECT_EQ(0U, numRegions);
+    RDMA_ASSERT_NO_THROW(connections.receiver.ReleaseReceivedRegion(held));
+}
+
+TEST_P(RdmaTest, AcquireRegion_Cancelled_ReturnsCode)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1, 1));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1, 1));
+
+    // Use up the sender's only buffer so both sides have something to wait for
+    BufferRegion sendRegion;
+    RDMA_ASSERT_NO_THROW(sendRegion = connections.sender.GetSendRegion());
+    auto receive = std::async(std::launch::async, [&]() {
+        BufferRegion region;
+        return easyrdma_AcquireReceivedRegion(connections.receiver.GetSessionHandle(), 5000, &region);
+    });
+    auto send = std::async(std::launch::async, [&]() {
+        BufferRegion region;
+        return easyrdma_AcquireSendRegion(connections.sender.GetSessionHandle(), 5000, &region);
+    });
+    // Give time for both waits to start
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    RDMA_ASSERT_NO_THROW(connections.receiver.Abort());
+    RDMA_ASSERT_NO_THROW(connections.sender.Abort());
+    EXPECT_EQ(easyrdma_Error_OperationCancelled, receive.get());
+    EXPECT_EQ(easyrdma_Error_OperationCancelled, send.get());
+}
+
+TEST_P(RdmaTest, ReleaseReceivedRegion_ConcurrentThreads)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t bufferSize = 1;
+    const size_t kNumThreads = 4;
+    const size_t kRegionsPerThread = 16;
+    const size_t kNumRegions = kNumThreads * kRegionsPerThread;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, kNumRegions));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, kNumRegions));
+
+    uint8_t sendSequence = 0;
+    uint8_t recvSequence = 0;
+    for (size_t round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < kNumRegions; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send({sendSequence++}));
+        }
+        std::vector<BufferRegion> regions;
+        RDMA_ASSERT_NO_THROW(regions = connections.receiver.GetReceivedRegions(kNumRegions, kNumRegions));
+        ASSERT_EQ(kNumRegions, regions.size());
+        for (auto& region : regions) {
+            EXPECT_EQ(region.ToVector(), std::vector<uint8_t>({recvSequence++}));
+        }
+
+        // Releases from several threads at once all make it back to the sender as credits
+        std::vector<std::future<void>> releasers;
+        for (size_t t = 0; t < kNumThreads; ++t) {
+            releasers.push_back(std::async(std::launch::async, [&, t]() {
+                for (size_t i = 0; i < kRegionsPerThread; ++i) {
+                    connections.receiver.ReleaseReceivedRegion(regions[t * kRegionsPerThread + i]);
+                }
+            }));
+        }
+        for (auto& releaser : releasers) {
+            RDMA_ASSERT_NO_THROW(releaser.get());
+        }
+        RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_UserBuffers)));
+    }
+}
+
+TEST_P(RdmaTest, QueueSendRegions_ConcurrentThreads)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumThreads = 4;
+    const size_t kRegionsPerThread = 16;
+    const size_t kNumRegions = kNumThreads * kRegionsPerThread;
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(2, kNumRegions));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(2, kNumRegions));
+    // Unsignaled sends are only retired by a later signaled one, so they must reach the QP in queued order
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, 4));
+
+    for (size_t round = 0; round < 3; ++round) {
+        std::vector<BufferRegion> sendRegions(kNumRegions);
+        for (size_t t = 0; t < kNumThreads; ++t) {
+            for (size_t i = 0; i < kRegionsPerThread; ++i) {
+                auto& region = sendRegions[t * kRegionsPerThread + i];
+                RDMA_ASSERT_NO_THROW(region = connections.sender.GetSendRegion());
+                RDMA_ASSERT_NO_THROW(region.CopyFromVector({static_cast<uint8_t>(t), static_cast<uint8_t>(i)}));
+            }
+        }
+        std::vector<std::future<void>> senders;
+        for (size_t t = 0; t < kNumThreads; ++t) {
+            senders.push_back(std::async(std::launch::async, [&, t]() {
+                for (size_t i = 0; i < kRegionsPerThread; ++i) {
+                    connections.sender.QueueRegion(sendRegions[t * kRegionsPerThread + i]);
+                }
+            }));
+        }
+        for (auto& sender : senders) {
+            RDMA_ASSERT_NO_THROW(sender.get());
+        }
+
+        // Threads interleave with each other, but each thread's own sends arrive in the order it queued them
+        std::vector<uint8_t> nextSequence(kNumThreads, 0);
+        for (size_t i = 0; i < kNumRegions; ++i) {
+            std::vector<uint8_t> received;
+            RDMA_ASSERT_NO_THROW(received = connections.receiver.Receive());
+            ASSERT_EQ(2U, received.size());
+            ASSERT_LT(received[0], kNumThreads);
+            EXPECT_EQ(nextSequence[received[0]]++, received[1]);
+        }
+        for (size_t t = 0; t < kNumThreads; ++t) {
+            EXPECT_EQ(kRegionsPerThread, nextSequence[t]);
+        }
+        // Every send was retired, so all of the buffers are free again for the next round
+        RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.sender.GetPropertyU64(easyrdma_Property_UserBuffers)));
+    }
+}
+
+TEST_P(RdmaTest, Scaling_Connections)
+{
+    // First make connections in parallel
+    const size_t kNumConnections = 100;
+    const size_t kBufferSize = 4096;
+    std::vector<ConnectionPair> connections;
+    std::vector<std::future<ConnectionPair>> connectionAttempts;
+    for (size_t i = 0; i < kNumConnections; ++i) {
+        connectionAttempts.push_back(std::async(std::launch::async, [&]() {
+            return std::move(GetLoopbackConnection());
+        }));
+    }
+    for (size_t i = 0; i < kNumConnections; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.push_back(std::move(connectionAttempts[i].get())));
+    }
+
+    // Configure in parallel
+    std::vector<std::future<void>> configureFutures;
+    for (auto& connection : connections) {
+        configureFutures.push_back(std::async(std::launch::async, [&]() {
+            connection.sender.ConfigureBuffers(kBufferSize, 10);
+            connection.receiver.ConfigureBuffers(kBufferSize, 10);
+        }));
+    }
+    for (auto& configure : configureFutures) {
+        RDMA_ASSERT_NO_THROW(configure.get());
+    }
+
+    // Send/recv
+    std::vector<std::future<void>> transferFutures;
+    for (auto& connection : connections) {
+        transferFutures.push_back(std::async(std::launch::async, [&]() {
+            std::vector<uint8_t> receiveBuffer;
+            for (size_t i = 0; i < 100; ++i) {
+                std::vector<uint8_t> sendBuffer(kBufferSize);
+                for (size_t j = 0; j < kBufferSize; ++j) {
+                    sendBuffer[j] = static_cast<uint8_t>(i + j);
+                }
+                connection.sender.Send(sendBuffer);
+                receiveBuffer = connection.receiver.Receive();
+                ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
+                EXPECT_EQ(sendBuffer, receiveBuffer);
+            }
+        }));
+    }
+    for (auto& transfer : transferFutures) {
+        RDMA_ASSERT_NO_THROW(transfer.get());
+    }
+}
+
+TEST_P(RdmaTest, CompletionEngine_Properties)
+{
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads)));
+#ifdef __linux__
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 2));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(2U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads)));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 0));
+#else
+    RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 2), easyrdma_Error_OperationNotSupported);
+#endif
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads)));
+}
+
+#ifdef __linux__
+TEST_P(RdmaTest, CompletionEngine_ScalingConnections)
+{
+    const size_t kNumConnections = 50;
+    const size_t kBufferSize = 4096;
+    auto countThreads = []() {
+        size_t numThreads = 0;
+        DIR* tasks = opendir("/proc/self/task");
+        while (dirent* entry = readdir(tasks)) {
+            numThreads += entry->d_name[0] != '.';
+        }
+        closedir(tasks);
+        return numThreads;
+    };
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 2));
+
+    // The first pair starts the engine's threads, after which connections shouldn't add any of their own
+    std::vector<ConnectionPair> connections;
+    size_t threadsBefore = 0;
+    for (size_t i = 0; i < kNumConnections; ++i) {
+        ConnectionPair connection;
+        RDMA_ASSERT_NO_THROW(connection = GetLoopbackConnection());
+        RDMA_ASSERT_NO_THROW(connection.sender.ConfigureBuffers(kBufferSize, 10));
+        RDMA_ASSERT_NO_THROW(connection.receiver.ConfigureBuffers(kBufferSize, 10));
+        connections.push_back(std::move(connection));
+        if (i == 0) {
+            threadsBefore = countThreads();
+        }
+    }
+    EXPECT_LT(countThreads(), threadsBefore + 5);
+
+    for (size_t i = 0; i < 10; ++i) {
+        for (auto& connection : connections) {
+            std::vector<uint8_t> sendBuffer(kBufferSize, static_cast<uint8_t>(i));
+            RDMA_ASSERT_NO_THROW(connection.sender.Send(sendBuffer));
+        }
+        for (auto& connection : connections) {
+            std::vector<uint8_t> receiveBuffer;
+            RDMA_ASSERT_NO_THROW(receiveBuffer = connection.receiver.Receive());
+            EXPECT_EQ(std::vector<uint8_t>(kBufferSize, static_cast<uint8_t>(i)), receiveBuffer);
+        }
+    }
+
+    // Closing one side must still be noticed by the other
+    RDMA_ASSERT_NO_THROW(connections[0].sender.Close());
+    RDMA_ASSERT_THROW_WITHCODE(connections[0].receiver.Receive(1000), easyrdma_Error_Disconnected);
+    RDMA_ASSERT_NO_THROW(connections[0].receiver.Close());
+    for (size_t i = 1; i < connections.size(); ++i) {
+        RDMA_ASSERT_NO_THROW(connections[i].Close());
+    }
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 0));
+}
+
+TEST_P(RdmaTest, CompletionEngine_SharedWorkerCredits)
+{
+    // Both ends share one engine thread, so credits that find the send queue full must not wait on it
+    const size_t kNumBuffers = 1000;
+    const size_t kNumRounds = 5;
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 1));
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1, kNumBuffers));
+
+    for (size_t round = 0; round < kNumRounds; ++round) {
+        auto receive = std::async(std::launch::async, [&]() {
+            for (size_t i = 0; i < kNumBuffers; ++i) {
+                std::vector<uint8_t> receiveBuffer;
+                RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+                EXPECT_EQ(std::vector<uint8_t>(1, static_cast<uint8_t>(i)), receiveBuffer);
+            }
+        });
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(1, static_cast<uint8_t>(i))));
+        }
+        ASSERT_EQ(receive.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    }
+    RDMA_ASSERT_NO_THROW(connections.Close());
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_CompletionEngineThreads, 0));
+}
+#endif
+
+#ifdef __linux__
+TEST_P(RdmaTest, CompletionFd_Receive)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t bufferSize = 1;
+    const size_t kNumBuffers = 10;
+    int32_t fd = -1;
+    size_t fdSize = sizeof(fd);
+    RDMA_ASSERT_NO_THROW(connections.receiver.GetProperty(easyrdma_Property_CompletionFd, &fd, &fdSize));
+    ASSERT_GE(fd, 0);
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetProperty(easyrdma_Property_CompletionFd, &fd, sizeof(fd)), easyrdma_Error_ReadOnlyProperty);
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(bufferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(bufferSize, kNumBuffers));
+    auto isReadable = [&](int timeoutMs) {
+        pollfd pollFd = {fd, POLLIN, 0};
+        return poll(&pollFd, 1, timeoutMs) == 1;
+    };
+    EXPECT_FALSE(isReadable(0));
+
+    // Readable once something completes, and quiet again after it is read and everything is taken
+    uint8_t sendSequence = 0;
+    uint8_t recvSequence = 0;
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send({sendSequence++}));
+    }
+    while (recvSequence < kNumBuffers) {
+        ASSERT_TRUE(isReadable(5000));
+        uint64_t count = 0;
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(count)), read(fd, &count, sizeof(count)));
+        std::vector<BufferRegion> regions;
+        RDMA_ASSERT_NO_THROW(regions = connections.receiver.GetReceivedRegions(1, kNumBuffers, 0));
+        for (auto& region : regions) {
+            EXPECT_EQ(region.ToVector(), std::vector<uint8_t>({recvSequence++}));
+        }
+        RDMA_ASSERT_NO_THROW(connections.receiver.ReleaseReceivedRegions(regions));
+    }
+    // The last batch may have been signalled after the fd was read. Nothing else completes, so it stays quiet after this.
+    uint64_t count = 0;
+    (void)!read(fd, &count, sizeof(count));
+    EXPECT_FALSE(isReadable(0));
+
+    // A disconnection is announced as well
+    RDMA_ASSERT_NO_THROW(connections.sender.Close());
+    ASSERT_TRUE(isReadable(5000));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.Receive(0), easyrdma_Error_Disconnected);
+}
+#endif
+
+TEST_P(RdmaTest, Scaling_Buffers_LessThanCreditCount)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kBufferSize = 4096;
+    const size_t kNumBuffers = 100; // Currently the dll uses 100 buffers for issuing credits
+
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+
+    std::vector<uint8_t> sendBuffer(kBufferSize);
+    for (size_t i = 0; i < kBufferSize; ++i) {
+        sendBuffer[i] = static_cast<uint8_t>(i);
+    }
+    std::vector<uint8_t> receiveBuffer;
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send(sendBuffer));
+    }
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+        ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
+        EXPECT_EQ(sendBuffer, receiveBuffer);
+    }
+}
+
+TEST_P(RdmaTest, Scaling_Buffers_MoreThanCreditCount)
+{
+    // This test occasionally takes a long time to run (see #1622458)
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kBufferSize = 4096;
+    const size_t kNumBuffers = 1024;
+
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kBufferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+
+    std::vector<uint8_t> sendBuffer(kBufferSize);
+    for (size_t i = 0; i < kBufferSize; ++i) {
+        sendBuffer[i] = static_cast<uint8_t>(i);
+    }
+    std::vector<uint8_t> receiveBuffer;
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send(sendBuffer));
+    }
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+        ASSERT_EQ(sendBuffer.size(), receiveBuffer.size());
+        EXPECT_EQ(sendBuffer, receiveBuffer);
+    }
+}
+
+TEST_P(RdmaTest, SendCallbacks_CancellationFromWaitingForCredits)
+{
+    const int rxOverlappedCount = 25;
+    const int transferCount = 50;
+    const size_t eachBufferLen = 4096;
+    std::vector<uint8_t> sendBuffer(eachBufferLen);
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), transferCount));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(eachBufferLen, rxOverlappedCount));
+
+    BufferCompletion completedTransfers[transferCount];
+    auto sender = std::async(std::launch::async, [&]() {
+        for (int i = 0; i < transferCount; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data(), sendBuffer.size(), &completedTransfers[i], nullptr, 100));
+        }
+    });
+    RDMA_ASSERT_NO_THROW(sender.get());
+
+    // Now 50 should be queued, but only 25 sent
+    for (int i = 0; i < rxOverlappedCount; ++i) {
+        RDMA_ASSERT_NO_THROW(completedTransfers[i].WaitForCompletion(100));
+    }
+    // 25th should be queued waiting for a free buffer and not complete
+    EXPECT_THROW(completedTransfers[rxOverlappedCount].WaitForCompletion(50), std::runtime_error);
+
+    RDMA_EXPECT_NO_THROW(connections.Close());
+
+    // Now all the buffers should have completed with a cancelled state
+    for (int i = rxOverlappedCount; i < transferCount; ++i) {
+        RDMA_ASSERT_THROW_WITHCODE(completedTransfers[i].WaitForCompletion(0), easyrdma_Error_OperationCancelled);
+    }
+}
+
+TEST_P(RdmaTest, SendCallbacks_CancellationFromQueued)
+{
+    const int rxOverlappedCount = 500;
+    const int transferCount = 500;
+    const size_t eachBufferLen = 1024 * 1024;
+    std::vector<uint8_t> sendBuffer(eachBufferLen);
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), transferCount));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(eachBufferLen, rxOverlappedCount));
+
+    BufferCompletion completedTransfers[transferCount];
+    auto sender = std::async(std::launch::async, [&]() {
+        for (int i = 0; i < transferCount; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data(), sendBuffer.size(), &completedTransfers[i], nullptr, 100));
         }
     });
     RDMA_ASSERT_NO_THROW(sender.get());
@@ -2038,6 +2910,478 @@ TEST_P(RdmaTest, Delayed_Destruction_Receiver)
     RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, Session::GetPropertyOnSession<uint64_t>(easyrdma_InvalidSession, easyrdma_Property_NumPendingDestructionSessions)));
 }
 
+TEST_P(RdmaTest, SendSignalInterval_SetGet)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(1U, connections.sender.GetPropertyU64(easyrdma_Property_SendSignalInterval)));
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, 8));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(8U, connections.sender.GetPropertyU64(easyrdma_Property_SendSignalInterval)));
+
+    // Zero is not a valid interval, and the receive side does not send
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, 0), easyrdma_Error_InvalidArgument);
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyU64(easyrdma_Property_SendSignalInterval, 8), easyrdma_Error_OperationNotSupported);
+
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(1024, 10));
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, 1), easyrdma_Error_AlreadyConfigured);
+}
+
+TEST_P(RdmaTest, SendSignalInterval_Continuous)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumBuffers = 10;
+    const size_t kEachTransferSize = 64;
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, 4));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+
+    // The sender only waits on idle buffers, so it must keep making progress even though most sends are unsignaled
+    const size_t kTotalTransfers = kNumBuffers * 100;
+    auto receiver = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kTotalTransfers; ++i) {
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+        }
+    });
+    auto sender = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kTotalTransfers; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+        }
+    });
+    RDMA_ASSERT_NO_THROW(sender.get());
+    RDMA_ASSERT_NO_THROW(receiver.get());
+}
+
+TEST_P(RdmaTest, SendSignalInterval_CallbacksForUnsignaledSends)
+{
+    // Completion objects must live longer than the connections
+    const size_t kSignalInterval = 4;
+    std::vector<BufferCompletion> sendCompletions(kSignalInterval);
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumBuffers = 8;
+    const size_t kEachTransferSize = 16;
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyU64(easyrdma_Property_SendSignalInterval, kSignalInterval));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+
+    // Only the last of these sends is signaled, but every send before it still gets its own callback
+    for (size_t i = 0; i < kSignalInterval; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.SendWithCallback(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), &sendCompletions[i]));
+    }
+    for (size_t i = 0; i < kSignalInterval; ++i) {
+        RDMA_ASSERT_NO_THROW(sendCompletions[i].WaitForCompletion(5000)) << "Iteration: " << i;
+        EXPECT_EQ(kEachTransferSize, sendCompletions[i].GetCompletedBytes());
+    }
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(0U, connections.sender.GetPropertyU64(easyrdma_Property_QueuedBuffers)));
+}
+
+TEST_P(RdmaTest, SpinWaitBudget_SetGet)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_SpinWaitBudget)));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyU64(easyrdma_Property_SpinWaitBudget, 50));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(50U, connections.receiver.GetPropertyU64(easyrdma_Property_SpinWaitBudget)));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_SpinWaitBudget, true), easyrdma_Error_InvalidArgument);
+
+    // Can still be changed once configured
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1024, 10));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyU64(easyrdma_Property_SpinWaitBudget, 0));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, connections.receiver.GetPropertyU64(easyrdma_Property_SpinWaitBudget)));
+}
+
+TEST_P(RdmaTest, SpinWaitBudget_Continuous)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumBuffers = 10;
+    const size_t kEachTransferSize = 64;
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyU64(easyrdma_Property_SpinWaitBudget, 20));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyU64(easyrdma_Property_SpinWaitBudget, 20));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+
+    // Waits on both sides spin first and then block, and must not miss a buffer completing in between
+    const size_t kTotalTransfers = kNumBuffers * 100;
+    auto receiver = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kTotalTransfers; ++i) {
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+        }
+    });
+    auto sender = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kTotalTransfers; ++i) {
+            RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+        }
+    });
+    RDMA_ASSERT_NO_THROW(sender.get());
+    RDMA_ASSERT_NO_THROW(receiver.get());
+
+    // The budget never extends a wait past its timeout
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyU64(easyrdma_Property_SpinWaitBudget, 10000000));
+    auto start = std::chrono::steady_clock::now();
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.Receive(50), easyrdma_Error_Timeout);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+}
+
+TEST_P(RdmaTest, HugePages_SendReceive)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    const size_t kNumBuffers = 16;
+    // Not a multiple of the cache line, so the buffers in the slab are padded
+    const size_t kEachTransferSize = 1000;
+    RDMA_ASSERT_NO_THROW(ASSERT_FALSE(connections.receiver.GetPropertyBool(easyrdma_Property_UseHugePages)));
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyBool(easyrdma_Property_UseHugePages, true));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UseHugePages, true));
+    RDMA_ASSERT_NO_THROW(ASSERT_TRUE(connections.receiver.GetPropertyBool(easyrdma_Property_UseHugePages)));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(kEachTransferSize, kNumBuffers));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_UseHugePages, false), easyrdma_Error_AlreadyConfigured);
+
+    for (size_t i = 0; i < kNumBuffers * 4; ++i) {
+        RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+        RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(kEachTransferSize, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+    }
+}
+
+TEST_P(RdmaTest, ThreadPolicies_SetGet)
+{
+    typedef std::array<easyrdma_ThreadPolicy, easyrdma_NumThreadRoles> ThreadPolicies;
+    auto getPolicies = [](easyrdma_Session session) {
+        ThreadPolicies policies;
+        size_t policiesSize = sizeof(policies);
+        RDMA_THROW_IF_FATAL(easyrdma_GetProperty(session, session ? easyrdma_Property_ThreadPolicies : easyrdma_Property_DefaultThreadPolicies, &policies, &policiesSize));
+        return policies;
+    };
+    ThreadPolicies pinned = {};
+    for (auto& policy : pinned) {
+        policy.cpuMask = 1;
+    }
+
+    // Sessions pick up the process-wide defaults when they are created
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(easyrdma_InvalidSession, easyrdma_Property_DefaultThreadPolicies, pinned));
+    {
+        ConnectionPair connections;
+        RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+        ThreadPolicies policies;
+        RDMA_ASSERT_NO_THROW(policies = getPolicies(connections.receiver.GetSessionHandle()));
+        EXPECT_EQ(1U, policies[easyrdma_ThreadRole_ReceiveCompletion].cpuMask);
+    }
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(easyrdma_InvalidSession, easyrdma_Property_DefaultThreadPolicies, ThreadPolicies()));
+
+    // Running threads are moved over as well, and transfers keep working
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(0U, getPolicies(connections.sender.GetSessionHandle())[easyrdma_ThreadRole_Ack].cpuMask));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(64, 10));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(64, 10));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(connections.sender.GetSessionHandle(), easyrdma_Property_ThreadPolicies, pinned));
+    RDMA_ASSERT_NO_THROW(Session::SetPropertyOnSession(connections.receiver.GetSessionHandle(), easyrdma_Property_ThreadPolicies, pinned));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(1U, getPolicies(connections.sender.GetSessionHandle())[easyrdma_ThreadRole_Ack].cpuMask));
+    RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(64, 1)));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(64, 1), connections.receiver.Receive()));
+
+    // Real-time policies need privileges the process may not have. Without them, none of the change is kept.
+    ThreadPolicies realtime = pinned;
+    realtime[easyrdma_ThreadRole_Ack].schedPolicy = easyrdma_SchedPolicy_Fifo;
+    realtime[easyrdma_ThreadRole_Ack].schedPriority = 1;
+    realtime[easyrdma_ThreadRole_Connection].cpuMask = 0;
+    int32_t result = easyrdma_SetProperty(connections.receiver.GetSessionHandle(), easyrdma_Property_ThreadPolicies, &realtime, sizeof(realtime));
+    ThreadPolicies policies;
+    RDMA_ASSERT_NO_THROW(policies = getPolicies(connections.receiver.GetSessionHandle()));
+    if (result == easyrdma_Error_Success) {
+        EXPECT_EQ(easyrdma_SchedPolicy_Fifo, policies[easyrdma_ThreadRole_Ack].schedPolicy);
+        EXPECT_EQ(0U, policies[easyrdma_ThreadRole_Connection].cpuMask);
+    } else {
+        EXPECT_EQ(easyrdma_Error_OperationNotSupported, result);
+        EXPECT_EQ(easyrdma_SchedPolicy_Default, policies[easyrdma_ThreadRole_Ack].schedPolicy);
+        EXPECT_EQ(1U, policies[easyrdma_ThreadRole_Connection].cpuMask);
+    }
+    RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(64, 2)));
+    RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(64, 2), connections.receiver.Receive()));
+
+    ThreadPolicies invalid = {};
+    invalid[easyrdma_ThreadRole_Connection].schedPolicy = 99;
+    RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession(connections.receiver.GetSessionHandle(), easyrdma_Property_ThreadPolicies, invalid), easyrdma_Error_InvalidArgument);
+    invalid[easyrdma_ThreadRole_Connection].schedPolicy = easyrdma_SchedPolicy_Default;
+    invalid[easyrdma_ThreadRole_Connection].schedPriority = 10;
+    RDMA_ASSERT_THROW_WITHCODE(Session::SetPropertyOnSession(connections.receiver.GetSessionHandle(), easyrdma_Property_ThreadPolicies, invalid), easyrdma_Error_InvalidArgument);
+}
+
+TEST_P(RdmaTest, InlineThreshold_SendReceive)
+{
+    RdmaAddress localAddressListener = GetEndpointAddresses().first;
+    RdmaAddress localAddressConnector = GetEndpointAddresses().second;
+    const uint64_t kInlineThreshold = 256;
+
+    Session sessionConnectorSender, sessionListener, sessionReceiver;
+    RDMA_ASSERT_NO_THROW(sessionListener = Session::CreateListener(localAddressListener.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(sessionConnectorSender = Session::CreateConnector(localAddressConnector.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, sessionConnectorSender.GetPropertyU64(easyrdma_Property_InlineThreshold)));
+    RDMA_ASSERT_NO_THROW(sessionConnectorSender.SetPropertyU64(easyrdma_Property_InlineThreshold, kInlineThreshold));
+    RDMA_ASSERT_NO_THROW(sessionListener.SetPropertyU64(easyrdma_Property_InlineThreshold, kInlineThreshold));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(kInlineThreshold, sessionConnectorSender.GetPropertyU64(easyrdma_Property_InlineThreshold)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(kInlineThreshold, sessionListener.GetPropertyU64(easyrdma_Property_InlineThreshold)));
+
+    auto accept = std::async(std::launch::async, [&]() { return sessionListener.Accept(easyrdma_Direction_Receive); });
+    RDMA_ASSERT_NO_THROW(sessionConnectorSender.Connect(easyrdma_Direction_Send, localAddressListener.GetAddrString(), sessionListener.GetLocalPort()));
+    RDMA_ASSERT_NO_THROW(sessionReceiver = accept.get());
+
+    // Once connected the property reports what the QP could actually reserve, and can no longer be changed
+    RDMA_ASSERT_NO_THROW(EXPECT_LE(sessionConnectorSender.GetPropertyU64(easyrdma_Property_InlineThreshold), kInlineThreshold));
+    RDMA_ASSERT_NO_THROW(EXPECT_LE(sessionReceiver.GetPropertyU64(easyrdma_Property_InlineThreshold), kInlineThreshold));
+    RDMA_ASSERT_THROW_WITHCODE(sessionConnectorSender.SetPropertyU64(easyrdma_Property_InlineThreshold, 0), easyrdma_Error_AlreadyConnected);
+
+    // Mix control-sized messages that fit inline with ones that don't
+    const size_t kNumBuffers = 10;
+    const size_t kBufferSize = 1024;
+    RDMA_ASSERT_NO_THROW(sessionReceiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(sessionConnectorSender.ConfigureBuffers(kBufferSize, kNumBuffers));
+    const size_t kSizes[] = {64, 256, 257, 1024, 1};
+    const size_t kIterations = 100;
+    auto receiver = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kIterations; ++i) {
+            size_t size = kSizes[i % (sizeof(kSizes) / sizeof(kSizes[0]))];
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(size, static_cast<uint8_t>(i)), sessionReceiver.Receive())) << "Iteration: " << i;
+        }
+    });
+    for (size_t i = 0; i < kIterations; ++i) {
+        size_t size = kSizes[i % (sizeof(kSizes) / sizeof(kSizes[0]))];
+        RDMA_ASSERT_NO_THROW(sessionConnectorSender.Send(std::vector<uint8_t>(size, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+    }
+    RDMA_ASSERT_NO_THROW(receiver.get());
+}
+
+TEST_P(RdmaTest, RingBuffer_EnableDisable)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(false, connections.receiver.GetPropertyBool(easyrdma_Property_UseRingBuffer)));
+
+    // Send side can't receive into a ring
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.SetPropertyBool(easyrdma_Property_UseRingBuffer, true), easyrdma_Error_OperationNotSupported);
+
+// Rings need immediate data, which is only supported on Linux
+#ifdef __linux__
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UseRingBuffer, true));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(true, connections.receiver.GetPropertyBool(easyrdma_Property_UseRingBuffer)));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.ConfigureExternalBuffer(std::vector<uint8_t>(1024).data(), 1024, 10), easyrdma_Error_OperationNotSupported);
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1024, 10));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_UseRingBuffer, false), easyrdma_Error_AlreadyConfigured);
+#else
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_UseRingBuffer, true), easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+#ifdef __linux__
+TEST_P(RdmaTest, RingBuffer_MixedSizes)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    // Small transfers only use the bytes they need, so many more of them fit than the slot size suggests.
+    // Sizes are picked so transfers regularly wrap around the end of the ring.
+    const size_t kNumBuffers = 10;
+    const size_t kBufferSize = 1000;
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UseRingBuffer, true));
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kBufferSize, kNumBuffers));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureBuffers(2 * kBufferSize * kNumBuffers, kNumBuffers));
+    const size_t kSizes[] = {1, 999, 3000, 17, 0, 4096, 10000, 333};
+    const size_t kIterations = 1000;
+    auto receiver = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kIterations; ++i) {
+            size_t size = kSizes[i % (sizeof(kSizes) / sizeof(kSizes[0]))];
+            RDMA_ASSERT_NO_THROW(EXPECT_EQ(std::vector<uint8_t>(size, static_cast<uint8_t>(i)), connections.receiver.Receive())) << "Iteration: " << i;
+        }
+    });
+    for (size_t i = 0; i < kIterations; ++i) {
+        size_t size = kSizes[i % (sizeof(kSizes) / sizeof(kSizes[0]))];
+        RDMA_ASSERT_NO_THROW(connections.sender.Send(std::vector<uint8_t>(size, static_cast<uint8_t>(i)))) << "Iteration: " << i;
+    }
+    RDMA_ASSERT_NO_THROW(receiver.get());
+
+    // Nothing bigger than the whole ring can ever be sent
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.Send(std::vector<uint8_t>(kBufferSize * kNumBuffers + 1)), easyrdma_Error_SendTooLargeForRecvBuffer);
+}
+#endif
+
+TEST_P(RdmaTest, PullMode_EnableDisable)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(false, connections.sender.GetPropertyBool(easyrdma_Property_UsePullMode)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(false, connections.receiver.GetPropertyBool(easyrdma_Property_UsePullMode)));
+
+// Pulling needs immediate data, which is only supported on Linux
+#ifdef __linux__
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(true, connections.receiver.GetPropertyBool(easyrdma_Property_UsePullMode)));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_UseRingBuffer, true), easyrdma_Error_OperationNotSupported);
+
+    // Only regions of an external buffer can be pulled, and receive buffers must hold a descriptor
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.ConfigureBuffers(1024, 10), easyrdma_Error_OperationNotSupported);
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.ConfigureBuffers(4, 10), easyrdma_Error_InvalidSize);
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(1024, 10));
+    RDMA_ASSERT_THROW_WITHCODE(connections.receiver.SetPropertyBool(easyrdma_Property_UsePullMode, false), easyrdma_Error_AlreadyConfigured);
+#else
+    RDMA_ASSERT_THROW_WITHCODE(connections.sender.SetPropertyBool(easyrdma_Property_UsePullMode, true), easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+#ifdef __linux__
+TEST_P(RdmaTest, PullMode_SendReceive)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+
+    // The receiver reads each region out of the sender's buffer, and the sender only gets it back once it has
+    const size_t kBufferCount = 4;
+    const size_t kEachBufferLen = 4 * 1024 * 1024;
+    const size_t kTransferCount = 50;
+    std::vector<uint8_t> sendBuffer(kBufferCount * kEachBufferLen);
+    for (size_t i = 0; i < sendBuffer.size(); ++i) {
+        sendBuffer[i] = static_cast<uint8_t>(i * 7);
+    }
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kEachBufferLen, kBufferCount));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), kBufferCount));
+
+    auto receiver = std::async(std::launch::async, [&]() {
+        for (size_t i = 0; i < kTransferCount; ++i) {
+            // Every other transfer is a short one to make sure only the published length is read
+            size_t length = (i % 2) ? kEachBufferLen : i + 1;
+            std::vector<uint8_t> receiveBuffer;
+            RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+            ASSERT_EQ(receiveBuffer.size(), length);
+            EXPECT_EQ(memcmp(receiveBuffer.data(), sendBuffer.data() + (i % kBufferCount) * kEachBufferLen, length), 0) << "Iteration: " << i;
+        }
+    });
+    std::vector<std::unique_ptr<BufferCompletion>> completions;
+    for (size_t i = 0; i < kTransferCount; ++i) {
+        if (i >= kBufferCount) {
+            // Don't hand a region out again until the receiver is done reading it
+            size_t previous = i - kBufferCount;
+            RDMA_ASSERT_NO_THROW(completions[previous]->WaitForCompletion(5000));
+            EXPECT_EQ((previous % 2) ? kEachBufferLen : previous + 1, completions[previous]->GetCompletedBytes());
+        }
+        size_t length = (i % 2) ? kEachBufferLen : i + 1;
+        completions.emplace_back(new BufferCompletion());
+        RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data() + (i % kBufferCount) * kEachBufferLen, length, completions.back().get()));
+    }
+    RDMA_ASSERT_NO_THROW(receiver.get());
+    RDMA_ASSERT_NO_THROW(connections.Close()); // Explicitly close the sessions before destroying the external buffers
+}
+
+TEST_P(RdmaTest, PullMode_MoreRegionsThanReadDepth)
+{
+    ConnectionPair connections;
+    RDMA_ASSERT_NO_THROW(connections = GetLoopbackConnection());
+    RDMA_ASSERT_NO_THROW(connections.sender.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+    RDMA_ASSERT_NO_THROW(connections.receiver.SetPropertyBool(easyrdma_Property_UsePullMode, true));
+
+    // Far more descriptors arrive at once than the QP may have reads in flight, so most wait for earlier reads
+    const size_t kRegionCount = 256;
+    const size_t kRegionLen = 64;
+    std::vector<uint8_t> sendBuffer(kRegionCount * kRegionLen);
+    for (size_t i = 0; i < sendBuffer.size(); ++i) {
+        sendBuffer[i] = static_cast<uint8_t>(i * 13);
+    }
+    RDMA_ASSERT_NO_THROW(connections.receiver.ConfigureBuffers(kRegionLen, kRegionCount));
+    RDMA_ASSERT_NO_THROW(connections.sender.ConfigureExternalBuffer(sendBuffer.data(), sendBuffer.size(), kRegionCount));
+
+    std::vector<std::unique_ptr<BufferCompletion>> completions;
+    for (size_t i = 0; i < kRegionCount; ++i) {
+        completions.emplace_back(new BufferCompletion());
+        RDMA_ASSERT_NO_THROW(connections.sender.QueueExternalBufferWithCallback(sendBuffer.data() + i * kRegionLen, kRegionLen, completions.back().get()));
+    }
+    for (size_t i = 0; i < kRegionCount; ++i) {
+        std::vector<uint8_t> receiveBuffer;
+        RDMA_ASSERT_NO_THROW(receiveBuffer = connections.receiver.Receive());
+        ASSERT_EQ(kRegionLen, receiveBuffer.size());
+        EXPECT_EQ(memcmp(receiveBuffer.data(), sendBuffer.data() + i * kRegionLen, kRegionLen), 0) << "Region: " << i;
+    }
+    for (size_t i = 0; i < kRegionCount; ++i) {
+        RDMA_ASSERT_NO_THROW(completions[i]->WaitForCompletion(5000));
+        EXPECT_EQ(kRegionLen, completions[i]->GetCompletedBytes());
+    }
+    RDMA_ASSERT_NO_THROW(connections.Close()); // Explicitly close the sessions before destroying the external buffer
+}
+#endif
+
+TEST_P(RdmaTest, SharedReceiveQueue_Properties)
+{
+    Session sessionListener;
+    RdmaAddress localAddressListener = GetEndpointAddresses().first;
+    RDMA_ASSERT_NO_THROW(sessionListener = Session::CreateListener(localAddressListener.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, sessionListener.GetPropertyU64(easyrdma_Property_SharedReceiveBufferSize)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, sessionListener.GetPropertyU64(easyrdma_Property_SharedReceiveBufferCount)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(0U, sessionListener.GetPropertyU64(easyrdma_Property_SharedReceiveShortages)));
+    RDMA_ASSERT_THROW_WITHCODE(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveShortages, 1), easyrdma_Error_ReadOnlyProperty);
+#ifdef __linux__
+    RDMA_ASSERT_NO_THROW(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveBufferSize, 4096));
+    RDMA_ASSERT_NO_THROW(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveBufferCount, 64));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(4096U, sessionListener.GetPropertyU64(easyrdma_Property_SharedReceiveBufferSize)));
+    RDMA_ASSERT_NO_THROW(ASSERT_EQ(64U, sessionListener.GetPropertyU64(easyrdma_Property_SharedReceiveBufferCount)));
+#else
+    RDMA_ASSERT_THROW_WITHCODE(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveBufferCount, 64), easyrdma_Error_OperationNotSupported);
+#endif
+}
+
+#ifdef __linux__
+TEST_P(RdmaTest, SharedReceiveQueue_MultipleSenders)
+{
+    RdmaAddress localAddressListener = GetEndpointAddresses().first;
+    RdmaAddress localAddressConnector = GetEndpointAddresses().second;
+    const size_t kNumSessions = 4;
+    const size_t kPoolBufferSize = 4096;
+    const size_t kPoolBufferCount = 16;
+
+    // Every receiver can have more outstanding than its share of the pool, relying on the others being idle
+    Session sessionListener;
+    RDMA_ASSERT_NO_THROW(sessionListener = Session::CreateListener(localAddressListener.GetAddrString(), 0));
+    RDMA_ASSERT_NO_THROW(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveBufferSize, kPoolBufferSize));
+    RDMA_ASSERT_NO_THROW(sessionListener.SetPropertyU64(easyrdma_Property_SharedReceiveBufferCount, kPoolBufferCount));
+    std::vector<Session> senders(kNumSessions), receivers(kNumSessions);
+    for (size_t i = 0; i < kNumSessions; ++i) {
+        RDMA_ASSERT_NO_THROW(senders[i] = Session::CreateConnector(localAddressConnector.GetAddrString(), 0));
+        auto accept = std::async(std::launch::async, [&]() { return sessionListener.Accept(easyrdma_Direction_Receive); });
+        RDMA_ASSERT_NO_THROW(senders[i].Connect(easyrdma_Direction_Send, localAddressListener.GetAddrString(), sessionListener.GetLocalPort()));
+        RDMA_ASSERT_NO_THROW(receivers[i] = accept.get());
+        RDMA_ASSERT_THROW_WITHCODE(receivers[i].ConfigureBuffers(kPoolBufferSize + 1, 8), easyrdma_Error_InvalidSize);
+        RDMA_ASSERT_NO_THROW(receivers[i].ConfigureBuffers(kPoolBufferSize, 8));
+        RDMA_ASSERT_NO_THROW(senders[i].ConfigureBuffers(kPoolBufferSize, 8));
+    }
+
+    // Each receiver only sees what its own sender sent
+    const size_t kIterations = 200;
+    std::vector<std::future<void>> tasks;
+    for (size_t session = 0; session < kNumSessions; ++session) {
+        tasks.push_back(std::async(std::launch::async, [&, session]() {
+            for (size_t i = 0; i < kIterations; ++i) {
+                std::vector<uint8_t> expected(1 + (i * 37) % kPoolBufferSize, static_cast<uint8_t>(session * kIterations + i));
+                RDMA_ASSERT_NO_THROW(EXPECT_EQ(expected, receivers[session].Receive())) << "Session: " << session << " Iteration: " << i;
+            }
+        }));
+        tasks.push_back(std::async(std::launch::async, [&, session]() {
+            for (size_t i = 0; i < kIterations; ++i) {
+                std::vector<uint8_t> data(1 + (i * 37) % kPoolBufferSize, static_cast<uint8_t>(session * kIterations + i));
+                RDMA_ASSERT_NO_THROW(senders[session].Send(data)) << "Session: " << session << " Iteration: " << i;
+            }
+        }));
+    }
+    for (auto& task : tasks) {
+        RDMA_ASSERT_NO_THROW(task.get());
+    }
+}
+#endif
+
 TEST_P(RdmaTest, PollingMode_EnableDisable)
 {
     ConnectionPair connections;
@@ -14,6 +14,7 @@
 #include <gtest/gtest.h>
 #include "common/RdmaError.h"
 #include <boost/thread/shared_mutex.hpp>
+#include <atomic>
 #include <vector>
 #include <random>
 #include <chrono>
@@ -386,6 +387,53 @@ TEST(AccessManager, AutoRef)
     EXPECT_FALSE(resource->accessManager.HasSharedAccess());
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//
+//  KeepAlive test
+//
+//  Description:
+//     Checks that keep-alive refs don't contend with exclusive access and
+//     hold off destruction until they are released
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(AccessManager, KeepAlive)
+{
+    auto resource = std::make_shared<AccessManagerOwner>();
+
+    {
+        tAccessManagedRef<AccessManagerOwner> exclusiveRef(resource, kAccess_Exclusive);
+        tAccessManagedRef<AccessManagerOwner> ref(resource, kAccess_KeepAlive);
+        EXPECT_TRUE(ref);
+        EXPECT_EQ(1UL, resource->accessManager.DebugGetKeepAliveCount());
+        EXPECT_EQ(1UL, resource->accessManager.DebugGetRefCount());
+        tAccessManagedRef<AccessManagerOwner> ref2 = ref;
+        EXPECT_EQ(2UL, resource->accessManager.DebugGetKeepAliveCount());
+    }
+    EXPECT_EQ(0UL, resource->accessManager.DebugGetKeepAliveCount());
+
+    // Destruction waits for the keep-alive held by another thread
+    tAccessManagedRef<AccessManagerOwner> ownerRef(resource, kAccess_Exclusive);
+    std::atomic<bool> acquired(false);
+    std::atomic<bool> released(false);
+    std::thread user([&]() {
+        tAccessManagedRef<AccessManagerOwner> ref(resource, kAccess_KeepAlive);
+        acquired = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        released = true;
+    });
+    while (!acquired) {
+        std::this_thread::yield();
+    }
+    ownerRef.ReleaseAndWaitForAllReferencesGone();
+    EXPECT_TRUE(released);
+    user.join();
+
+    // No more once closed
+    tAccessManagedRef<AccessManagerOwner> lateRef(resource, kAccess_KeepAlive);
+    EXPECT_FALSE(lateRef);
+    EXPECT_EQ(0UL, resource->accessManager.DebugGetKeepAliveCount());
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 //  ReleaseReturn test
@@ -0,0 +1,144 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+//============================================================================
+//  The code to be tested
+//============================================================================
+#include "common/CallbackExecutor.h"
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace EasyRDMA
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Disabled
+//
+//  Description:
+//      With no threads, nothing is handed a worker so callbacks run inline
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(CallbackExecutor, Disabled)
+{
+    auto& executor = GetCallbackExecutor();
+    executor.SetThreadCount(0);
+    EXPECT_EQ(0U, executor.GetThreadCount());
+    EXPECT_EQ(nullptr, executor.AssignWorker());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  RequiredWhileDisabled
+//
+//  Description:
+//      A queue that can't run callbacks inline still gets a working worker
+//      with no threads configured
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(CallbackExecutor, RequiredWhileDisabled)
+{
+    auto& executor = GetCallbackExecutor();
+    executor.SetThreadCount(0);
+    CallbackExecutor::Worker* worker = executor.AssignWorker(true);
+    ASSERT_NE(nullptr, worker);
+    std::atomic<bool> ran(false);
+    executor.Submit(worker, [&]() { ran = true; });
+    executor.Flush(worker);
+    EXPECT_TRUE(ran.load());
+    EXPECT_EQ(nullptr, executor.AssignWorker());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  OrderedPerWorker
+//
+//  Description:
+//      Tasks submitted to one worker run in order, and Flush() waits for them
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(CallbackExecutor, OrderedPerWorker)
+{
+    const size_t kNumTasks = 1000;
+    auto& executor = GetCallbackExecutor();
+    executor.SetThreadCount(2);
+    CallbackExecutor::Worker* workers[2] = {executor.AssignWorker(), executor.AssignWorker()};
+    ASSERT_NE(nullptr, workers[0]);
+    ASSERT_NE(nullptr, workers[1]);
+    EXPECT_NE(workers[0], workers[1]);
+
+    std::vector<size_t> ran[2];
+    for (size_t i = 0; i < kNumTasks; ++i) {
+        for (size_t w = 0; w < 2; ++w) {
+            executor.Submit(workers[w], [&ran, w, i]() { ran[w].push_back(i); });
+        }
+    }
+    for (size_t w = 0; w < 2; ++w) {
+        executor.Flush(workers[w]);
+        ASSERT_EQ(kNumTasks, ran[w].size());
+        for (size_t i = 0; i < kNumTasks; ++i) {
+            ASSERT_EQ(i, ran[w][i]);
+        }
+    }
+    executor.SetThreadCount(0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  FlushFromWorker
+//
+//  Description:
+//      A task flushing its own worker doesn't wait on itself
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(CallbackExecutor, FlushFromWorker)
+{
+    auto& executor = GetCallbackExecutor();
+    executor.SetThreadCount(1);
+    CallbackExecutor::Worker* worker = executor.AssignWorker();
+    ASSERT_NE(nullptr, worker);
+    std::atomic<bool> flushed(false);
+    executor.Submit(worker, [&]() {
+        executor.Flush(worker);
+        flushed = true;
+    });
+    executor.Flush(worker);
+    EXPECT_TRUE(flushed.load());
+    executor.SetThreadCount(0);
+}
+
+#ifdef __linux__
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Affinity
+//
+//  Description:
+//      Tasks submitted after the affinity is set run on the chosen CPU
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(CallbackExecutor, Affinity)
+{
+    auto& executor = GetCallbackExecutor();
+    executor.SetThreadCount(1);
+    CallbackExecutor::Worker* worker = executor.AssignWorker();
+    ASSERT_NE(nullptr, worker);
+    executor.SetAffinity(1);
+    EXPECT_EQ(1U, executor.GetAffinity());
+    int cpu = -1;
+    executor.Submit(worker, [&]() { cpu = sched_getcpu(); });
+    executor.Flush(worker);
+    EXPECT_EQ(0, cpu);
+    executor.SetAffinity(0);
+    executor.SetThreadCount(0);
+}
+#endif
+
+}; // namespace EasyRDMA
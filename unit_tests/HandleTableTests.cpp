@@ -0,0 +1,136 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+//============================================================================
+//  The code to be tested
+//============================================================================
+#include "common/tHandleTable.h"
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace EasyRDMA
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Sanity
+//
+//  Description:
+//      Inserted objects can be looked up until they are erased
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(HandleTable, Sanity)
+{
+    tHandleTable<int> table;
+    EXPECT_EQ(0U, table.size());
+    EXPECT_EQ(nullptr, table.Lookup(0));
+    EXPECT_EQ(nullptr, table.Lookup(1));
+
+    std::vector<tHandleTable<int>::Handle> handles;
+    for (int i = 0; i < 1000; ++i) {
+        auto handle = table.Insert(std::make_shared<int>(i));
+        ASSERT_NE(0U, handle);
+        handles.push_back(handle);
+    }
+    EXPECT_EQ(1000U, table.size());
+    for (int i = 0; i < 1000; ++i) {
+        auto object = table.Lookup(handles[i]);
+        ASSERT_NE(nullptr, object);
+        EXPECT_EQ(i, *object);
+        EXPECT_TRUE(table.IsCurrent(handles[i]));
+    }
+
+    auto erased = table.Erase(handles[10]);
+    ASSERT_NE(nullptr, erased);
+    EXPECT_EQ(10, *erased);
+    EXPECT_EQ(nullptr, table.Lookup(handles[10]));
+    EXPECT_FALSE(table.IsCurrent(handles[10]));
+    EXPECT_EQ(nullptr, table.Erase(handles[10]));
+    EXPECT_EQ(999U, table.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  StaleHandle
+//
+//  Description:
+//      A handle to an erased object doesn't resolve to whatever reuses its
+//      slot
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(HandleTable, StaleHandle)
+{
+    tHandleTable<int> table;
+    auto first = table.Insert(std::make_shared<int>(1));
+    ASSERT_NE(nullptr, table.Erase(first));
+    auto second = table.Insert(std::make_shared<int>(2));
+    ASSERT_NE(0U, second);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(nullptr, table.Lookup(first));
+    EXPECT_EQ(nullptr, table.Erase(first));
+    auto object = table.Lookup(second);
+    ASSERT_NE(nullptr, object);
+    EXPECT_EQ(2, *object);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  ConcurrentLookup
+//
+//  Description:
+//      Lookups racing with erase and reinsertion either find the object their
+//      handle was issued for or nothing
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(HandleTable, ConcurrentLookup)
+{
+    const int kNumRounds = 2000;
+    tHandleTable<int> table;
+    std::atomic<tHandleTable<int>::Handle> current(table.Insert(std::make_shared<int>(0)));
+    std::atomic<bool> done(false);
+    std::atomic<bool> mismatch(false);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&]() {
+            // Remember which value each handle was issued for, and check lookups never return a different one
+            std::vector<std::pair<tHandleTable<int>::Handle, int>> seen;
+            while (!done) {
+                auto handle = current.load();
+                auto object = table.Lookup(handle);
+                if (object) {
+                    for (auto& entry : seen) {
+                        if (entry.first == handle && entry.second != *object) {
+                            mismatch = true;
+                        }
+                    }
+                    if (seen.size() < 64) {
+                        seen.emplace_back(handle, *object);
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (int i = 1; i <= kNumRounds; ++i) {
+        auto old = current.load();
+        current = table.Insert(std::make_shared<int>(i));
+        ASSERT_NE(nullptr, table.Erase(old));
+        if (i % 64 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_FALSE(mismatch);
+    EXPECT_EQ(1U, table.size());
+}
+
+}; // namespace EasyRDMA
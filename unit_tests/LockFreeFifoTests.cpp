@@ -0,0 +1,137 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+//============================================================================
+//  The code to be tested
+//============================================================================
+#include "common/tLockFreeFifo.h"
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace EasyRDMA
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Sanity
+//
+//  Description:
+//      Elements come out in order, including across the end of the storage
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(LockFreeFifo, Sanity)
+{
+    tLockFreeFifo<size_t> fifo(4);
+    EXPECT_EQ(4U, fifo.capacity());
+    EXPECT_TRUE(fifo.empty());
+    size_t value = 0;
+    EXPECT_FALSE(fifo.pop(value));
+
+    for (size_t round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < 3; ++i) {
+            fifo.push(round * 10 + i);
+        }
+        EXPECT_EQ(3U, fifo.size());
+        for (size_t i = 0; i < 3; ++i) {
+            ASSERT_TRUE(fifo.pop(value));
+            EXPECT_EQ(round * 10 + i, value);
+        }
+        EXPECT_TRUE(fifo.empty());
+    }
+
+    fifo.push(1);
+    fifo.reallocate(2);
+    EXPECT_TRUE(fifo.empty());
+    EXPECT_EQ(2U, fifo.capacity());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  SingleProducerSingleConsumer
+//
+//  Description:
+//      A stream handed from one thread to another arrives complete and in
+//      order while the fifo is constantly full or empty
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(LockFreeFifo, SingleProducerSingleConsumer)
+{
+    const size_t kNumElements = 20000;
+    tLockFreeFifo<size_t> fifo(16);
+    std::thread producer([&]() {
+        for (size_t i = 0; i < kNumElements; ++i) {
+            while (fifo.size() == fifo.capacity()) {
+                std::this_thread::yield();
+            }
+            fifo.push(i);
+        }
+    });
+    size_t expected = 0;
+    while (expected < kNumElements) {
+        size_t value;
+        if (fifo.pop(value)) {
+            ASSERT_EQ(expected, value);
+            ++expected;
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(fifo.empty());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  MultipleConsumers
+//
+//  Description:
+//      Concurrent consumers each get a distinct element and nothing is lost
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(LockFreeFifo, MultipleConsumers)
+{
+    const size_t kNumElements = 8000;
+    const size_t kNumConsumers = 4;
+    tLockFreeFifo<size_t> fifo(64);
+    std::vector<std::vector<size_t>> received(kNumConsumers);
+    std::atomic<size_t> numReceived(0);
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < kNumConsumers; ++c) {
+        consumers.emplace_back([&, c]() {
+            while (numReceived.load() < kNumElements) {
+                size_t value;
+                if (fifo.pop(value)) {
+                    received[c].push_back(value);
+                    ++numReceived;
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < kNumElements; ++i) {
+        while (fifo.size() == fifo.capacity()) {
+            std::this_thread::yield();
+        }
+        fifo.push(i);
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    std::vector<bool> seen(kNumElements, false);
+    for (auto& values : received) {
+        // Each consumer sees its share in the order it was pushed
+        for (size_t i = 0; i < values.size(); ++i) {
+            ASSERT_FALSE(seen[values[i]]);
+            seen[values[i]] = true;
+            if (i) {
+                ASSERT_LT(values[i - 1], values[i]);
+            }
+        }
+    }
+    EXPECT_EQ(kNumElements, numReceived.load());
+}
+
+}; // namespace EasyRDMA
@@ -0,0 +1,182 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+//============================================================================
+//  The code to be tested
+//============================================================================
+#include "common/tRingCreditWindow.h"
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <gtest/gtest.h>
+#include <deque>
+#include <random>
+
+namespace EasyRDMA
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Sanity
+//
+//  Description:
+//      Spans are packed back to back and only consume the bytes they use
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(RingCreditWindow, Sanity)
+{
+    tRingCreditWindow window;
+    EXPECT_FALSE(window.enabled());
+    window.reset(1000);
+    EXPECT_TRUE(window.enabled());
+
+    // Every transfer needs a slot, even with bytes available
+    uint64_t offset = 0;
+    EXPECT_FALSE(window.reserve(1, offset));
+    for (int i = 0; i < 3; ++i) {
+        window.addCredit(0);
+    }
+    ASSERT_TRUE(window.reserve(100, offset));
+    EXPECT_EQ(0U, offset);
+    ASSERT_TRUE(window.reserve(1, offset));
+    EXPECT_EQ(100U, offset);
+    ASSERT_TRUE(window.reserve(899, offset));
+    EXPECT_EQ(101U, offset);
+    EXPECT_EQ(0U, window.available());
+    EXPECT_EQ(0U, window.slots());
+
+    // Nothing fits until credits come back
+    EXPECT_FALSE(window.reserve(0, offset));
+    window.addCredit(100);
+    ASSERT_TRUE(window.reserve(100, offset));
+    EXPECT_EQ(0U, offset);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Wrap
+//
+//  Description:
+//      A span that doesn't fit at the end of the ring skips to the start,
+//      and the skipped bytes must be credited back along with it
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(RingCreditWindow, Wrap)
+{
+    tRingCreditWindow window;
+    tRingSpanTracker tracker;
+    window.reset(1000);
+    tracker.reset(1000, 4);
+    window.addCredit(0);
+
+    uint64_t offset = 0;
+    ASSERT_TRUE(window.reserve(600, offset));
+    tracker.arrive(0, offset, 600);
+    EXPECT_EQ(600U, tracker.release(0));
+    window.addCredit(600);
+
+    // 600 bytes are free, but only 400 are left before the end
+    ASSERT_TRUE(window.reserve(500, offset));
+    EXPECT_EQ(0U, offset);
+    EXPECT_EQ(100U, window.available());
+    tracker.arrive(0, offset, 500);
+    EXPECT_EQ(900U, tracker.release(0));
+    window.addCredit(900);
+    EXPECT_EQ(1000U, window.available());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  OutOfOrderRelease
+//
+//  Description:
+//      Releasing a later span credits nothing until the ones ahead of it
+//      are released too, and its slot can be reused in the meantime
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(RingCreditWindow, OutOfOrderRelease)
+{
+    tRingSpanTracker tracker;
+    tracker.reset(1000, 3);
+    tracker.arrive(0, 0, 10);
+    tracker.arrive(1, 10, 20);
+    tracker.arrive(2, 30, 30);
+    EXPECT_EQ(3U, tracker.outstanding());
+    EXPECT_EQ(0U, tracker.release(2));
+    EXPECT_EQ(0U, tracker.release(1));
+    tracker.arrive(1, 60, 5);
+    EXPECT_EQ(2U, tracker.outstanding());
+    EXPECT_EQ(60U, tracker.release(0));
+    EXPECT_EQ(5U, tracker.release(1));
+    EXPECT_EQ(0U, tracker.outstanding());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  RandomizedStream
+//
+//  Description:
+//      Runs a stream of random-sized transfers with random release order and
+//      checks that both sides always agree on where data lands, that no span
+//      overwrites bytes that are still in use, and that slots bound the number
+//      of outstanding spans
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(RingCreditWindow, RandomizedStream)
+{
+    const uint64_t kRingSize = 4096;
+    const size_t kMaxOutstanding = 16;
+    tRingCreditWindow window;
+    tRingSpanTracker tracker;
+    window.reset(kRingSize);
+    tracker.reset(kRingSize, kMaxOutstanding);
+    for (size_t i = 0; i < kMaxOutstanding; ++i) {
+        window.addCredit(0);
+    }
+
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<uint64_t> lengths(0, kRingSize / 3);
+    struct InUse
+    {
+        size_t slot;
+        uint64_t offset;
+        uint64_t length;
+    };
+    std::deque<InUse> inUse;
+    std::vector<size_t> freeSlots;
+    for (size_t i = 0; i < kMaxOutstanding; ++i) {
+        freeSlots.push_back(i);
+    }
+    std::vector<bool> occupied(kRingSize, false);
+
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t length = lengths(generator);
+        uint64_t offset = 0;
+        // Slots alone must keep the sender from writing more spans than there are receive slots
+        if (window.reserve(length, offset)) {
+            ASSERT_FALSE(freeSlots.empty());
+            ASSERT_LE(offset + length, kRingSize);
+            for (uint64_t b = offset; b < offset + length; ++b) {
+                ASSERT_FALSE(occupied[b]) << "Iteration: " << i;
+                occupied[b] = true;
+            }
+            size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            tracker.arrive(slot, offset, length);
+            inUse.push_back({slot, offset, length});
+        } else {
+            ASSERT_FALSE(inUse.empty());
+            auto victim = inUse.begin() + static_cast<ptrdiff_t>(generator() % inUse.size());
+            for (uint64_t b = victim->offset; b < victim->offset + victim->length; ++b) {
+                occupied[b] = false;
+            }
+            uint64_t credit = tracker.release(victim->slot);
+            freeSlots.push_back(victim->slot);
+            inUse.erase(victim);
+            window.addCredit(credit);
+        }
+    }
+}
+
+}; // namespace EasyRDMA
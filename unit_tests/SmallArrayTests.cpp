@@ -0,0 +1,67 @@
+// Copyright (c) 2022 National Instruments
+// SPDX-License-Identifier: MIT
+
+//============================================================================
+//  The code to be tested
+//============================================================================
+#include "common/tSmallArray.h"
+
+//============================================================================
+//  Includes
+//============================================================================
+#include <gtest/gtest.h>
+#include <numeric>
+
+namespace EasyRDMA
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Inline
+//
+//  Description:
+//      Arrays up to the inline size are held within the object
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(SmallArray, Inline)
+{
+    tSmallArray<size_t, 8> array(8);
+    EXPECT_EQ(8U, array.size());
+    auto self = reinterpret_cast<uintptr_t>(&array);
+    auto data = reinterpret_cast<uintptr_t>(array.data());
+    EXPECT_GE(data, self);
+    EXPECT_LT(data, self + sizeof(array));
+
+    std::iota(array.begin(), array.end(), 0);
+    for (size_t i = 0; i < array.size(); ++i) {
+        EXPECT_EQ(i, array[i]);
+    }
+
+    tSmallArray<size_t, 8> empty(0);
+    EXPECT_EQ(0U, empty.size());
+    EXPECT_EQ(empty.begin(), empty.end());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Heap
+//
+//  Description:
+//      Arrays larger than the inline size are held on the heap
+//
+//////////////////////////////////////////////////////////////////////////////
+TEST(SmallArray, Heap)
+{
+    tSmallArray<size_t, 8> array(1000);
+    EXPECT_EQ(1000U, array.size());
+    auto self = reinterpret_cast<uintptr_t>(&array);
+    auto data = reinterpret_cast<uintptr_t>(array.data());
+    EXPECT_TRUE(data < self || data >= self + sizeof(array));
+
+    std::iota(array.begin(), array.end(), 0);
+    for (size_t i = 0; i < array.size(); ++i) {
+        EXPECT_EQ(i, array[i]);
+    }
+}
+
+}; // namespace EasyRDMA